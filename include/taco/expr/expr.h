@@ -258,6 +258,15 @@ public:
   /// and execute it's expression.
   const Schedule& getSchedule() const;
 
+  /// Returns the type that scalar temporaries of the tensor var's expression
+  /// accumulate in, or an undefined type if they use the expression type.
+  DataType getAccumulationType() const;
+
+  /// Set the type that scalar temporaries of the tensor var's expression
+  /// accumulate in (e.g. Float32 or Float64 when values are stored in
+  /// Float16). An undefined type restores the default.
+  void setAccumulationType(DataType type);
+
   /// Set the name of the tensor variable.
   void setName(std::string name);
 
@@ -60,5 +60,13 @@ protected:
 IndexExpr replace(IndexExpr expr,
                   const std::map<IndexExpr,IndexExpr>& substitutions);
 
+/// Rewrites an expression into the expression for its change when the
+/// accesses in `deltas` change by the mapped expressions. For example, when
+/// `A(i,j)` changes by `dA(i,j)` the change of `A(i,j)*x(j) + b(i)` is
+/// `dA(i,j)*x(j)`. The expression must be linear in the changed accesses, and
+/// the result is undefined if it does not depend on them.
+IndexExpr getDeltaExpr(IndexExpr expr,
+                       const std::map<IndexExpr,IndexExpr>& deltas);
+
 }
 #endif
@@ -11,7 +11,8 @@ namespace taco {
 enum ModeType {
   Dense,   // e.g. first  mode in CSR
   Sparse,  // e.g. second mode in CSR
-  Fixed    // e.g. second mode in ELL
+  Fixed,   // e.g. second mode in ELL
+  Diagonal // e.g. second mode in DIA
 };
 
 class Format {
@@ -62,6 +63,7 @@ extern const Format CSR;
 extern const Format CSC;
 extern const Format DCSR;
 extern const Format DCSC;
+extern const Format DIA;
 
 /// True if all modes are Dense
 bool isDense(const Format&);
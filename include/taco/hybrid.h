@@ -0,0 +1,58 @@
+/// A hybrid ELL+COO (HYB) matrix stores the first K entries of every row in an
+/// ELL part (format `{Dense,Fixed}`) and the entries that overflow K in a
+/// coordinate tail (format `{Sparse,Sparse}`). HYB keeps the regular, padded
+/// layout of ELL for the many short rows of power-law matrices, without paying
+/// for padding every row up to the length of the few very long rows.
+
+#ifndef TACO_HYBRID_H
+#define TACO_HYBRID_H
+
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr/expr.h"
+
+namespace taco {
+
+/// Format of the ELL part of a hybrid matrix.
+extern const Format ELL;
+
+class HybridTensor {
+public:
+  /// Split a packed matrix into a hybrid matrix with ELL width `width`. If the
+  /// width is negative it is chosen from the row-length histogram (see
+  /// `getHybridWidth`).
+  HybridTensor(const TensorBase& matrix, int width=-1);
+
+  /// Returns the ELL part, which holds the first K entries of every row.
+  const TensorBase& getEll() const;
+
+  /// Returns the coordinate tail, which holds the entries past K of each row.
+  const TensorBase& getCoo() const;
+
+  /// Returns the ELL width K.
+  int getWidth() const;
+
+  /// Create an index expression that reads the hybrid matrix. The expression
+  /// is the sum of its two parts.
+  IndexExpr operator()(const IndexVar& i, const IndexVar& j) const;
+
+  /// Rewrite the expression assigned to `result` so that each term that is
+  /// linear in this matrix becomes an ELL term plus a tail term with its own
+  /// reduction variables. The two terms then lower to sibling loops inside the
+  /// shared row loop, so both parts are computed by one fused kernel that
+  /// accumulates into the same output.
+  void fuse(TensorBase result) const;
+
+private:
+  TensorBase ell;
+  TensorBase coo;
+  int width;
+};
+
+/// Returns the ELL width for a hybrid matrix with the given row lengths: the
+/// largest K such that at least a third of the rows have K or more entries.
+int getHybridWidth(const std::vector<int>& rowLengths);
+
+}
+#endif
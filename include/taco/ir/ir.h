@@ -51,7 +51,8 @@ enum class IRNodeType {
   Comment,
   BlankLine,
   Print,
-  GetProperty
+  GetProperty,
+  Call
 };
 
 enum class TensorProperty {
@@ -448,14 +449,18 @@ public:
   static const IRNodeType _type_info = IRNodeType::Scope;
 };
 
-/** A store to an array location: arr[loc] = data */
+/** A store to an array location: arr[loc] = data
+ * An atomic store is an update (e.g. arr[loc] = arr[loc] + x) that is
+ * performed atomically with respect to the other threads of a parallel loop.
+ */
 struct Store : public StmtNode<Store> {
 public:
   Expr arr;
   Expr loc;
   Expr data;
+  bool use_atomics;
 
-  static Stmt make(Expr arr, Expr loc, Expr data);
+  static Stmt make(Expr arr, Expr loc, Expr data, bool use_atomics=false);
 
   static const IRNodeType _type_info = IRNodeType::Store;
 };
@@ -493,6 +498,11 @@ enum class LoopKind {Serial, Static, Dynamic, Vectorized};
  * If the loop is vectorized, the width says which vector width
  * to use.  By default (0), it will not set a specific width and
  * let clang determine the width to use.
+ *
+ * The iterations of a parallel loop may sum into a reduction variable: a
+ * scalar variable, or the first reduction_size elements of an array if the
+ * size is defined. Each thread sums into a private copy of the variable, and
+ * the copies are added to it when the loop ends.
  */
 struct For : public StmtNode<For> {
 public:
@@ -503,10 +513,13 @@ public:
   Stmt contents;
   LoopKind kind;
   int vec_width;  // vectorization width
+  Expr reduction_var;
+  Expr reduction_size;
   
   static Stmt make(Expr var, Expr start, Expr end, Expr increment,
                    Stmt contents, LoopKind kind=LoopKind::Serial,
-                   int vec_width=0);
+                   int vec_width=0, Expr reduction_var=Expr(),
+                   Expr reduction_size=Expr());
   
   static const IRNodeType _type_info = IRNodeType::For;
 };
@@ -614,6 +627,20 @@ public:
   static const IRNodeType _type_info = IRNodeType::GetProperty;
 };
 
+/** A call to a function of the generated code's runtime, such as
+ * taco_get_num_threads(), that returns a value of the given type.
+ */
+struct Call : public ExprNode<Call> {
+public:
+  std::string func;
+  std::vector<Expr> args;
+
+  static Expr make(const std::string& func, const std::vector<Expr>& args,
+                   DataType type);
+
+  static const IRNodeType _type_info = IRNodeType::Call;
+};
+
 template <typename E>
 inline bool isa(Expr e) {
   return e.defined() && dynamic_cast<const E*>(e.ptr) != nullptr;
@@ -55,6 +55,7 @@ protected:
   virtual void visit(const BlankLine*);
   virtual void visit(const Print*);
   virtual void visit(const GetProperty*);
+  virtual void visit(const Call*);
 
   std::ostream &stream;
   int indent;
@@ -58,6 +58,7 @@ protected:
   virtual void visit(const BlankLine* op);
   virtual void visit(const Print* op);
   virtual void visit(const GetProperty* op);
+  virtual void visit(const Call* op);
 };
 
 }}
@@ -38,6 +38,7 @@ struct Comment;
 struct BlankLine;
 struct Print;
 struct GetProperty;
+struct Call;
 
 /// Extend this class to visit every node in the IR.
 class IRVisitorStrict {
@@ -78,6 +79,7 @@ public:
   virtual void visit(const BlankLine*) = 0;
   virtual void visit(const Print*) = 0;
   virtual void visit(const GetProperty*) = 0;
+  virtual void visit(const Call*) = 0;
 };
 
 
@@ -121,6 +123,7 @@ public:
   virtual void visit(const BlankLine* op);
   virtual void visit(const Print* op);
   virtual void visit(const GetProperty* op);
+  virtual void visit(const Call* op);
 };
 
 }}
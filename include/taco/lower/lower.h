@@ -16,7 +16,21 @@ enum Property {
   Compute,
   Print,
   Comment,
-  Accumulate  /// Accumulate into the result (+=)
+  Accumulate, /// Accumulate into the result (+=)
+
+  /// Assemble sparse results whose other modes are dense (e.g. CSR) in
+  /// parallel: a first pass counts the nonzeros of every segment of the last
+  /// result mode, a prefix sum sizes the result arrays exactly, and a second
+  /// pass fills the segments. Both passes, and compute kernels that write into
+  /// such results, parallelize the outermost loop.
+  ParallelAssemble,
+
+  /// Balance the loops over a dense and a sparse level that compute a dense
+  /// vector (e.g. `y(i) = A(i,j) * x(j)` with a CSR `A`) by nonzeros instead
+  /// of rows. Every thread takes an equal share of the rows plus nonzeros,
+  /// found by a merge-path search of the `pos` array, and rows split between
+  /// threads are summed with atomic additions.
+  BalanceNonzeros
 };
 
 /// Lower the tensor object with a defined expression and an iteration schedule
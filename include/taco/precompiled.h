@@ -0,0 +1,36 @@
+/// Precompiled kernels let programs evaluate tensor expressions on hosts that
+/// have no C compiler. `compileToStaticLibrary` builds the kernels of a list
+/// of tensors ahead of time into a static library and a header, whose
+/// `<prefix>_register` function registers them by key (see
+/// `TensorBase::getKernelKey`). Tensors whose key is registered are bound to
+/// the precompiled kernels when they are compiled, instead of generating and
+/// compiling code.
+
+#ifndef TACO_PRECOMPILED_H
+#define TACO_PRECOMPILED_H
+
+#include <cstdint>
+#include <string>
+
+namespace taco {
+
+/// The kernels of a tensor expression in a precompiled library: the `_shim_`
+/// functions of its assemble and compute kernels, which take an array of
+/// pointers to their arguments (see `CodeGen_C::generateShim`), and the
+/// function that sets the parallel execution parameters of the library's
+/// kernels (see `Module::setParallel`).
+struct PrecompiledKernels {
+  int (*assemble)(void**);
+  int (*compute)(void**);
+  void (*setParallel)(int32_t, int32_t, int32_t, int32_t);
+};
+
+/// Register precompiled kernels under a key, replacing the kernels that were
+/// registered under it before, if any.
+void registerKernels(const std::string& key, const PrecompiledKernels& kernels);
+
+/// Get the kernels registered under a key. Returns false if there are none.
+bool getPrecompiledKernels(const std::string& key, PrecompiledKernels* kernels);
+
+}
+#endif
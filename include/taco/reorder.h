@@ -0,0 +1,50 @@
+/// Reorderings permute the coordinates of tensor modes to improve locality:
+/// nonzeros that are used together end up in nearby rows and columns, so the
+/// gathers of operands such as `x(j)` in `y(i) = A(i,j) * x(j)` hit the cache.
+/// A permutation `perm` is stored new-to-old: coordinate `perm[k]` of the
+/// original mode becomes coordinate `k` of the reordered mode.
+
+#ifndef TACO_REORDER_H
+#define TACO_REORDER_H
+
+#include <vector>
+
+#include "taco/tensor.h"
+
+namespace taco {
+
+/// Returns the reverse Cuthill-McKee ordering of a square matrix stored with a
+/// dense and a sparse mode (CSR or CSC), which reduces its bandwidth. The
+/// ordering is computed on the symmetrized pattern, one breadth-first search
+/// per connected component starting from a pseudo-peripheral vertex.
+std::vector<int> getRCMOrdering(const TensorBase& matrix);
+
+/// Returns the ordering of the outermost stored mode of a tensor whose modes
+/// are dense or sparse (e.g. the rows of a CSR matrix or the slices of a CSF
+/// tensor) that sorts its coordinates by their number of nonzeros, in
+/// decreasing order by default. Ties keep their original order.
+std::vector<int> getDegreeOrdering(const TensorBase& tensor,
+                                   bool decreasing=true);
+
+/// Returns an ordering of a square CSR or CSC matrix that recursively bisects
+/// the symmetrized pattern, by breadth-first level structures, until parts
+/// have at most `partSize` vertices. Vertices of a part are numbered
+/// consecutively, so each part's rows touch a narrow range of columns.
+std::vector<int> getBisectionOrdering(const TensorBase& matrix,
+                                      int partSize=64);
+
+/// Returns the inverse of a permutation.
+std::vector<int> invertPermutation(const std::vector<int>& permutation);
+
+/// Returns a copy of a packed tensor whose modes are dense or sparse with
+/// the coordinates of each mode permuted. `permutations[m]` permutes mode `m`
+/// and an empty permutation leaves the mode unchanged. The storage is rebuilt
+/// level by level, sorting only the segments of sparse levels, without
+/// repacking. For a matrix `A` and an ordering `p`, `permute(A, {p, p})` is
+/// `P A P^T`, and a result `y'` computed with the permuted matrix and operand
+/// `permute(x, {p})` maps back with `permute(y', {invertPermutation(p)})`.
+TensorBase permute(const TensorBase& tensor,
+                   const std::vector<std::vector<int>>& permutations);
+
+}
+#endif
@@ -0,0 +1,115 @@
+/// Sparsity statistics describe the nonzero structure of a tensor: how the
+/// nonzeros spread over the slices of its first mode and, for matrices, how
+/// far they lie from the diagonal and how they cluster into blocks. The format
+/// advisor uses them to choose between dense, `CSR`, `DCSR`, `ELL` (see
+/// hybrid.h) and `DIA` storage, and to size the initial index allocations of
+/// results.
+
+#ifndef TACO_STATISTICS_H
+#define TACO_STATISTICS_H
+
+#include <vector>
+#include <ostream>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+
+namespace taco {
+
+struct SparsityStatistics {
+  /// The dimensions of the tensor.
+  std::vector<int> dimensions;
+
+  /// The number of nonzero components.
+  size_t nnz = 0;
+
+  /// The number of nonzeros in each slice of the first mode (e.g. the rows of
+  /// a matrix).
+  std::vector<int> sliceSizes;
+
+  /// The number of slices with k nonzeros is `sliceHistogram[k]`.
+  std::vector<int> sliceHistogram;
+
+  /// The number of slices with at least one nonzero.
+  int numNonemptySlices = 0;
+
+  /// The number of nonzeros in the largest slice.
+  int maxSliceSize = 0;
+
+  /// The largest distances `i - j` below and `j - i` above the diagonal of the
+  /// nonzeros of a matrix.
+  int lowerBandwidth = 0;
+  int upperBandwidth = 0;
+
+  /// The sorted offsets `j - i` of the diagonals of a matrix that hold
+  /// nonzeros.
+  std::vector<int> diagonals;
+
+  /// The number of nonempty `blockSize x blockSize` blocks of a matrix, with
+  /// blocks aligned to multiples of the block size.
+  int blockSize = 0;
+  size_t numBlocks = 0;
+
+  /// Returns the fraction of the components that are nonzero.
+  double getDensity() const;
+
+  /// Returns the fraction of the components of the nonempty blocks that are
+  /// nonzero.
+  double getBlockDensity() const;
+
+  /// Returns the fraction of the components stored by `DIA` (one per row and
+  /// stored diagonal) that are nonzero.
+  double getDiagonalDensity() const;
+
+  /// Returns the fraction of the components stored by `ELL` (the largest
+  /// slice size per row) that are nonzero.
+  double getEllDensity() const;
+};
+
+/// Compute the sparsity statistics of a packed tensor. Explicitly stored
+/// zeros are not counted as nonzeros.
+SparsityStatistics getStatistics(const TensorBase& tensor, int blockSize=4);
+
+/// Compute the sparsity statistics of the nonzeros at the given coordinates,
+/// e.g. a coordinate (COO) buffer. Duplicate coordinates are counted once.
+SparsityStatistics getStatistics(const std::vector<int>& dimensions,
+                                 std::vector<std::vector<int>> coordinates,
+                                 int blockSize=4);
+
+std::ostream& operator<<(std::ostream&, const SparsityStatistics&);
+
+/// Returns the formats that suit a tensor with the given statistics, the
+/// advised format first. Matrices are dense when at least a quarter of their
+/// components are nonzero, `DIA` when the stored diagonals are mostly full,
+/// `DCSR` when most rows are empty, `ELL` when rows have similar lengths and
+/// `CSR` otherwise. Other tensors get a dense or sparse first mode, by the
+/// fraction of empty slices, and sparse remaining modes.
+std::vector<Format> getCandidateFormats(const SparsityStatistics& stats);
+
+/// Returns the advised format for a tensor with the given statistics (the
+/// first of `getCandidateFormats`).
+Format adviseFormat(const SparsityStatistics& stats);
+
+/// The formats advised for the operands of an expression and the initial
+/// index allocation size advised for its result.
+struct FormatAdvice {
+  std::vector<TensorBase> operands;
+  std::vector<Format>     formats;
+  size_t                  allocSize;
+};
+
+/// Advise formats for the packed operands of the expression assigned to
+/// `result`, and an allocation size (see `TensorBase::setAllocSize`) that fits
+/// an upper bound on the nonzeros of the result. Sums are bounded by the sum of
+/// the nonzeros of their terms, and products of operands over the same index
+/// variables by the smallest operand. Products over different variables, such
+/// as outer products, are bounded by the product of the nonzeros, and every
+/// bound by the size of the result. If `validate` is true each
+/// operand is converted to each of its candidate formats, the expression is
+/// compiled for it, and the format with the fastest median assemble and
+/// compute time over `repeat` runs is advised.
+FormatAdvice adviseFormats(const TensorBase& result, bool validate=false,
+                           int repeat=5);
+
+}
+#endif
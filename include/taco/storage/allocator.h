@@ -0,0 +1,145 @@
+#ifndef TACO_STORAGE_ALLOCATOR_H
+#define TACO_STORAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+namespace taco {
+namespace storage {
+
+/// The alignment, in bytes, of arrays allocated by taco (one cache line).
+const size_t ARRAY_ALIGNMENT = 64;
+
+/// Arrays of at least this many bytes are backed by transparent huge pages.
+const size_t DEFAULT_HUGE_PAGE_THRESHOLD = size_t(1) << 24;
+
+/// An allocator for tensor arrays (index arrays and values). Memory returned by
+/// an allocator must be released by that allocator's `deallocate`, which must
+/// also accept memory obtained from `malloc`, since arrays with the `Free`
+/// policy may come from either.
+class Allocator {
+public:
+  virtual ~Allocator();
+
+  /// Allocate `size` bytes.
+  virtual void* allocate(size_t size) = 0;
+
+  /// Allocate `size` bytes aligned to `alignment` bytes, a power of two (e.g.
+  /// the page size). Returns null if the allocator can't honor the alignment,
+  /// which by default it only does for `ARRAY_ALIGNMENT` if it is aligned.
+  virtual void* allocateAligned(size_t size, size_t alignment);
+
+  /// Resize an allocation to `size` bytes, preserving its contents.
+  virtual void* reallocate(void* ptr, size_t size) = 0;
+
+  /// Release an allocation.
+  virtual void deallocate(void* ptr) = 0;
+
+  /// True iff every allocation is aligned to `ARRAY_ALIGNMENT` bytes.
+  virtual bool isAligned() const = 0;
+};
+
+/// The default allocator. Returns `ARRAY_ALIGNMENT`-aligned memory that can be
+/// released with `free`, and advises the kernel to back allocations of at
+/// least `hugePageThreshold` bytes with transparent huge pages
+/// (`madvise(MADV_HUGEPAGE)`). A threshold of zero disables huge pages.
+class AlignedAllocator : public Allocator {
+public:
+  AlignedAllocator(size_t hugePageThreshold=DEFAULT_HUGE_PAGE_THRESHOLD);
+
+  void* allocate(size_t size);
+  void* allocateAligned(size_t size, size_t alignment);
+  void* reallocate(void* ptr, size_t size);
+  void deallocate(void* ptr);
+  bool isAligned() const;
+
+  size_t getHugePageThreshold() const;
+
+private:
+  size_t hugePageThreshold;
+};
+
+/// An allocator that recycles blocks between allocations. Requests are rounded
+/// up to power-of-two size classes, and released blocks are kept on a free
+/// list per class instead of being returned to the system, so that results
+/// that are reassembled with the same shape (e.g. in an iterative solver) get
+/// their previous `pos`, `idx` and `vals` buffers back. At most
+/// `maxCachedBytes` bytes are kept on the free lists. Memory is obtained from
+/// an `AlignedAllocator`, and memory the pool did not allocate is released
+/// with `free`. Blocks of at least a page are page aligned, so that aligned
+/// requests of up to a page are recycled too.
+class PoolAllocator : public Allocator {
+public:
+  PoolAllocator(size_t maxCachedBytes=size_t(1) << 30,
+                size_t hugePageThreshold=DEFAULT_HUGE_PAGE_THRESHOLD);
+  ~PoolAllocator();
+
+  void* allocate(size_t size);
+  void* allocateAligned(size_t size, size_t alignment);
+  void* reallocate(void* ptr, size_t size);
+  void deallocate(void* ptr);
+  bool isAligned() const;
+
+  /// Return all cached blocks to the system.
+  void trim();
+
+  /// The number of bytes currently cached on the free lists.
+  size_t getCachedBytes() const;
+
+  /// The number of allocations served from the free lists.
+  size_t getNumReused() const;
+
+private:
+  AlignedAllocator allocator;
+  size_t maxCachedBytes;
+  size_t cachedBytes;
+  size_t numReused;
+
+  // size class of every live block allocated by the pool
+  std::unordered_map<void*, int> blocks;
+  // free blocks per size class
+  std::vector<std::vector<void*>> freeLists;
+  mutable std::mutex blocksMutex;
+
+  void* allocateBlock(int sizeClass);
+  void  releaseBlock(void* ptr, int sizeClass);
+};
+
+/// Returns the allocator used for tensor arrays. The returned pointer keeps
+/// the allocator alive while the caller uses it, even if another thread
+/// replaces it in the meantime.
+std::shared_ptr<Allocator> getAllocator();
+
+/// Replace the allocator used for tensor arrays. It may be called while other
+/// threads allocate, and calls that already started finish with the previous
+/// allocator. Memory allocated by the previous allocator must still be
+/// releasable by the new one.
+void setAllocator(std::shared_ptr<Allocator> allocator);
+
+/// Allocate `size` bytes with the current allocator.
+void* allocate(size_t size);
+
+/// Resize memory with the current allocator.
+void* reallocate(void* ptr, size_t size);
+
+/// Release memory with the current allocator.
+void deallocate(void* ptr);
+
+/// True iff `ptr` is aligned to `alignment` bytes.
+bool isAligned(const void* ptr, size_t alignment=ARRAY_ALIGNMENT);
+
+}}
+
+/// C ABI hooks that forward to the current tensor allocator. Generated kernels
+/// allocate their result arrays through these when they are loaded into a
+/// process that contains taco, and fall back to aligned malloc otherwise.
+extern "C" {
+void* taco_allocate(size_t size);
+void* taco_reallocate(void* ptr, size_t size);
+void  taco_deallocate(void* ptr);
+}
+
+#endif
@@ -14,7 +14,8 @@ class Array {
 public:
   /// The memory reclamation policy of Array objects. UserOwns means the Array
   /// object will not free its data, free means it will reclaim data  with the
-  /// C free function and delete means it will reclaim data with delete[].
+  /// tensor allocator (which also accepts malloc'ed memory, see allocator.h)
+  /// and delete means it will reclaim data with delete[].
   enum Policy {UserOwns, Free, Delete};
 
   /// Construct an empty array of undefined elements.
@@ -2,9 +2,12 @@
 #define TACO_STORAGE_ARRAY_UTIL_H
 
 #include <vector>
+#include <cstring>
 #include <initializer_list>
 
 #include "taco/storage/array.h"
+#include "taco/storage/allocator.h"
+#include "taco/storage/numa.h"
 #include "taco/type.h"
 #include "taco/error.h"
 
@@ -27,13 +30,29 @@ Array makeArray(DataType type, size_t size);
 /// Construct an Array from the values.
 template <typename T>
 Array makeArray(const std::vector<T>& values) {
-  return makeArray(util::copyToArray(values), values.size(), Array::Free);
+  size_t size = values.size() * sizeof(T);
+  T* data = static_cast<T*>(allocate(size));
+  if (size > 0) {
+    memcpy(data, values.data(), size);
+  }
+  return makeArray(data, values.size(), Array::Free);
+}
+
+/// Construct an Array from the values, placing its pages according to the
+/// NUMA policy. The bounds split the values into units of parallel work (see
+/// `allocatePlaced`).
+template <typename T>
+Array makeArray(const std::vector<T>& values,
+                const std::vector<size_t>& bounds) {
+  T* data = static_cast<T*>(allocatePlaced(values.data(), sizeof(T),
+                                           values.size(), bounds));
+  return makeArray(data, values.size(), Array::Free);
 }
 
 /// Construct an Array from the values.
 template <typename T>
 Array makeArray(const std::initializer_list<T>& values) {
-  return makeArray(util::copyToArray(values), values.size(), Array::Free);
+  return makeArray(std::vector<T>(values));
 }
 
 }}
@@ -0,0 +1,62 @@
+#ifndef TACO_STORAGE_NUMA_H
+#define TACO_STORAGE_NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+namespace taco {
+namespace storage {
+
+/// Arrays smaller than this many bytes are allocated as usual under every
+/// policy, since their own pages would waste more memory than placing them
+/// saves.
+const size_t NUMA_PLACEMENT_THRESHOLD = size_t(1) << 16;
+
+/// The NUMA placement of the pages of packed tensor arrays.
+enum class NumaPolicy {
+  /// Pages are placed on the node of the thread that packs the tensor. This
+  /// is the default.
+  Local,
+
+  /// Pages are first touched in parallel, each by the thread that a
+  /// statically scheduled `#pragma omp parallel for` assigns their rows to, so
+  /// they end up on the node that computes on them if the kernels run with
+  /// the static schedule (see ParallelOptions) on as many threads, and are
+  /// compiled with OpenMP.
+  FirstTouch,
+
+  /// Pages are interleaved round-robin across all NUMA nodes.
+  Interleave,
+
+  /// Pages are bound to a single NUMA node.
+  Bind
+};
+
+/// Set the placement policy for tensor arrays packed from now on. The node is
+/// only used by the `Bind` policy. Arrays are placed only if this is called
+/// with a policy other than `Local`.
+void setNumaPolicy(NumaPolicy policy, int node=0);
+
+/// Returns the placement policy for packed tensor arrays.
+NumaPolicy getNumaPolicy();
+
+/// Returns the node that the `Bind` policy binds arrays to.
+int getNumaNode();
+
+/// Allocate memory for `size` elements of `elementSize` bytes and copy them
+/// from `src`, placing the pages according to the NUMA policy. `bounds`
+/// splits the elements into the units of parallel work (e.g. matrix rows):
+/// unit `i` spans elements [bounds[i], bounds[i+1]). Under the `FirstTouch`
+/// policy unit `i` is copied by the thread that a statically scheduled
+/// `#pragma omp parallel for` assigns iteration `i` to. Under every policy but
+/// `Local` arrays of at least `NUMA_PLACEMENT_THRESHOLD` bytes get page-aligned
+/// pages of their own from the tensor allocator (see
+/// `Allocator::allocateAligned`), so that their placement does not affect
+/// other arrays. The placement is advisory: it is not checked and silently
+/// falls back to the default where NUMA is unavailable or the allocator can't
+/// align to pages. The memory is released with `storage::deallocate`.
+void* allocatePlaced(const void* src, size_t elementSize, size_t size,
+                     const std::vector<size_t>& bounds);
+
+}}
+#endif
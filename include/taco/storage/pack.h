@@ -6,6 +6,7 @@
 #ifndef TACO_STORAGE_PACK_H
 #define TACO_STORAGE_PACK_H
 
+#include <algorithm>
 #include <climits>
 #include <vector>
 #include "taco/format.h"
@@ -28,7 +29,9 @@ namespace taco {
     
 #define PACK_NEXT_LEVEL(cend) {                                            \
   if (i + 1 == modeTypes.size()) {                                       \
-    values->push_back((cbegin < cend) ? vals[cbegin] : 0.0);             \
+    if (values != nullptr) {                                             \
+      values->push_back((cbegin < cend) ? vals[cbegin] : T());           \
+    }                                                                    \
   } else {                                                               \
     packTensor(dimensions, coords, vals, cbegin, (cend), modeTypes, i+1, \
     indices, values);                                         \
@@ -47,7 +50,7 @@ size_t findMaxFixedValue(const vector<int>& dimensions,
 
 /// Pack tensor coordinates into an index structure and value array.  The
 /// indices consist of one index per tensor mode, and each index contains
-/// [0,2] index arrays.
+/// [0,2] index arrays. If `values` is null only the indices are packed.
 template<typename T>
 void packTensor(const vector<int>& dimensions,
                        const vector<vector<int>>& coords,
@@ -121,7 +124,9 @@ void packTensor(const vector<int>& dimensions,
           cbegin = cend;
         }
       }
-        // Complete index if necessary with the last index value
+        // Complete index if necessary with the last index value, or with 0
+        // if the segment is empty, so that padding holds a valid coordinate
+        // (and zero values) that kernels can load without checking it
       auto curSize=segmentSize;
       while (curSize < fixedValue) {
         index[1].insert(index[1].end(), 
@@ -131,9 +136,70 @@ void packTensor(const vector<int>& dimensions,
       }
       break;
     }
+    case Diagonal: {
+      taco_ierror << "Diagonal modes are packed by packDiagonals";
+      break;
+    }
+  }
+}
+
+/// Collect the sorted diagonal offsets (j - i) of the non-zero coordinates of
+/// a diagonal mode, relative to the dense mode above it.
+vector<int> getDiagonalOffsets(const vector<vector<int>>& coords,
+                               size_t diagonalLevel, size_t numCoords);
+
+/// Pack the values of a DIA matrix with `numRows` rows. The values of each
+/// stored diagonal are contiguous, with one slot per row that is zero where
+/// the diagonal lies outside the matrix or has no component, so that loops
+/// over the rows of a diagonal have unit stride.
+template<typename T>
+void packDiagonals(size_t numRows, const vector<vector<int>>& coords,
+                   const T* vals, size_t numCoords, const vector<int>& offsets,
+                   vector<T>* values) {
+  values->assign(offsets.size() * numRows, T());
+  for (size_t k = 0; k < numCoords; ++k) {
+    int offset = coords[1][k] - coords[0][k];
+    size_t diagonal = std::lower_bound(offsets.begin(), offsets.end(), offset) -
+                      offsets.begin();
+    (*values)[diagonal * numRows + coords[0][k]] = vals[k];
   }
 }
 
+/// Compute, for every level of a packed index, the bounds of the units of
+/// parallel work (the positions of the first level, e.g. the rows of a CSR
+/// matrix) in the level's positions, so that arrays can be first-touched by
+/// the threads that compute on them.
+vector<vector<size_t>> getLevelBounds(const vector<int>& dimensions,
+                                      const vector<ModeType>& modeTypes,
+                                      const vector<vector<vector<int>>>& indices);
+
+/// Create a tensor index from the index vectors built by `packTensor` or
+/// `mergeTensor`, placing the arrays according to the NUMA policy. `bounds`
+/// are the level bounds returned by `getLevelBounds`.
+Index makeIndex(const std::vector<int>&                           dimensions,
+                const Format&                                     format,
+                const std::vector<std::vector<std::vector<int>>>& indices,
+                const std::vector<std::vector<size_t>>&           bounds);
+
+/// Create tensor storage from the index vectors and values built by
+/// `packTensor` or `mergeTensor`, placing the arrays according to the NUMA
+/// policy.
+template <typename T>
+Storage makeStorage(const std::vector<int>&                     dimensions,
+                    const Format&                               format,
+                    const std::vector<std::vector<std::vector<int>>>& indices,
+                    const std::vector<T>&                       vals) {
+  Storage storage(format);
+  size_t order = dimensions.size();
+
+  vector<vector<size_t>> bounds = getLevelBounds(dimensions,
+                                                 format.getModeTypes(), indices);
+  storage.setIndex(makeIndex(dimensions, format, indices, bounds));
+  storage.setValues(order > 0 ? makeArray(vals, bounds[order-1])
+                              : makeArray(vals));
+  return storage;
+}
+
 /// Pack tensor coordinates into a format. The coordinates must be stored as a
 /// structure of arrays, that is one vector per axis coordinate and one vector
 /// for the values. The coordinates must be sorted lexicographically.
@@ -144,8 +210,6 @@ Storage pack(const std::vector<int>&              dimensions,
              const std::vector<T>            values) {
   taco_iassert(dimensions.size() == format.getOrder());
   
-  Storage storage(format);
-  
   size_t order = dimensions.size();
   size_t numCoordinates = values.size();
   
@@ -179,35 +243,158 @@ Storage pack(const std::vector<int>&              dimensions,
         indices[i][0].push_back(static_cast<int>(maxSize));
         break;
       }
+      case Diagonal: {
+        taco_uassert(order == 2 && i == 1 &&
+                     format.getModeTypes()[0] == Dense) <<
+            "Diagonal modes are only supported as the second mode of a "
+            "matrix whose first mode is dense";
+
+          // Diagonal indices have two arrays: the number of stored diagonals
+          // followed by the mode dimension, and the sorted diagonal offsets
+        indices.push_back({{}, {}});
+        indices[i][1] = getDiagonalOffsets(coordinates, i, numCoordinates);
+        indices[i][0].push_back(static_cast<int>(indices[i][1].size()));
+        indices[i][0].push_back(dimensions[i]);
+        break;
+      }
     }
   }
   
   vector<T> vals;
-  packTensor(dimensions, coordinates, (const T*)values.data(), 0,
-             numCoordinates, format.getModeTypes(), 0, &indices, &vals);
+  if (order == 2 && format.getModeTypes()[1] == Diagonal) {
+    packDiagonals(dimensions[0], coordinates, (const T*)values.data(),
+                  numCoordinates, indices[1][1], &vals);
+  }
+  else {
+    packTensor(dimensions, coordinates, (const T*)values.data(), 0,
+               numCoordinates, format.getModeTypes(), 0, &indices, &vals);
+  }
   
-    // Create a tensor index
-  vector<ModeIndex> modeIndices;
-  for (size_t i = 0; i < order; i++) {
-    ModeType modeType = format.getModeTypes()[i];
-    switch (modeType) {
-      case ModeType::Dense: {
-        Array size = makeArray({dimensions[i]});
-        modeIndices.push_back(ModeIndex({size}));
-        break;
+  return makeStorage(dimensions, format, indices, vals);
+}
+
+/// Pack the coordinates of a pattern tensor into a format without a values
+/// array. The modes must be dense or sparse and the last mode sparse, so that
+/// every stored component is a coordinate. The coordinates must be sorted
+/// lexicographically.
+Storage packPattern(const std::vector<int>&              dimensions,
+                    const Format&                        format,
+                    const std::vector<std::vector<int>>& coordinates);
+
+/// Merge the sorted, duplicate-free coordinates [begin,end) into the subtree
+/// at position `pos` of level `i` of a packed index, appending the merged
+/// subtree to `indices` and `values`. A negative `pos` denotes an empty
+/// subtree. Components stored in both are summed.
+template<typename T>
+void mergeTensor(const vector<int>& dimensions, const Index& index,
+                 const T* oldVals, long long pos,
+                 const vector<vector<int>>& coords, const T* vals,
+                 size_t begin, size_t end, size_t i,
+                 std::vector<std::vector<std::vector<int>>>* indices,
+                 vector<T>* values) {
+  if (i == dimensions.size()) {
+    T value = (pos >= 0 && oldVals != nullptr) ? oldVals[pos] : T();
+    if (begin < end) {
+      value = value + vals[begin];
+    }
+    values->push_back(value);
+    return;
+  }
+
+  auto& levelCoords = coords[i];
+  const ModeIndex& modeIndex = index.getModeIndex(i);
+  switch (index.getFormat().getModeTypes()[i]) {
+    case Dense: {
+      const int size = dimensions[i];
+      size_t cbegin = begin;
+      for (int j = 0; j < size; j++) {
+        size_t cend = cbegin;
+        while (cend < end && levelCoords[cend] == j) {
+          cend++;
+        }
+        mergeTensor(dimensions, index, oldVals, (pos >= 0) ? pos*size + j : -1,
+                    coords, vals, cbegin, cend, i+1, indices, values);
+        cbegin = cend;
       }
-      case ModeType::Sparse:
-      case ModeType::Fixed: {
-        Array pos = makeArray(indices[i][0]);
-        Array idx = makeArray(indices[i][1]);
-        modeIndices.push_back(ModeIndex({pos, idx}));
-        break;
+      break;
+    }
+    case Sparse: {
+      auto& newIndex = (*indices)[i];
+
+      // The segment of the subtree in the packed index (empty if unpacked)
+      long long p = 0, pend = 0;
+      const int* oldIdx = nullptr;
+      if (pos >= 0 && modeIndex.numIndexArrays() == 2) {
+        const int* oldPos = (const int*)modeIndex.getIndexArray(0).getData();
+        oldIdx = (const int*)modeIndex.getIndexArray(1).getData();
+        p    = oldPos[pos];
+        pend = oldPos[pos+1];
+      }
+
+      // Merge the packed segment with the new coordinates
+      size_t cbegin = begin;
+      while (p < pend || cbegin < end) {
+        int oldCoord = (p < pend) ? oldIdx[p] : INT_MAX;
+        int newCoord = (cbegin < end) ? levelCoords[cbegin] : INT_MAX;
+        int j = std::min(oldCoord, newCoord);
+        size_t cend = cbegin;
+        while (cend < end && levelCoords[cend] == j) {
+          cend++;
+        }
+        newIndex[1].push_back(j);
+        mergeTensor(dimensions, index, oldVals, (oldCoord == j) ? p : -1,
+                    coords, vals, cbegin, cend, i+1, indices, values);
+        if (oldCoord == j) {
+          p++;
+        }
+        cbegin = cend;
       }
+      newIndex[0].push_back((int)newIndex[1].size());
+      break;
     }
+    case Fixed:
+    case Diagonal:
+      taco_not_supported_yet;
+      break;
   }
-  storage.setIndex(Index(format, modeIndices));
-  storage.setValues(makeArray(vals));
-  return storage;
+}
+
+/// Merge new tensor coordinates into packed storage whose modes are dense or
+/// sparse. The coordinates are stored as a structure of arrays, in the storage
+/// order of the modes, and must be sorted lexicographically and free of
+/// duplicates. Each level is merged in a single pass, so the cost is linear in
+/// the size of the packed index plus the number of new coordinates.
+template <typename T>
+Storage merge(const Storage&                       storage,
+              const std::vector<int>&              dimensions,
+              const std::vector<std::vector<int>>& coordinates,
+              const std::vector<T>&                values) {
+  const Format& format = storage.getFormat();
+  taco_iassert(dimensions.size() == format.getOrder());
+  size_t order = dimensions.size();
+
+  vector<vector<vector<int>>> indices;
+  for (size_t i = 0; i < order; ++i) {
+    switch (format.getModeTypes()[i]) {
+      case Dense:
+        indices.push_back({});
+        break;
+      case Sparse:
+        indices.push_back({{0}, {}});
+        break;
+      case Fixed:
+      case Diagonal:
+        taco_uassert(false) << "Only tensors with dense and sparse modes can "
+                               "be merged into";
+        break;
+    }
+  }
+
+  const T* oldVals = (const T*)storage.getValues().getData();
+  vector<T> vals;
+  mergeTensor(dimensions, storage.getIndex(), oldVals, 0, coordinates,
+              values.data(), 0, values.size(), 0, &indices, &vals);
+  return makeStorage(dimensions, format, indices, vals);
 }
 
 /// Generate code to pack tensor coordinates into a specific format. In the
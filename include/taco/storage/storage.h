@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 
 namespace taco {
 class Format;
@@ -47,6 +48,12 @@ public:
   /// Returns the size of the storage in bytes.
   size_t getSizeInBytes();
 
+  /// Returns a fingerprint of the tensor index (the sparsity structure). The
+  /// fingerprint is unique among storages and changes whenever the index is
+  /// set, but not when the values change. Code that modifies index arrays in
+  /// place must call `setIndex` to publish the change.
+  uint64_t getFingerprint() const;
+
 private:
   struct Content;
   std::shared_ptr<Content> content;
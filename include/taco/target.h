@@ -1,6 +1,9 @@
 #ifndef TACO_TARGET_H
 #define TACO_TARGET_H
 
+#include <string>
+#include <ostream>
+
 #include "taco/error.h"
 
 namespace taco {
@@ -9,34 +12,72 @@ namespace taco {
 /// JIT and AOT code generation.
 struct Target {
   /// Architectures.  If C99, we generate C code, and if it is a specific
-  /// machine arch (e.g. x86 or arm) we use LLVM.
+  /// machine arch (e.g. x86) we compile in memory with LLVM.
   enum Arch {C99=0, X86} arch;
   
   /// Operating System.  Used when deciding which OS-specific calls to use.
   enum OS {OSUnknown=0, Linux, MacOS, Windows} os;
   
+  /// Instruction sets of x86 machines, oldest first.  Each one includes the
+  /// previous ones.  Generic code runs on any machine of the architecture.
+  enum ISA {ISAGeneric=0, SSE42, AVX, AVX2, AVX512} isa;
+
+  /// If true, the kernels are built for several instruction sets (AVX-512,
+  /// AVX2 and generic) in one library and the dynamic loader picks the one
+  /// that suits the machine (function multiversioning), so that the library
+  /// is portable.  Otherwise they are built for `isa` only.
+  bool multiversion;
+
   // As we support them, we'll stick in optional features into the target as
   // well, including things like parallelism model (e.g. openmp, cilk) for
-  // C code generation, and hardware features (e.g. AVX) for LLVM code gen.
+  // C code generation.
   
   /// Given a string of the form arch-os-features, construct the corresponding
-  /// Target object.
+  /// Target object.  The features are an instruction set (`generic`, `sse42`,
+  /// `avx`, `avx2` or `avx512`) and `multiversion`, e.g. `c99-linux-avx2`.
   Target(const std::string &s);
 
-  Target(Arch a, OS o) : arch(a), os(o) {
-    taco_tassert(a == C99 && o != Windows && o != OSUnknown)
+  Target(Arch a, OS o, ISA isa=ISAGeneric, bool multiversion=false)
+      : arch(a), os(o), isa(isa), multiversion(multiversion) {
+    taco_tassert((a == C99 || a == X86) && o != Windows && o != OSUnknown)
         << "Unsupported target.";
   }
+
+  /// Returns the microarchitecture that the C compiler tunes for, or the
+  /// empty string for generic code.
+  std::string getCPU() const;
+
+  /// Returns the width in bits of the vector registers that the generated
+  /// code should use, or 0 if the C compiler's default is fine.
+  int getVectorWidth() const;
+
+  /// Returns the flags that tell the C compiler to build for this target,
+  /// e.g. `-march=haswell -mtune=haswell` for AVX2.  Multiversioned targets
+  /// build for the generic machine and carry their variants in the code.
+  std::string getCompilerFlags() const;
   
   /// Validate a target string
   static bool validateTargetString(const std::string &s);
   
 };
 
-  /// Gets the target from the environment.  If this is not set in the
-  /// environment, it uses the default C99 backend with the current OS
+std::ostream& operator<<(std::ostream&, const Target&);
+
+/// Returns the newest instruction set that both the processor and the OS of
+/// the host support (detected with cpuid), or ISAGeneric on other
+/// architectures.
+Target::ISA getHostISA();
+
+  /// Gets the target from the environment variable `TACO_TARGET`.  If this is
+  /// not set in the environment, it uses the default C99 backend with the
+  /// current OS and the instruction set of the host.
   Target getTargetFromEnvironment();
 
+/// Returns a C99 target for the host OS that runs on any machine of the host
+/// architecture: generic code, multiversioned for newer x86 instruction sets.
+/// Libraries that are compiled ahead of time use it by default.
+Target getPortableTarget();
+
 } // namespace taco
 
 #endif
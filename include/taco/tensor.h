@@ -9,6 +9,7 @@
 #include "taco/type.h"
 #include "taco/format.h"
 #include "taco/error.h"
+#include "taco/target.h"
 #include "error/error_messages.h"
 
 #include "taco/expr/expr.h"
@@ -21,6 +22,53 @@
 
 namespace taco {
 
+/// How the iterations of the parallel loops of a kernel are divided among
+/// threads. `Default` keeps each loop's own schedule: static for loops over
+/// dense modes and dynamic with chunks of 16 iterations for loops over sparse
+/// modes.
+enum class ParallelSchedule {Default, Static, Dynamic, Guided};
+
+/// The parallel execution parameters of the kernels of a tensor, which can
+/// change between calls without recompiling them.
+struct ParallelOptions {
+  /// Whether the parallel loops run in parallel at all.
+  bool parallelize = true;
+
+  /// The number of threads, or zero for the OpenMP default (e.g. the
+  /// `OMP_NUM_THREADS` environment variable). Whether parallel reductions sum
+  /// into private copies or with atomics is decided at compile time for the
+  /// OpenMP default, and doesn't change with this count.
+  int numThreads = 0;
+
+  /// The schedule of the parallel loops.
+  ParallelSchedule schedule = ParallelSchedule::Default;
+
+  /// The number of iterations a thread takes at a time. If zero, the chunk
+  /// size of dynamic and guided schedules is autotuned by timing the first
+  /// computes with each of a few candidate sizes (if the kernels are compiled
+  /// with OpenMP), and other schedules use their default.
+  int chunkSize = 0;
+};
+
+/// A variant of the kernels of a tensor expression that autotuning times (see
+/// TensorBase::setAutotuning): how the compute kernel is generated and the
+/// schedule and chunk size of its parallel loops.
+struct KernelVariant {
+  /// Whether the compute kernel balances nonzeros among threads (see
+  /// TensorBase::setNonzeroBalancing).
+  bool nonzeroBalancing = false;
+
+  /// Whether the compute kernel uses SIMD intrinsics (see
+  /// TensorBase::setSimdIntrinsics).
+  bool simdIntrinsics = false;
+
+  /// The schedule of the parallel loops.
+  ParallelSchedule schedule = ParallelSchedule::Default;
+
+  /// The chunk size of the parallel loops, or zero for the schedule's default.
+  int chunkSize = 0;
+};
+
 /// TensorBase is the super-class for all tensors. You can use it directly to
 /// avoid templates, or you can use the templated `Tensor<T>` that inherits from
 /// `TensorBase`.
@@ -126,10 +174,26 @@ public:
   /// to the format of the tensor.
   storage::Storage& getStorage();
 
-  /// Pack tensor into the given format
+  /// Pack tensor into the given format. Tensors with a `Bool` component type
+  /// are pattern tensors: only their coordinates are packed, and every stored
+  /// component is implicitly one. Their modes must be dense or sparse, with a
+  /// sparse last mode, so that they store no padding.
   template <typename T> void packTyped();
+  void packPattern();
   void pack();
 
+  /// Merge the components inserted since the last pack into the packed
+  /// storage. Only the new coordinates are sorted, and each level of the packed
+  /// index is merged with them in one pass, in time linear in its size.
+  /// Components that are already stored are summed with the new ones, as with
+  /// duplicate insertions. All modes must be dense or sparse.
+  void merge();
+
+  /// Merge the components inserted since the last pack into the packed
+  /// storage in a background thread. New components may be inserted while the
+  /// merge runs, and the next access to the tensor storage waits for it.
+  void mergeAsync();
+
   /// Zero out the values
   void zero();
 
@@ -170,12 +234,44 @@ public:
   /// Compute the given expression and put the values in the tensor storage.
   void compute();
 
+  /// Compute the given expression with the given parallel execution
+  /// parameters, which also apply to later assembles and computes.
+  void compute(const ParallelOptions& options);
+
   /// Compile, assemble and compute as needed.
   void evaluate();
 
+  /// Compute the expression again, e.g. after operand values changed. The
+  /// compute kernel reuses the result index from the last assemble if the
+  /// storage fingerprints of the operands and the result are unchanged since
+  /// then, and the tensor is reassembled first otherwise.
+  void recompute();
+
+  /// Update the result in place after `operand` changed by `delta`, without
+  /// recomputing it. The change of the result (e.g. `y += dA(i,j)*x(j)` for
+  /// `y(i) = A(i,j)*x(j)`) is derived from the expression, which must be
+  /// linear in the operand. Dense results are updated with an accumulating
+  /// kernel, at a cost proportional to the size of the delta. The change of
+  /// other results is merged into them (see `merge`), which rebuilds their
+  /// index at a cost linear in the size of the result. The kernel is compiled
+  /// on first use and reused for the same operand and delta tensor.
+  /// The caller applies the delta to the operand itself.
+  void applyDelta(const TensorBase& operand, const TensorBase& delta);
+
   /// Get the source code of the kernel functions.
   std::string getSource() const;
 
+  /// Get the key of the tensor's kernels, which identifies them among
+  /// precompiled kernels (see precompiled.h). The key is made of the tensor's
+  /// expression, with the tensors and index variables renamed by the order
+  /// they appear in, the types (which kernels may be specialized to) and
+  /// formats of the tensors, and the options that change what the kernels
+  /// compute. Compiling the tensor binds it to the kernels registered under
+  /// its key, if any, instead of generating and compiling code. Options
+  /// that only change how fast the kernels run, such as parallel assembly,
+  /// are those of the tensors that the kernels were precompiled from.
+  std::string getKernelKey(bool assembleWhileCompute=false) const;
+
   /// Compile the source code of the kernel functions. This function is optional
   /// and mainly intended for experimentation. If the source code is not set
   /// then it will will be created it from the given expression.
@@ -195,6 +291,99 @@ public:
   /// Get the size of the initial index allocations.
   size_t getAllocSize() const;
 
+  /// Set whether sparse results whose other modes are dense (e.g. CSR) are
+  /// assembled in parallel, by counting the nonzeros of each row, prefix
+  /// summing the counts to size the arrays exactly, and filling the rows in
+  /// parallel. Other results are assembled serially. The two passes only pay
+  /// off when the kernels are compiled with `-fopenmp` (see `TACO_CFLAGS`), so
+  /// the default is false. The setting takes effect at the next compile.
+  void setParallelAssembly(bool parallelAssembly);
+
+  /// Set whether sparse matrix-vector products that compute a dense vector
+  /// row by row (e.g. `y(i) = A(i,j) * x(j)` with a CSR `A`) give each thread
+  /// an equal share of the nonzeros instead of the rows, which balances
+  /// matrices with a few very long rows. The default is false and takes effect
+  /// at the next compile.
+  void setNonzeroBalancing(bool nonzeroBalancing);
+
+  /// Set whether vectorized loops that sum products with a gathered operand
+  /// (e.g. `y(i) = A(i,j) * x(j)` with a CSR `A`) are computed with AVX-512 or
+  /// AVX2 intrinsics, picked at run time by the CPU features of the host, with
+  /// a scalar fallback on other hosts. The default is false and takes effect
+  /// at the next compile.
+  void setSimdIntrinsics(bool simdIntrinsics);
+
+  /// Set the target that the tensor's kernels are generated and compiled for,
+  /// e.g. a multiversioned target for kernels that must run on other
+  /// machines. The default is the target from the environment (see
+  /// `getTargetFromEnvironment`) and takes effect at the next compile.
+  void setTarget(const Target& target);
+
+  /// Get the target that the tensor's kernels are compiled for.
+  Target getTarget() const;
+
+  /// Set whether the tensor's kernels are interpreted until their library is
+  /// compiled, so that compile returns at once and the first assembles and
+  /// computes don't wait for the C compiler. The library is compiled in the
+  /// background, starting at compile or, if `threshold` is positive, once
+  /// the kernels have been called `threshold` times, and replaces the
+  /// interpreter as soon as it is ready. The default is false and takes
+  /// effect at the next compile.
+  void setTieredExecution(bool tiered, int threshold=0);
+
+  /// Set whether compile builds the tensor's kernels quickly, without
+  /// optimizations, and returns, while an optimized build runs in the
+  /// background and replaces the quick one as soon as it is ready, even if
+  /// other threads are running the kernels. The default is false and takes
+  /// effect at the next compile.
+  void setTieredCompilation(bool tiered);
+
+  /// True iff the tensor's kernels are currently interpreted. Kernels with
+  /// types that the interpreter does not support (complex and 128-bit values)
+  /// are never interpreted, even with tiered execution.
+  bool isInterpreted() const;
+
+  /// True iff the tensor's kernels run their optimized library.
+  bool isOptimized() const;
+
+  /// Wait until the optimized library of the tensor's kernels is loaded.
+  void waitForLibrary();
+
+  /// Set whether compile generates the variants of the tensor's compute
+  /// kernel that differ in nonzero balancing and SIMD intrinsics, and the
+  /// first computes run each variant with each parallel schedule and chunk
+  /// size, timed on the actual operands, before settling on the fastest. Each
+  /// candidate is run once to warm up and then timed over a few computes.
+  /// Schedules and chunk sizes are only tuned if the kernels are compiled
+  /// with OpenMP (`-fopenmp` in `TACO_CFLAGS`) and parallelized, so by
+  /// default only the variants are tuned. The winner is cached by kernel key
+  /// (see getKernelKey), so that later compiles of the same expression, types
+  /// and formats only compile the winner. The tuned schedule and chunk size
+  /// replace those of the parallel options, and autotuning overrides tiered
+  /// execution and compilation. The default is false and takes effect at the
+  /// next compile.
+  void setAutotuning(bool autotuning);
+
+  /// Get the kernel variant that autotuning picked. Returns false if
+  /// autotuning is off or hasn't finished.
+  bool getTunedVariant(KernelVariant* variant) const;
+
+  /// Set the parallel execution parameters of the tensor's kernels. They take
+  /// effect at the next assemble or compute, without recompiling.
+  void setParallelOptions(const ParallelOptions& options);
+
+  /// Get the parallel execution parameters of the tensor's kernels.
+  ParallelOptions getParallelOptions() const;
+
+  /// Get the chunk size picked by autotuning, or zero if the chunk size is not
+  /// autotuned or the tuning has not finished.
+  int getTunedChunkSize() const;
+
+  /// Set the type that the scalar temporaries of the tensor's expression
+  /// accumulate in. By default they use the type of the expression, except
+  /// that 16-bit floats accumulate in single precision.
+  void setAccumulationType(DataType type);
+
   /// Get the taco_tensor_t representation of this tensor.
   taco_tensor_t* getTacoTensorT();
 
@@ -217,10 +406,18 @@ public:
   /// Print a tensor to a stream.
   friend std::ostream& operator<<(std::ostream&, const TensorBase&);
 
+  friend void compileToStaticLibrary(const std::vector<TensorBase>&,
+                                     const std::string&, const std::string&,
+                                     bool, const Target&);
+
 private:
   struct Content;
   std::shared_ptr<Content> content;
 
+  /// Install the storage produced by a background merge, if any. Threads that
+  /// read the same tensor may call it concurrently.
+  void waitForMerge() const;
+
   std::shared_ptr<std::vector<char>> coordinateBuffer;
   size_t                             coordinateBufferUsed;
   size_t                             coordinateSize;
@@ -289,7 +486,8 @@ public:
     }
 
     bool operator==(const const_iterator& rhs) {
-      return tensor == rhs.tensor && count == rhs.count;
+      return tensor == rhs.tensor && exhausted == rhs.exhausted &&
+             (exhausted || count == rhs.count);
     }
 
     bool operator!=(const const_iterator& rhs) {
@@ -301,24 +499,30 @@ public:
 
     const_iterator(const Tensor<CType>* tensor, bool isEnd = false) : 
         tensor(tensor),
+        storage(tensor->getStorage()),
         coord(std::vector<int>(tensor->getOrder())),
         ptrs(std::vector<int>(tensor->getOrder())),
         curVal({std::vector<int>(tensor->getOrder()), 0}),
-        count(1 + (size_t)isEnd * tensor->getStorage().getIndex().getSize()),
+        count(0),
+        exhausted(isEnd),
         advance(false) {
-      advanceIndex();
+      if (!isEnd) {
+        advanceIndex();
+      }
     }
 
+    // Storage positions may be skipped (e.g. diagonal padding), so the end is
+    // marked by exhaustion rather than by the number of components
     void advanceIndex() {
-      advanceIndex(0);
+      exhausted = !advanceIndex(0);
       ++count;
     }
 
     bool advanceIndex(size_t lvl) {
       using namespace taco::storage;
 
-      const auto& modeTypes = tensor->getFormat().getModeTypes();
-      const auto& modeOrdering = tensor->getFormat().getModeOrdering();
+      const auto& modeTypes = storage.getFormat().getModeTypes();
+      const auto& modeOrdering = storage.getFormat().getModeOrdering();
 
       if (lvl == tensor->getOrder()) {
         if (advance) {
@@ -327,7 +531,9 @@ public:
         }
 
         const size_t idx = (lvl == 0) ? 0 : ptrs[lvl - 1];
-        curVal.second = ((CType *)tensor->getStorage().getValues().getData())[idx];
+        curVal.second = tensor->getComponentType().isBool()
+            ? CType(1)
+            : ((CType *)storage.getValues().getData())[idx];
 
         for (size_t i = 0; i < lvl; ++i) {
           const size_t mode = modeOrdering[i];
@@ -337,8 +543,7 @@ public:
         advance = true;
         return true;
       }
-      
-      const auto storage = tensor->getStorage();
+
       const auto modeIndex = storage.getIndex().getModeIndex(lvl);
 
       switch (modeTypes[lvl]) {
@@ -395,6 +600,22 @@ public:
                ++ptrs[lvl]) {
             coord[lvl] = ((int *)vals.getData())[ptrs[lvl]];
 
+            // Segments are padded by repeating their last index value
+            if (ptrs[lvl] > base &&
+                coord[lvl] == ((int *)vals.getData())[ptrs[lvl] - 1]) {
+              continue;
+            }
+
+            // and empty segments with index value 0 and zero values, which
+            // can't be told apart from a lone explicit zero at 0
+            if (ptrs[lvl] == base && coord[lvl] == 0 &&
+                lvl + 1 == tensor->getOrder() &&
+                ((int *)vals.getData())[base + elems - 1] == 0 &&
+                !tensor->getComponentType().isBool() &&
+                ((CType *)storage.getValues().getData())[base] == CType(0)) {
+              continue;
+            }
+
           resume_fixed:
             if (advanceIndex(lvl + 1)) {
               return true;
@@ -402,6 +623,35 @@ public:
           }
           break;
         }
+        case Diagonal: {
+          // Values are stored diagonal-major, one slot per row of the dense
+          // parent level
+          const auto  elems   = ((int *)modeIndex.getIndexArray(0).getData())[0];
+          const auto  size    = ((int *)modeIndex.getIndexArray(0).getData())[1];
+          const auto  rows    = ((int *)storage.getIndex().getModeIndex(lvl - 1)
+                                     .getIndexArray(0).getData())[0];
+          const auto  row     = ptrs[lvl - 1];
+          const auto& offsets = modeIndex.getIndexArray(1);
+
+          if (advance) {
+            goto resume_diagonal;
+          }
+
+          for (ptrs[lvl] = row; ptrs[lvl] < row + elems * rows;
+               ptrs[lvl] += rows) {
+            coord[lvl] = row +
+                ((int *)offsets.getData())[(ptrs[lvl] - row) / rows];
+            if (coord[lvl] < 0 || coord[lvl] >= size) {
+              continue;
+            }
+
+          resume_diagonal:
+            if (advanceIndex(lvl + 1)) {
+              return true;
+            }
+          }
+          break;
+        }
         default:
           taco_not_supported_yet;
           break;
@@ -411,10 +661,14 @@ public:
     }
 
     const Tensor<CType>*              tensor;
+    // the storage at construction, which a pending merge replaces in the
+    // tensor when it's first accessed
+    storage::Storage                  storage;
     std::vector<int>                  coord;
     std::vector<int>                  ptrs;
     std::pair<std::vector<int>,CType> curVal;
     size_t                            count;
+    bool                              exhausted;
     bool                              advance;
   };
 
@@ -574,6 +828,21 @@ void getCSCArrays(const TensorBase& tensor,
 }
 
 
+/// Compile the kernels of the tensors' expressions ahead of time into the
+/// static library `path/prefix.a` and its header `path/prefix.h`, for the
+/// given target. The default target is portable (see getPortableTarget), so
+/// that the library runs on older machines than the one that builds it,
+/// rather than the host's instruction set that tensors compile for. The
+/// kernels of a tensor named `A` are `prefix_A_assemble` and
+/// `prefix_A_compute`, so the tensors must have distinct names. Programs that link the library call
+/// `prefix_register()` from the header to register the kernels under their
+/// keys (see TensorBase::getKernelKey and precompiled.h), so that tensors
+/// with the same expressions, types and formats use them without compiling.
+void compileToStaticLibrary(const std::vector<TensorBase>& tensors,
+                            const std::string& path, const std::string& prefix,
+                            bool assembleWhileCompute=false,
+                            const Target& target=getPortableTarget());
+
 /// Pack the operands in the given expression.
 void packOperands(const TensorBase& tensor);
 
@@ -583,5 +852,9 @@ Tensor<CType> iterate(const TensorBase& tensor) {
   return Tensor<CType>(tensor);
 }
 
+/// Insert the stored components of `from` into `to`, which must have the same
+/// component type. The components are stored by the next `pack` or `merge`.
+void insertComponents(const TensorBase& from, TensorBase* to);
+
 }
 #endif
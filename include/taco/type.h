@@ -5,13 +5,16 @@
 #include <cstdint>
 #include <vector>
 #include <initializer_list>
+#include <utility>
 #include "taco/error.h"
 #include <complex>
 
 namespace taco {
 
 /// A basic taco type. These can be boolean, integer, unsigned integer, float
-/// or complex float at different precisions.
+/// or complex float at different precisions. The 16-bit floating point types
+/// (Float16 and BFloat16) are storage-only: generated code converts them to
+/// single precision when they are loaded and computes in single precision.
 class DataType {
 public:
   /// The kind of type this object represents.
@@ -27,6 +30,8 @@ public:
     Int32,
     Int64,
     Int128,
+    Float16,
+    BFloat16,
     Float32,
     Float64,
     Complex64,
@@ -53,6 +58,9 @@ public:
   bool isBool() const;
   /// @}
 
+  /// True if the type is one of the 16-bit floating point storage types.
+  bool isHalf() const;
+
   /// Returns the number of bytes required to store one element of this type.
   size_t getNumBytes() const;
 
@@ -82,6 +90,8 @@ DataType Int32();
 DataType Int64();
 DataType Int128();
 DataType Float(int bits = sizeof(double)*8);
+DataType Float16();
+DataType BFloat16();
 DataType Float32();
 DataType Float64();
 DataType Complex(int bits);
@@ -89,6 +99,45 @@ DataType Complex64();
 DataType Complex128();
 DataType max_type(DataType a, DataType b);
 
+/// An IEEE 754 half-precision (binary16) floating point number. It is a
+/// storage type: values convert to and from float for arithmetic.
+class float16 {
+public:
+  float16() : bits(0) {}
+  float16(float value);
+  operator float() const;
+
+  /// Returns the binary16 bit pattern.
+  uint16_t getBits() const {return bits;}
+
+  /// Construct a float16 from a binary16 bit pattern.
+  static float16 fromBits(uint16_t bits);
+
+private:
+  uint16_t bits;
+};
+
+/// A bfloat16 (brain floating point) number: the upper 16 bits of a float. It
+/// is a storage type: values convert to and from float for arithmetic.
+class bfloat16 {
+public:
+  bfloat16() : bits(0) {}
+  bfloat16(float value);
+  operator float() const;
+
+  /// Returns the bfloat16 bit pattern.
+  uint16_t getBits() const {return bits;}
+
+  /// Construct a bfloat16 from a bit pattern.
+  static bfloat16 fromBits(uint16_t bits);
+
+private:
+  uint16_t bits;
+};
+
+std::ostream& operator<<(std::ostream&, float16);
+std::ostream& operator<<(std::ostream&, bfloat16);
+
 template<typename T> inline DataType type() {
   taco_ierror << "Unsupported type";
   return Int32();
@@ -142,6 +191,14 @@ template<> inline DataType type<int8_t>() {
   return Int8();
 }
 
+template<> inline DataType type<float16>() {
+  return Float16();
+}
+
+template<> inline DataType type<bfloat16>() {
+  return BFloat16();
+}
+
 template<> inline DataType type<float>() {
   return Float32();
 }
@@ -158,6 +215,69 @@ template<> inline DataType type<std::complex<double>>() {
   return Complex128();
 }
 
+/// Calls `F<T>::apply(args...)`, where `T` is the C++ type of components of
+/// the given type, so that code templated on the component type needs only
+/// this one switch over the type kinds.
+template <template <typename> class F, typename... Args>
+inline void dispatchType(DataType type, Args&&... args) {
+  switch (type.getKind()) {
+    case DataType::Bool:
+      F<bool>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::UInt8:
+      F<uint8_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::UInt16:
+      F<uint16_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::UInt32:
+      F<uint32_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::UInt64:
+      F<uint64_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::UInt128:
+      F<unsigned long long>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Int8:
+      F<int8_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Int16:
+      F<int16_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Int32:
+      F<int32_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Int64:
+      F<int64_t>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Int128:
+      F<long long>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Float16:
+      F<float16>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::BFloat16:
+      F<bfloat16>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Float32:
+      F<float>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Float64:
+      F<double>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Complex64:
+      F<std::complex<float>>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Complex128:
+      F<std::complex<double>>::apply(std::forward<Args>(args)...);
+      break;
+    case DataType::Undefined:
+      taco_ierror;
+      break;
+  }
+}
+
 /// A tensor dimension is the size of a tensor mode.  Tensor dimensions can be
 /// variable or fixed sized, which impacts code generation.  Variable dimensions
 /// are provided to kernels as arguments, while fixed dimensions are compiled
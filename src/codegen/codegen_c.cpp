@@ -19,22 +19,165 @@ namespace ir {
 namespace {
 
 // Include stdio.h for printf
-// stdlib.h for malloc/realloc
+// stdlib.h for posix_memalign/realloc
+// string.h for memcpy
+// sys/mman.h for madvise
 // math.h for sqrt
 // MIN preprocessor macro
-// This *must* be kept in sync with taco_tensor_t.h
+// Float16/BFloat16 conversions, mirroring taco::float16 and taco::bfloat16
+// Aligned allocation helpers, mirroring storage::AlignedAllocator, used when
+// the taco_allocate/taco_reallocate allocator hooks are not linked in
+// The taco_tensor_t part *must* be kept in sync with taco_tensor_t.h
 const string cHeaders =
   "#ifndef TACO_C_HEADERS\n"
   "#define TACO_C_HEADERS\n"
+  "#ifndef _DEFAULT_SOURCE\n"
+  "#define _DEFAULT_SOURCE\n"
+  "#endif\n"
   "#include <stdio.h>\n"
   "#include <stdlib.h>\n"
   "#include <stdint.h>\n"
+  "#include <string.h>\n"
   "#include <math.h>\n"
   "#include <complex.h>\n"
+  "#include <unistd.h>\n"
+  "#include <sys/mman.h>\n"
+  "#ifdef _OPENMP\n"
+  "#include <omp.h>\n"
+  "#endif\n"
   "#define TACO_MIN(_a,_b) ((_a) < (_b) ? (_a) : (_b))\n"
+  "#define TACO_MAX(_a,_b) ((_a) > (_b) ? (_a) : (_b))\n"
+  "#define TACO_ALIGNMENT 64\n"
+  "#define TACO_HUGE_PAGE_SIZE ((size_t)1 << 21)\n"
+  "#ifndef TACO_HUGE_PAGE_THRESHOLD\n"
+  "#define TACO_HUGE_PAGE_THRESHOLD ((size_t)1 << 24)\n"
+  "#endif\n"
+  "#if defined(__GNUC__)\n"
+  "#define TACO_ASSUME_ALIGNED(_p) __builtin_assume_aligned((_p), TACO_ALIGNMENT)\n"
+  "#else\n"
+  "#define TACO_ASSUME_ALIGNED(_p) (_p)\n"
+  "#endif\n"
+  "static inline int taco_is_huge(size_t size) {\n"
+  "  return TACO_HUGE_PAGE_THRESHOLD > 0 && size >= TACO_HUGE_PAGE_THRESHOLD;\n"
+  "}\n"
+  "static inline void taco_advise_huge_pages(void* ptr, size_t size) {\n"
+  "#ifdef MADV_HUGEPAGE\n"
+  "  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);\n"
+  "  uintptr_t begin = ((uintptr_t)ptr + page - 1) & ~(page - 1);\n"
+  "  uintptr_t end = ((uintptr_t)ptr + size) & ~(page - 1);\n"
+  "  if (begin < end) madvise((void*)begin, end - begin, MADV_HUGEPAGE);\n"
+  "#endif\n"
+  "}\n"
+  "static inline void* taco_aligned_malloc(size_t size) {\n"
+  "  void* ptr = NULL;\n"
+  "  int huge = taco_is_huge(size);\n"
+  "  if (posix_memalign(&ptr, huge ? TACO_HUGE_PAGE_SIZE : TACO_ALIGNMENT,\n"
+  "                     size) != 0) return NULL;\n"
+  "  if (huge) taco_advise_huge_pages(ptr, size);\n"
+  "  return ptr;\n"
+  "}\n"
+  "static inline void* taco_aligned_realloc(void* ptr, size_t size) {\n"
+  "  void* resized;\n"
+  "  if (ptr == NULL) return taco_aligned_malloc(size);\n"
+  "  resized = realloc(ptr, size);\n"
+  "  if (resized != NULL && (uintptr_t)resized % TACO_ALIGNMENT != 0) {\n"
+  "    void* aligned = taco_aligned_malloc(size);\n"
+  "    if (aligned != NULL) memcpy(aligned, resized, size);\n"
+  "    free(resized);\n"
+  "    return aligned;\n"
+  "  }\n"
+  "  if (resized != NULL && taco_is_huge(size)) {\n"
+  "    taco_advise_huge_pages(resized, size);\n"
+  "  }\n"
+  "  return resized;\n"
+  "}\n"
+  "static inline float taco_float16_to_float(uint16_t h) {\n"
+  "#if defined(__FLT16_MAX__)\n"
+  "  _Float16 f;\n"
+  "  memcpy(&f, &h, sizeof(f));\n"
+  "  return (float)f;\n"
+  "#else\n"
+  "  uint32_t sign = (uint32_t)(h & 0x8000) << 16;\n"
+  "  uint32_t exponent = (h >> 10) & 0x1f;\n"
+  "  uint32_t significand = h & 0x3ff;\n"
+  "  uint32_t bits;\n"
+  "  float f;\n"
+  "  if (exponent == 0x1f) {\n"
+  "    bits = sign | 0x7f800000 | (significand << 13);\n"
+  "  } else if (exponent != 0) {\n"
+  "    bits = sign | ((exponent + 112) << 23) | (significand << 13);\n"
+  "  } else if (significand == 0) {\n"
+  "    bits = sign;\n"
+  "  } else {\n"
+  "    exponent = 113;\n"
+  "    while ((significand & 0x400) == 0) { significand <<= 1; exponent--; }\n"
+  "    bits = sign | (exponent << 23) | ((significand & 0x3ff) << 13);\n"
+  "  }\n"
+  "  memcpy(&f, &bits, sizeof(f));\n"
+  "  return f;\n"
+  "#endif\n"
+  "}\n"
+  "static inline uint16_t taco_float_to_float16(float f) {\n"
+  "#if defined(__FLT16_MAX__)\n"
+  "  _Float16 h = (_Float16)f;\n"
+  "  uint16_t bits;\n"
+  "  memcpy(&bits, &h, sizeof(bits));\n"
+  "  return bits;\n"
+  "#else\n"
+  "  uint32_t bits, sign, absf, half, remainder;\n"
+  "  memcpy(&bits, &f, sizeof(bits));\n"
+  "  sign = (bits >> 16) & 0x8000;\n"
+  "  absf = bits & 0x7fffffff;\n"
+  "  if (absf > 0x7f800000) return (uint16_t)(sign | 0x7e00);\n"
+  "  if (absf >= 0x477ff000) return (uint16_t)(sign | 0x7c00);\n"
+  "  if (absf < 0x38800000) {\n"
+  "    int shift = 126 - (int)(absf >> 23);\n"
+  "    uint32_t significand = (absf & 0x7fffff) | 0x800000;\n"
+  "    if (shift > 24) return (uint16_t)sign;\n"
+  "    half = significand >> shift;\n"
+  "    remainder = significand & ((1u << shift) - 1);\n"
+  "    if (remainder > (1u << (shift - 1)) ||\n"
+  "        (remainder == (1u << (shift - 1)) && (half & 1))) half++;\n"
+  "    return (uint16_t)(sign | half);\n"
+  "  }\n"
+  "  half = (absf - 0x38000000) >> 13;\n"
+  "  remainder = absf & 0x1fff;\n"
+  "  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) half++;\n"
+  "  return (uint16_t)(sign | half);\n"
+  "#endif\n"
+  "}\n"
+  "static inline float taco_bfloat16_to_float(uint16_t h) {\n"
+  "  uint32_t bits = (uint32_t)h << 16;\n"
+  "  float f;\n"
+  "  memcpy(&f, &bits, sizeof(f));\n"
+  "  return f;\n"
+  "}\n"
+  "static inline uint16_t taco_float_to_bfloat16(float f) {\n"
+  "  uint32_t bits;\n"
+  "  memcpy(&bits, &f, sizeof(bits));\n"
+  "  if ((bits & 0x7fffffff) > 0x7f800000) return (uint16_t)((bits >> 16) | 0x40);\n"
+  "  return (uint16_t)((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);\n"
+  "}\n"
+  "#if defined(__GNUC__)\n"
+  "void* taco_allocate(size_t size) __attribute__((weak));\n"
+  "void* taco_reallocate(void* ptr, size_t size) __attribute__((weak));\n"
+  "#endif\n"
+  "static inline void* taco_malloc(size_t size) {\n"
+  "#if defined(__GNUC__)\n"
+  "  if (taco_allocate != NULL) return taco_allocate(size);\n"
+  "#endif\n"
+  "  return taco_aligned_malloc(size);\n"
+  "}\n"
+  "static inline void* taco_realloc(void* ptr, size_t size) {\n"
+  "#if defined(__GNUC__)\n"
+  "  if (taco_reallocate != NULL) return taco_reallocate(ptr, size);\n"
+  "#endif\n"
+  "  return taco_aligned_realloc(ptr, size);\n"
+  "}\n"
   "#ifndef TACO_TENSOR_T_DEFINED\n"
   "#define TACO_TENSOR_T_DEFINED\n"
-  "typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;\n"
+  "typedef enum { taco_mode_dense, taco_mode_sparse, taco_mode_fixed,\n"
+  "               taco_mode_diagonal } taco_mode_t;\n"
   "typedef struct {\n"
   "  int32_t      order;         // tensor order (number of modes)\n"
   "  int32_t*     dimensions;    // tensor dimensions\n"
@@ -47,6 +190,184 @@ const string cHeaders =
   "#endif\n"
   "#endif\n";
 
+// The parallel execution parameters of the kernels of a module, which the
+// runtime sets through taco_set_parallel before calling them. Parallel loops
+// use schedule(runtime), so that the schedule and chunk size can change
+// without recompiling; taco_begin_schedule sets them for the calling thread
+// (a zero schedule or chunk size keeps the loop's own) and taco_end_schedule
+// restores the previous ones.
+const string cParallelRuntime =
+  "static int32_t taco_parallelize = 1;\n"
+  "static int32_t taco_num_threads = 0;\n"
+  "static int32_t taco_schedule = 0;\n"
+  "static int32_t taco_chunk_size = 0;\n"
+  "void taco_set_parallel(int32_t parallelize, int32_t num_threads,\n"
+  "                       int32_t schedule, int32_t chunk_size) {\n"
+  "  taco_parallelize = parallelize;\n"
+  "  taco_num_threads = num_threads;\n"
+  "  taco_schedule = schedule;\n"
+  "  taco_chunk_size = chunk_size;\n"
+  "}\n"
+  "static inline int taco_get_num_threads(void) {\n"
+  "#ifdef _OPENMP\n"
+  "  if (!taco_parallelize) return 1;\n"
+  "  return taco_num_threads > 0 ? taco_num_threads : omp_get_max_threads();\n"
+  "#else\n"
+  "  return 1;\n"
+  "#endif\n"
+  "}\n"
+  "#ifdef _OPENMP\n"
+  "typedef struct { omp_sched_t kind; int chunk_size; } taco_schedule_t;\n"
+  "#else\n"
+  "typedef int taco_schedule_t;\n"
+  "#endif\n"
+  "static inline taco_schedule_t taco_begin_schedule(int32_t schedule,\n"
+  "                                                  int32_t chunk_size) {\n"
+  "  taco_schedule_t saved;\n"
+  "#ifdef _OPENMP\n"
+  "  omp_get_schedule(&saved.kind, &saved.chunk_size);\n"
+  "  if (taco_schedule > 0) {\n"
+  "    schedule = taco_schedule;\n"
+  "    chunk_size = taco_chunk_size;\n"
+  "  } else if (taco_chunk_size > 0) {\n"
+  "    chunk_size = taco_chunk_size;\n"
+  "  }\n"
+  "  omp_set_schedule(schedule == 3 ? omp_sched_guided :\n"
+  "                   schedule == 2 ? omp_sched_dynamic : omp_sched_static,\n"
+  "                   chunk_size);\n"
+  "#else\n"
+  "  saved = 0;\n"
+  "#endif\n"
+  "  return saved;\n"
+  "}\n"
+  "static inline void taco_end_schedule(taco_schedule_t saved) {\n"
+  "#ifdef _OPENMP\n"
+  "  omp_set_schedule(saved.kind, saved.chunk_size);\n"
+  "#endif\n"
+  "}\n";
+
+// The gather-dot kernels that vectorized loops of the form
+// `t += vals[p] * x[idx[p]]` call when the code generator emits SIMD
+// intrinsics. Each has an AVX-512 and an AVX2+FMA version, compiled for their
+// instruction sets with target attributes, that gather x, multiply-add into
+// vector accumulators, reduce them horizontally and finish the remainder of
+// the range with a scalar loop. The instruction set is picked once, when the
+// library is loaded, from the CPU features of the host; other hosts and
+// compilers use the scalar loop.
+const string cSimdRuntime =
+  "#if defined(__GNUC__) && defined(__x86_64__)\n"
+  "#include <immintrin.h>\n"
+  "#define TACO_X86_INTRINSICS 1\n"
+  "#endif\n"
+  "static int taco_simd_level = 0; // 0 scalar, 1 AVX2+FMA, 2 AVX-512\n"
+  "#ifdef TACO_X86_INTRINSICS\n"
+  "__attribute__((constructor)) static void taco_init_simd_level(void) {\n"
+  "  __builtin_cpu_init();\n"
+  "  if (__builtin_cpu_supports(\"avx512f\")) taco_simd_level = 2;\n"
+  "  else if (__builtin_cpu_supports(\"avx2\") &&\n"
+  "           __builtin_cpu_supports(\"fma\")) taco_simd_level = 1;\n"
+  "}\n"
+  "__attribute__((target(\"avx512f\")))\n"
+  "static double taco_gather_dot_f64_avx512(const double* vals, const int* idx,\n"
+  "                                         const double* x, int begin, int end) {\n"
+  "  __m512d sum = _mm512_setzero_pd();\n"
+  "  int p = begin;\n"
+  "  for (; p + 8 <= end; p += 8) {\n"
+  "    __m256i i = _mm256_loadu_si256((const __m256i*)(idx + p));\n"
+  "    sum = _mm512_fmadd_pd(_mm512_loadu_pd(vals + p),\n"
+  "                          _mm512_i32gather_pd(i, x, 8), sum);\n"
+  "  }\n"
+  "  double r = _mm512_reduce_add_pd(sum);\n"
+  "  for (; p < end; p++) r += vals[p] * x[idx[p]];\n"
+  "  return r;\n"
+  "}\n"
+  "__attribute__((target(\"avx2,fma\")))\n"
+  "static double taco_gather_dot_f64_avx2(const double* vals, const int* idx,\n"
+  "                                       const double* x, int begin, int end) {\n"
+  "  __m256d sum = _mm256_setzero_pd();\n"
+  "  int p = begin;\n"
+  "  for (; p + 4 <= end; p += 4) {\n"
+  "    __m128i i = _mm_loadu_si128((const __m128i*)(idx + p));\n"
+  "    sum = _mm256_fmadd_pd(_mm256_loadu_pd(vals + p),\n"
+  "                          _mm256_i32gather_pd(x, i, 8), sum);\n"
+  "  }\n"
+  "  __m128d h = _mm_add_pd(_mm256_castpd256_pd128(sum),\n"
+  "                         _mm256_extractf128_pd(sum, 1));\n"
+  "  double r = _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));\n"
+  "  for (; p < end; p++) r += vals[p] * x[idx[p]];\n"
+  "  return r;\n"
+  "}\n"
+  "__attribute__((target(\"avx512f\")))\n"
+  "static float taco_gather_dot_f32_avx512(const float* vals, const int* idx,\n"
+  "                                        const float* x, int begin, int end) {\n"
+  "  __m512 sum = _mm512_setzero_ps();\n"
+  "  int p = begin;\n"
+  "  for (; p + 16 <= end; p += 16) {\n"
+  "    __m512i i = _mm512_loadu_si512((const void*)(idx + p));\n"
+  "    sum = _mm512_fmadd_ps(_mm512_loadu_ps(vals + p),\n"
+  "                          _mm512_i32gather_ps(i, x, 4), sum);\n"
+  "  }\n"
+  "  float r = _mm512_reduce_add_ps(sum);\n"
+  "  for (; p < end; p++) r += vals[p] * x[idx[p]];\n"
+  "  return r;\n"
+  "}\n"
+  "__attribute__((target(\"avx2,fma\")))\n"
+  "static float taco_gather_dot_f32_avx2(const float* vals, const int* idx,\n"
+  "                                      const float* x, int begin, int end) {\n"
+  "  __m256 sum = _mm256_setzero_ps();\n"
+  "  int p = begin;\n"
+  "  for (; p + 8 <= end; p += 8) {\n"
+  "    __m256i i = _mm256_loadu_si256((const __m256i*)(idx + p));\n"
+  "    sum = _mm256_fmadd_ps(_mm256_loadu_ps(vals + p),\n"
+  "                          _mm256_i32gather_ps(x, i, 4), sum);\n"
+  "  }\n"
+  "  __m128 h = _mm_add_ps(_mm256_castps256_ps128(sum),\n"
+  "                        _mm256_extractf128_ps(sum, 1));\n"
+  "  h = _mm_add_ps(h, _mm_movehl_ps(h, h));\n"
+  "  h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));\n"
+  "  float r = _mm_cvtss_f32(h);\n"
+  "  for (; p < end; p++) r += vals[p] * x[idx[p]];\n"
+  "  return r;\n"
+  "}\n"
+  "#endif\n"
+  "static inline double taco_gather_dot_f64(const double* vals, const int* idx,\n"
+  "                                         const double* x, int begin, int end) {\n"
+  "#ifdef TACO_X86_INTRINSICS\n"
+  "  if (taco_simd_level == 2)\n"
+  "    return taco_gather_dot_f64_avx512(vals, idx, x, begin, end);\n"
+  "  if (taco_simd_level == 1)\n"
+  "    return taco_gather_dot_f64_avx2(vals, idx, x, begin, end);\n"
+  "#endif\n"
+  "  double r = 0;\n"
+  "  for (int p = begin; p < end; p++) r += vals[p] * x[idx[p]];\n"
+  "  return r;\n"
+  "}\n"
+  "static inline float taco_gather_dot_f32(const float* vals, const int* idx,\n"
+  "                                        const float* x, int begin, int end) {\n"
+  "#ifdef TACO_X86_INTRINSICS\n"
+  "  if (taco_simd_level == 2)\n"
+  "    return taco_gather_dot_f32_avx512(vals, idx, x, begin, end);\n"
+  "  if (taco_simd_level == 1)\n"
+  "    return taco_gather_dot_f32_avx2(vals, idx, x, begin, end);\n"
+  "#endif\n"
+  "  float r = 0;\n"
+  "  for (int p = begin; p < end; p++) r += vals[p] * x[idx[p]];\n"
+  "  return r;\n"
+  "}\n";
+
+// Function multiversioning: GCC builds a clone of each function marked with
+// TACO_TARGET_CLONES per listed architecture, and an ifunc resolver that picks
+// one when the library is loaded.  Elsewhere the functions are generic.
+const string cTargetClones =
+  "#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \\\n"
+  "    defined(__linux__)\n"
+  "#define TACO_TARGET_CLONES \\\n"
+  "  __attribute__((target_clones(\"arch=skylake-avx512\", \"arch=haswell\", \\\n"
+  "                               \"default\")))\n"
+  "#else\n"
+  "#define TACO_TARGET_CLONES\n"
+  "#endif\n";
+
 // find variables for generating declarations
 // also only generates a single var for each GetProperty
 class FindVars : public IRVisitor {
@@ -159,16 +480,19 @@ string toCType(DataType type, bool is_ptr) {
 }
 
 string unpackTensorProperty(string varname, const GetProperty* op,
-                            bool is_output_prop) {
+                            bool is_output_prop, bool assumeAligned) {
   stringstream ret;
   ret << "  ";
   
+  // arrays are only hinted as aligned when the allocator guarantees it
+  string alignedOpen = assumeAligned ? "TACO_ASSUME_ALIGNED(" : "(";
+  
   auto tensor = op->tensor.as<Var>();
   if (op->property == TensorProperty::Values) {
     // for the values, it's in the last slot
     ret << toCType(tensor->type, true);
-    ret << " restrict " << varname << " = (" << toCType(tensor->type, true) << ")(";
-    ret << tensor->name << "->vals);\n";
+    ret << " restrict " << varname << " = (" << toCType(tensor->type, true) << ")";
+    ret << alignedOpen << tensor->name << "->vals);\n";
     return ret.str();
   }
   
@@ -191,7 +515,7 @@ string unpackTensorProperty(string varname, const GetProperty* op,
     tp = "int*";
     auto nm = op->index;
     ret << tp << " restrict " << varname << " = ";
-    ret << "(int*)(" << tensor->name << "->indices[" << op->mode;
+    ret << "(int*)" << alignedOpen << tensor->name << "->indices[" << op->mode;
     ret << "][" << nm << "]);\n";
   }
   
@@ -237,7 +561,8 @@ string packTensorProperty(string varname, Expr tnsr, TensorProperty property,
   
 // helper to print declarations
 string printDecls(map<Expr, string, ExprCompare> varMap,
-                   vector<Expr> inputs, vector<Expr> outputs) {
+                   vector<Expr> inputs, vector<Expr> outputs,
+                   bool assumeAligned) {
   stringstream ret;
   unordered_set<string> propsAlreadyGenerated;
   
@@ -283,7 +608,8 @@ string printDecls(map<Expr, string, ExprCompare> varMap,
   for (auto prop: sortedProps) {
     bool isOutputProp = (find(outputs.begin(), outputs.end(),
                           prop->tensor) != outputs.end());
-    ret << unpackTensorProperty(varMap[prop], prop, isOutputProp);
+    ret << unpackTensorProperty(varMap[prop], prop, isOutputProp,
+                                assumeAligned);
     propsAlreadyGenerated.insert(varMap[prop]);
   }
 
@@ -455,8 +781,12 @@ string CodeGen_C::genUniqueName(string name) {
   return os.str();
 }
 
-CodeGen_C::CodeGen_C(std::ostream &dest, OutputKind outputKind)
-    : IRPrinter(dest, false, true), out(dest), outputKind(outputKind) {}
+CodeGen_C::CodeGen_C(std::ostream &dest, OutputKind outputKind,
+                     bool assumeAligned, bool simdIntrinsics,
+                     bool multiversion)
+    : IRPrinter(dest, false, true), out(dest), outputKind(outputKind),
+      assumeAligned(assumeAligned), simdIntrinsics(simdIntrinsics),
+      multiversion(multiversion) {}
 
 CodeGen_C::~CodeGen_C() {}
 
@@ -464,6 +794,15 @@ void CodeGen_C::compile(Stmt stmt, bool isFirst) {
   if (isFirst) {
     // output the headers
     out << cHeaders;
+    if (outputKind == C99Implementation) {
+      out << cParallelRuntime;
+      if (simdIntrinsics) {
+        out << cSimdRuntime;
+      }
+      if (multiversion) {
+        out << cTargetClones;
+      }
+    }
   }
   out << endl;
   // generate code for the Stmt
@@ -479,6 +818,10 @@ void CodeGen_C::visit(const Function* func) {
 
   // output function declaration
   doIndent();
+  if (multiversion && outputKind == C99Implementation) {
+    out << "TACO_TARGET_CLONES\n";
+    doIndent();
+  }
   out << printFuncName(func);
   
   // if we're just generating a header, this is all we need to do
@@ -500,7 +843,7 @@ void CodeGen_C::visit(const Function* func) {
 
   // Print variable declarations
   out << printDecls(varFinder.varDecls,
-                    func->inputs, func->outputs);
+                    func->inputs, func->outputs, assumeAligned);
 
   // output body
   out << endl;
@@ -543,37 +886,175 @@ static string genVectorizePragma(int width) {
   return ret.str();
 }
 
-static string getParallelizePragma(LoopKind kind) {
+// OpenMP SIMD pragmas are understood by GCC and Clang alike (with -fopenmp or
+// -fopenmp-simd), unlike the clang loop hints
+static string getSimdPragma(int width) {
   stringstream ret;
-  ret << "#pragma omp parallel for";
-  if (kind == LoopKind::Dynamic) {
-    ret << " schedule(dynamic, 16)";
+  ret << "#pragma omp simd";
+  if (width) {
+    ret << " simdlen(" << width << ")";
   }
   return ret.str();
 }
 
+// The schedule (1 static, 2 dynamic) and chunk size of a parallel loop, unless
+// the runtime overrides them
+static string getScheduleArgs(LoopKind kind) {
+  return (kind == LoopKind::Dynamic) ? "2, 16" : "1, 0";
+}
+
+static string getParallelizePragma(LoopKind kind) {
+  stringstream ret;
+  ret << "#pragma omp parallel for schedule(runtime) if(taco_parallelize) "
+         "num_threads(taco_get_num_threads())";
+  return ret.str();
+}
+
+// Collect the statements of a statement, looking through blocks and scopes
+static void getStatements(Stmt stmt, vector<Stmt>* stmts) {
+  if (!stmt.defined()) {
+    return;
+  }
+  if (isa<Block>(stmt)) {
+    for (auto& s : to<Block>(stmt)->contents) {
+      getStatements(s, stmts);
+    }
+  } else if (isa<Scope>(stmt)) {
+    getStatements(to<Scope>(stmt)->scopedStmt, stmts);
+  } else {
+    stmts->push_back(stmt);
+  }
+}
+
+// Recognizes a vectorized reduction loop of the form
+//   for (p = begin; p < end; p++) {
+//     idx = idx_arr[p];
+//     t += vals[p] * x[idx];
+//   }
+// and emits `t += taco_gather_dot_<type>(vals, idx_arr, x, begin, end);`
+bool CodeGen_C::emitGatherDot(const For* op) {
+  auto increment = op->increment.as<Literal>();
+  if (!simdIntrinsics || op->kind != LoopKind::Vectorized ||
+      !op->reduction_var.defined() || op->reduction_size.defined() ||
+      increment == nullptr || !increment->equalsScalar(1)) {
+    return false;
+  }
+  vector<Stmt> stmts;
+  getStatements(op->contents, &stmts);
+  if (stmts.size() != 2 || !isa<VarAssign>(stmts[0]) ||
+      !isa<VarAssign>(stmts[1])) {
+    return false;
+  }
+
+  auto idxAssign = to<VarAssign>(stmts[0]);
+  auto update = to<VarAssign>(stmts[1]);
+  if (!idxAssign->is_decl || !isa<Load>(idxAssign->rhs) ||
+      to<Load>(idxAssign->rhs)->loc != op->var ||
+      update->is_decl || update->lhs != op->reduction_var ||
+      !isa<Add>(update->rhs) || to<Add>(update->rhs)->a != update->lhs ||
+      !isa<Mul>(to<Add>(update->rhs)->b)) {
+    return false;
+  }
+  auto idx = to<Load>(idxAssign->rhs);
+  auto mul = to<Mul>(to<Add>(update->rhs)->b);
+  if (!isa<Load>(mul->a) || !isa<Load>(mul->b)) {
+    return false;
+  }
+  auto vals = to<Load>(mul->a);
+  auto gathered = to<Load>(mul->b);
+  if (gathered->loc == op->var) {
+    swap(vals, gathered);
+  }
+  if (vals->loc != op->var || gathered->loc != idxAssign->lhs) {
+    return false;
+  }
+
+  DataType type = update->lhs.type();
+  string suffix;
+  if (type.getKind() == DataType::Float64) {
+    suffix = "f64";
+  } else if (type.getKind() == DataType::Float32) {
+    suffix = "f32";
+  } else {
+    return false;
+  }
+  if (!(vals->type == type) || !(gathered->type == type)) {
+    return false;
+  }
+
+  doIndent();
+  op->reduction_var.accept(this);
+  out << " += taco_gather_dot_" << suffix << "(";
+  vals->arr.accept(this);
+  out << ", ";
+  idx->arr.accept(this);
+  out << ", ";
+  gathered->arr.accept(this);
+  out << ", ";
+  op->start.accept(this);
+  out << ", ";
+  op->end.accept(this);
+  out << ");";
+  return true;
+}
+
 // The next two need to output the correct pragmas depending
 // on the loop kind (Serial, Static, Dynamic, Vectorized)
 //
 // Docs for vectorization pragmas:
 // http://clang.llvm.org/docs/LanguageExtensions.html#extensions-for-loop-hint-optimizations
+// https://www.openmp.org/spec-html/5.0/openmpsu42.html
 void CodeGen_C::visit(const For* op) {
+  if (emitGatherDot(op)) {
+    return;
+  }
+
+  auto printReduction = [&]() {
+    if (op->reduction_var.defined()) {
+      out << " reduction(+:";
+      op->reduction_var.accept(this);
+      if (op->reduction_size.defined()) {
+        out << "[0:";
+        op->reduction_size.accept(this);
+        out << "]";
+      }
+      out << ")";
+    }
+  };
+
   switch (op->kind) {
     case LoopKind::Vectorized:
       doIndent();
-      out << genVectorizePragma(op->vec_width);
+      out << getSimdPragma(op->vec_width);
+      printReduction();
       out << "\n";
       break;
     case LoopKind::Static:
     case LoopKind::Dynamic:
       doIndent();
+      out << "{\n";
+      indent++;
+      doIndent();
+      out << "taco_schedule_t taco_saved_schedule = taco_begin_schedule("
+          << getScheduleArgs(op->kind) << ");\n";
+      doIndent();
       out << getParallelizePragma(op->kind);
+      printReduction();
       out << "\n";
     default:
       break;
   }
   
   IRPrinter::visit(op);
+
+  if (op->kind == LoopKind::Static || op->kind == LoopKind::Dynamic) {
+    out << "\n";
+    doIndent();
+    out << "taco_end_schedule(taco_saved_schedule);\n";
+    indent--;
+    doIndent();
+    out << "}";
+  }
 }
 
 void CodeGen_C::visit(const While* op) {
@@ -612,6 +1093,14 @@ void CodeGen_C::visit(const Min* op) {
 
 }
 
+void CodeGen_C::visit(const Max* op) {
+  stream << "TACO_MAX(";
+  op->a.accept(this);
+  stream << ",";
+  op->b.accept(this);
+  stream << ")";
+}
+
 void CodeGen_C::visit(const Allocate* op) {
   string elementType = toCType(op->var.type(), false);
 
@@ -621,12 +1110,12 @@ void CodeGen_C::visit(const Allocate* op) {
   stream << elementType << "*";
   stream << ")";
   if (op->is_realloc) {
-    stream << "realloc(";
+    stream << "taco_realloc(";
     op->var.accept(this);
     stream << ", ";
   }
   else {
-    stream << "malloc(";
+    stream << "taco_malloc(";
   }
   stream << "sizeof(" << elementType << ")";
   stream << " * ";
@@ -634,6 +1123,42 @@ void CodeGen_C::visit(const Allocate* op) {
   stream << ");";
 }
 
+// 16-bit floating point values are stored as raw bits, and converted to and
+// from single precision when they are loaded and stored
+void CodeGen_C::visit(const Load* op) {
+  if (!op->type.isHalf()) {
+    IRPrinter::visit(op);
+    return;
+  }
+  stream << (op->type == Float16() ? "taco_float16_to_float("
+                                   : "taco_bfloat16_to_float(");
+  IRPrinter::visit(op);
+  stream << ")";
+}
+
+void CodeGen_C::visit(const Store* op) {
+  if (op->use_atomics) {
+    doIndent();
+    out << "#pragma omp atomic\n";
+  }
+  DataType type = op->arr.type();
+  if (!type.isHalf()) {
+    IRPrinter::visit(op);
+    return;
+  }
+  doIndent();
+  op->arr.accept(this);
+  stream << "[";
+  op->loc.accept(this);
+  stream << "] = ";
+  stream << (type == Float16() ? "taco_float_to_float16("
+                               : "taco_float_to_bfloat16(");
+  omitNextParen = true;
+  op->data.accept(this);
+  omitNextParen = false;
+  stream << ");";
+}
+
 void CodeGen_C::visit(const Sqrt* op) {
   taco_tassert(op->type.isFloat() && op->type.getNumBits() == 64) <<
       "Codegen doesn't currently support non-double sqrt";
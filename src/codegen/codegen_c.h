@@ -17,8 +17,17 @@ public:
   enum OutputKind { C99Header, C99Implementation };
 
   /// Initialize a code generator that generates code to an
-  /// output stream.
-  CodeGen_C(std::ostream &dest, OutputKind outputKind);
+  /// output stream. If `assumeAligned` is set, the generated code tells the
+  /// C compiler that all tensor arrays are `storage::ARRAY_ALIGNMENT`-aligned.
+  /// If `simdIntrinsics` is set, vectorized loops that sum the products of
+  /// an array and a gathered array (e.g. the rows of a CSR matrix-vector
+  /// product) call AVX-512/AVX2 intrinsic kernels picked at run time by the
+  /// CPU features of the host, with a scalar fallback. If `multiversion` is
+  /// set, each function is cloned for AVX-512, AVX2 and generic x86 machines
+  /// and the dynamic loader picks the clone for the host.
+  CodeGen_C(std::ostream &dest, OutputKind outputKind,
+            bool assumeAligned=false, bool simdIntrinsics=false,
+            bool multiversion=false);
   ~CodeGen_C();
 
   /// Compile a lowered function
@@ -39,13 +48,23 @@ protected:
   void visit(const While*);
   void visit(const GetProperty*);
   void visit(const Min*);
+  void visit(const Max*);
   void visit(const Allocate*);
+  void visit(const Load*);
+  void visit(const Store*);
   void visit(const Sqrt*);
 
+  /// Emit a call to a gather-dot intrinsic kernel in place of a vectorized
+  /// loop that matches its pattern. Returns false if the loop does not match.
+  bool emitGatherDot(const For*);
+
   std::map<Expr, std::string, ExprCompare> varMap;
   std::ostream &out;
   
   OutputKind outputKind;
+  bool assumeAligned;
+  bool simdIntrinsics;
+  bool multiversion;
 };
 
 } // namespace ir
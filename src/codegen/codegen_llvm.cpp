@@ -0,0 +1,897 @@
+#include "codegen_llvm.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include "taco/error.h"
+#include "taco/ir/ir_visitor.h"
+#include "taco/util/collections.h"
+
+#ifdef TACO_LLVM
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#endif
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+#ifdef TACO_LLVM
+
+namespace {
+
+typedef tuple<Expr, TensorProperty, int, int> PropertyKey;
+
+// Check if a function has an Allocate node, in which case the properties of
+// its outputs are stored back into their taco_tensor_t structs
+class CheckForAlloc : public IRVisitor {
+public:
+  bool hasAlloc = false;
+protected:
+  using IRVisitor::visit;
+  void visit(const Allocate *op) {
+    hasAlloc = true;
+  }
+};
+
+// Translates lowered functions to LLVM IR.  Every variable and tensor
+// property lives in a stack slot, which LLVM promotes to a register.  The
+// function's entry block holds the slots, the next block unpacks the tensor
+// properties from their taco_tensor_t structs, and the body follows.
+class LLVMGenerator : public IRVisitorStrict {
+public:
+  LLVMGenerator(llvm::Module* module)
+      : module(module), context(module->getContext()), builder(context) {
+    llvm::FastMathFlags fastMath;
+    fastMath.setFast();
+    builder.setFastMathFlags(fastMath);
+
+    // must match the taco_tensor_t struct of the C runtime
+    llvm::Type* i32 = builder.getInt32Ty();
+    llvm::Type* i8Ptr = builder.getInt8PtrTy();
+    tensorType = llvm::StructType::create(context,
+        {i32, i32->getPointerTo(), i32, i32->getPointerTo(),
+         i32->getPointerTo(), i8Ptr->getPointerTo()->getPointerTo(), i8Ptr},
+        "taco_tensor_t");
+  }
+
+  void compile(Stmt func) {
+    func.accept(this);
+  }
+
+  /// Generate `int _shim_<name>(void** parameterPack)`.
+  void compileShim(const Function* func) {
+    llvm::Type* packType = builder.getInt8PtrTy()->getPointerTo();
+    llvm::Function* shim = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getInt32Ty(), {packType}, false),
+        llvm::Function::ExternalLinkage, "_shim_" + func->name, module);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", shim));
+
+    llvm::Function* callee = module->getFunction(func->name);
+    vector<llvm::Value*> args;
+    for (size_t i = 0; i < callee->arg_size(); i++) {
+      llvm::Value* arg = builder.CreateLoad(builder.getInt8PtrTy(),
+          builder.CreateConstInBoundsGEP1_64(builder.getInt8PtrTy(),
+                                             shim->getArg(0), i));
+      llvm::Type* type = callee->getArg(i)->getType();
+      if (type->isPointerTy()) {
+        arg = builder.CreateBitCast(arg, type);
+      } else {
+        taco_uassert(type->isIntegerTy()) << "The LLVM backend does not "
+            "support floating-point arguments";
+        arg = builder.CreatePtrToInt(arg, type);
+      }
+      args.push_back(arg);
+    }
+    builder.CreateRet(builder.CreateCall(callee, args));
+  }
+
+private:
+  llvm::Module* module;
+  llvm::LLVMContext& context;
+  llvm::IRBuilder<> builder;
+  llvm::StructType* tensorType;
+
+  llvm::BasicBlock* entry = nullptr;
+  llvm::BasicBlock* unpack = nullptr;
+
+  // the value of the last visited expression
+  llvm::Value* value = nullptr;
+
+  map<Expr, llvm::Value*, ExprCompare> tensors;
+  map<Expr, llvm::Value*, ExprCompare> slots;
+  map<PropertyKey, llvm::Value*> propertySlots;
+  vector<PropertyKey> outputProperties;
+  vector<Expr> outputs;
+
+  llvm::Value* eval(Expr expr) {
+    expr.accept(this);
+    return value;
+  }
+
+  llvm::Type* getType(DataType type) {
+    taco_uassert(!type.isHalf() && !type.isComplex()) <<
+        "The LLVM backend does not support " << type << " values";
+    if (type.isBool()) {
+      return builder.getInt1Ty();
+    } else if (type.isInt() || type.isUInt()) {
+      return builder.getIntNTy(type.getNumBits());
+    }
+    taco_iassert(type.isFloat()) << "Undefined type in IR";
+    return (type.getNumBits() == 32) ? builder.getFloatTy()
+                                     : builder.getDoubleTy();
+  }
+
+  llvm::Value* createSlot(llvm::Type* type, const string& name) {
+    llvm::IRBuilder<> entryBuilder(entry->getTerminator());
+    return entryBuilder.CreateAlloca(type, nullptr, name);
+  }
+
+  llvm::Value* getSlot(Expr expr) {
+    if (isa<GetProperty>(expr)) {
+      return getPropertySlot(to<GetProperty>(expr));
+    }
+    taco_iassert(isa<Var>(expr)) << "Can only assign to variables";
+    if (slots.count(expr) == 0) {
+      auto var = to<Var>(expr);
+      llvm::Type* type = getType(var->type);
+      slots[expr] = createSlot(var->is_ptr ? type->getPointerTo() : type,
+                               var->name);
+    }
+    return slots.at(expr);
+  }
+
+  llvm::Type* getSlotType(llvm::Value* slot) {
+    return llvm::cast<llvm::AllocaInst>(slot)->getAllocatedType();
+  }
+
+  // Unpack a tensor property like CodeGen_C's unpackTensorProperty
+  llvm::Value* getPropertySlot(const GetProperty* op) {
+    PropertyKey key(op->tensor, op->property, op->mode, op->index);
+    if (propertySlots.count(key) > 0) {
+      return propertySlots.at(key);
+    }
+
+    llvm::IRBuilder<> unpackBuilder(unpack->getTerminator());
+    taco_iassert(tensors.count(op->tensor)) << "Unknown tensor " << op->tensor;
+    llvm::Value* tensor = tensors.at(op->tensor);
+    auto tensorVar = to<Var>(op->tensor);
+    llvm::Type* i8Ptr = builder.getInt8PtrTy();
+    llvm::Value* property;
+    bool isDimension = false;
+    if (op->property == TensorProperty::Values) {
+      llvm::Value* vals = unpackBuilder.CreateLoad(i8Ptr,
+          unpackBuilder.CreateStructGEP(tensorType, tensor, 6));
+      property = unpackBuilder.CreateBitCast(vals,
+          getType(tensorVar->type)->getPointerTo(), op->name);
+    } else {
+      taco_iassert((size_t)op->mode < tensorVar->format.getOrder()) <<
+          "Trying to access a nonexistent mode";
+      ModeType modeType = tensorVar->format.getModeTypes()[op->mode];
+      isDimension = op->property == TensorProperty::Dimension &&
+                    (modeType == ModeType::Dense ||
+                     modeType == ModeType::Fixed);
+      llvm::Value* indices = unpackBuilder.CreateLoad(
+          i8Ptr->getPointerTo()->getPointerTo(),
+          unpackBuilder.CreateStructGEP(tensorType, tensor, 5));
+      llvm::Value* modeIndex = unpackBuilder.CreateLoad(
+          i8Ptr->getPointerTo(), unpackBuilder.CreateConstInBoundsGEP1_64(
+          i8Ptr->getPointerTo(), indices, op->mode));
+      llvm::Value* array = unpackBuilder.CreateLoad(i8Ptr,
+          unpackBuilder.CreateConstInBoundsGEP1_64(i8Ptr, modeIndex,
+                                                   isDimension ? 0 : op->index));
+      llvm::Type* i32Ptr = builder.getInt32Ty()->getPointerTo();
+      property = unpackBuilder.CreateBitCast(array, i32Ptr);
+      if (isDimension) {
+        property = unpackBuilder.CreateLoad(builder.getInt32Ty(), property,
+                                            op->name);
+      }
+    }
+
+    llvm::Value* slot = createSlot(property->getType(), op->name);
+    unpackBuilder.CreateStore(property, slot);
+    propertySlots[key] = slot;
+    if (util::contains(outputs, op->tensor) && !isDimension) {
+      outputProperties.push_back(key);
+    }
+    return slot;
+  }
+
+  // Store the (possibly reallocated) arrays of the outputs back into their
+  // taco_tensor_t structs, like CodeGen_C's printPack
+  void packOutputProperties() {
+    llvm::Type* i8Ptr = builder.getInt8PtrTy();
+    for (auto& key : outputProperties) {
+      llvm::Value* slot = propertySlots.at(key);
+      llvm::Value* array = builder.CreateBitCast(
+          builder.CreateLoad(getSlotType(slot), slot), i8Ptr);
+      llvm::Value* tensor = tensors.at(get<0>(key));
+      if (get<1>(key) == TensorProperty::Values) {
+        builder.CreateStore(array,
+                            builder.CreateStructGEP(tensorType, tensor, 6));
+      } else {
+        llvm::Value* indices = builder.CreateLoad(
+            i8Ptr->getPointerTo()->getPointerTo(),
+            builder.CreateStructGEP(tensorType, tensor, 5));
+        llvm::Value* modeIndex = builder.CreateLoad(i8Ptr->getPointerTo(),
+            builder.CreateConstInBoundsGEP1_64(i8Ptr->getPointerTo(),
+                                               indices, get<2>(key)));
+        builder.CreateStore(array, builder.CreateConstInBoundsGEP1_64(
+            i8Ptr, modeIndex, get<3>(key)));
+      }
+    }
+  }
+
+  // Convert a value like a C cast
+  llvm::Value* convert(llvm::Value* v, DataType from, llvm::Type* to) {
+    llvm::Type* type = v->getType();
+    if (type == to) {
+      return v;
+    }
+    if (type->isPointerTy() && to->isPointerTy()) {
+      return builder.CreateBitCast(v, to);
+    }
+    if (to->isIntegerTy(1)) {
+      return type->isFloatingPointTy()
+          ? builder.CreateFCmpUNE(v, llvm::ConstantFP::get(type, 0.0))
+          : builder.CreateICmpNE(v, llvm::ConstantInt::get(type, 0));
+    }
+    bool isSigned = from.isInt();
+    if (type->isIntegerTy()) {
+      if (to->isIntegerTy()) {
+        return builder.CreateIntCast(v, to, isSigned);
+      }
+      return isSigned ? builder.CreateSIToFP(v, to)
+                      : builder.CreateUIToFP(v, to);
+    }
+    if (to->isIntegerTy()) {
+      return builder.CreateFPToSI(v, to);
+    }
+    return builder.CreateFPCast(v, to);
+  }
+
+  llvm::Value* toBool(llvm::Value* v) {
+    return convert(v, Bool(), builder.getInt1Ty());
+  }
+
+  // The type that both operands of a comparison are converted to, following
+  // the usual arithmetic conversions of C
+  llvm::Type* getCommonType(llvm::Value* a, llvm::Value* b) {
+    llvm::Type* ta = a->getType();
+    llvm::Type* tb = b->getType();
+    if (ta->isFloatingPointTy() || tb->isFloatingPointTy()) {
+      return (ta->isDoubleTy() || tb->isDoubleTy()) ? builder.getDoubleTy()
+                                                    : builder.getFloatTy();
+    }
+    return builder.getIntNTy(max(ta->getIntegerBitWidth(),
+                                 tb->getIntegerBitWidth()));
+  }
+
+  llvm::Value* compare(Expr a, Expr b, llvm::CmpInst::Predicate fpPredicate,
+                       llvm::CmpInst::Predicate signedPredicate,
+                       llvm::CmpInst::Predicate unsignedPredicate) {
+    llvm::Value* va = eval(a);
+    llvm::Value* vb = eval(b);
+    llvm::Type* type = getCommonType(va, vb);
+    va = convert(va, a.type(), type);
+    vb = convert(vb, b.type(), type);
+    if (type->isFloatingPointTy()) {
+      return builder.CreateFCmp(fpPredicate, va, vb);
+    }
+    bool isUnsigned = !a.type().isInt() && !b.type().isInt();
+    return builder.CreateICmp(isUnsigned ? unsignedPredicate
+                                         : signedPredicate, va, vb);
+  }
+
+  enum class BinaryOp {Add, Sub, Mul, Div, Rem, BitAnd};
+
+  llvm::Value* arithmetic(DataType type, Expr a, Expr b, BinaryOp op) {
+    llvm::Type* llvmType = getType(type);
+    llvm::Value* va = convert(eval(a), a.type(), llvmType);
+    llvm::Value* vb = convert(eval(b), b.type(), llvmType);
+    bool isFloat = llvmType->isFloatingPointTy();
+    switch (op) {
+      case BinaryOp::Add:
+        return isFloat ? builder.CreateFAdd(va, vb) : builder.CreateAdd(va, vb);
+      case BinaryOp::Sub:
+        return isFloat ? builder.CreateFSub(va, vb) : builder.CreateSub(va, vb);
+      case BinaryOp::Mul:
+        return isFloat ? builder.CreateFMul(va, vb) : builder.CreateMul(va, vb);
+      case BinaryOp::Div:
+        return isFloat ? builder.CreateFDiv(va, vb) :
+               type.isInt() ? builder.CreateSDiv(va, vb)
+                            : builder.CreateUDiv(va, vb);
+      case BinaryOp::Rem:
+        return isFloat ? builder.CreateFRem(va, vb) :
+               type.isInt() ? builder.CreateSRem(va, vb)
+                            : builder.CreateURem(va, vb);
+      case BinaryOp::BitAnd:
+        return builder.CreateAnd(va, vb);
+    }
+    return nullptr;
+  }
+
+  // Select the smaller (or larger) of two values of the same type
+  llvm::Value* select(llvm::Value* a, llvm::Value* b, DataType type,
+                      bool isMin) {
+    llvm::Value* lt;
+    if (a->getType()->isFloatingPointTy()) {
+      lt = builder.CreateFCmpOLT(a, b);
+    } else {
+      lt = type.isInt() ? builder.CreateICmpSLT(a, b)
+                        : builder.CreateICmpULT(a, b);
+    }
+    return isMin ? builder.CreateSelect(lt, a, b)
+                 : builder.CreateSelect(lt, b, a);
+  }
+
+  llvm::Function* getFunction() {
+    return builder.GetInsertBlock()->getParent();
+  }
+
+  llvm::BasicBlock* createBlock(const string& name) {
+    return llvm::BasicBlock::Create(context, name, getFunction());
+  }
+
+  // Attach vectorization hints to the backedge of a loop
+  void addVectorizeHints(llvm::BranchInst* backedge, int width) {
+    vector<llvm::Metadata*> hints;
+    hints.push_back(nullptr);
+    hints.push_back(llvm::MDNode::get(context,
+        {llvm::MDString::get(context, "llvm.loop.vectorize.enable"),
+         llvm::ConstantAsMetadata::get(builder.getTrue())}));
+    if (width > 0) {
+      hints.push_back(llvm::MDNode::get(context,
+          {llvm::MDString::get(context, "llvm.loop.vectorize.width"),
+           llvm::ConstantAsMetadata::get(builder.getInt32(width))}));
+    }
+    llvm::MDNode* loopID = llvm::MDNode::getDistinct(context, hints);
+    loopID->replaceOperandWith(0, loopID);
+    backedge->setMetadata(llvm::LLVMContext::MD_loop, loopID);
+  }
+
+  void visit(const Literal* op) {
+    llvm::Type* type = getType(op->type);
+    if (op->type.isBool()) {
+      value = builder.getInt1(op->bool_value);
+    } else if (op->type.isUInt()) {
+      value = llvm::ConstantInt::get(type, op->uint_value, false);
+    } else if (op->type.isInt()) {
+      value = llvm::ConstantInt::get(type, op->int_value, true);
+    } else {
+      value = llvm::ConstantFP::get(type, op->float_value);
+    }
+  }
+
+  void visit(const Var* op) {
+    taco_iassert(!op->is_tensor) << "Tensors are only used through properties";
+    llvm::Value* slot = getSlot(op);
+    value = builder.CreateLoad(getSlotType(slot), slot, op->name);
+  }
+
+  void visit(const Neg* op) {
+    llvm::Value* a = convert(eval(op->a), op->a.type(), getType(op->type));
+    value = a->getType()->isFloatingPointTy() ? builder.CreateFNeg(a)
+                                              : builder.CreateNeg(a);
+  }
+
+  void visit(const Sqrt* op) {
+    llvm::Value* a = convert(eval(op->a), op->a.type(), getType(op->type));
+    value = builder.CreateUnaryIntrinsic(llvm::Intrinsic::sqrt, a);
+  }
+
+  void visit(const Add* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Add);
+  }
+
+  void visit(const Sub* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Sub);
+  }
+
+  void visit(const Mul* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Mul);
+  }
+
+  void visit(const Div* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Div);
+  }
+
+  void visit(const Rem* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Rem);
+  }
+
+  void visit(const BitAnd* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::BitAnd);
+  }
+
+  void visit(const Min* op) {
+    llvm::Type* type = getType(op->type);
+    llvm::Value* result = nullptr;
+    for (auto& operand : op->operands) {
+      llvm::Value* v = convert(eval(operand), operand.type(), type);
+      result = (result == nullptr) ? v : select(result, v, op->type, true);
+    }
+    value = result;
+  }
+
+  void visit(const Max* op) {
+    llvm::Type* type = getType(op->type);
+    llvm::Value* a = convert(eval(op->a), op->a.type(), type);
+    llvm::Value* b = convert(eval(op->b), op->b.type(), type);
+    value = select(a, b, op->type, false);
+  }
+
+  void visit(const Eq* op) {
+    value = compare(op->a, op->b, llvm::CmpInst::FCMP_OEQ,
+                    llvm::CmpInst::ICMP_EQ, llvm::CmpInst::ICMP_EQ);
+  }
+
+  void visit(const Neq* op) {
+    value = compare(op->a, op->b, llvm::CmpInst::FCMP_UNE,
+                    llvm::CmpInst::ICMP_NE, llvm::CmpInst::ICMP_NE);
+  }
+
+  void visit(const Gt* op) {
+    value = compare(op->a, op->b, llvm::CmpInst::FCMP_OGT,
+                    llvm::CmpInst::ICMP_SGT, llvm::CmpInst::ICMP_UGT);
+  }
+
+  void visit(const Lt* op) {
+    value = compare(op->a, op->b, llvm::CmpInst::FCMP_OLT,
+                    llvm::CmpInst::ICMP_SLT, llvm::CmpInst::ICMP_ULT);
+  }
+
+  void visit(const Gte* op) {
+    value = compare(op->a, op->b, llvm::CmpInst::FCMP_OGE,
+                    llvm::CmpInst::ICMP_SGE, llvm::CmpInst::ICMP_UGE);
+  }
+
+  void visit(const Lte* op) {
+    value = compare(op->a, op->b, llvm::CmpInst::FCMP_OLE,
+                    llvm::CmpInst::ICMP_SLE, llvm::CmpInst::ICMP_ULE);
+  }
+
+  // And and Or short-circuit like in C, since the right operand may load
+  // from a location that is only valid if the left operand holds
+  void shortCircuit(Expr a, Expr b, bool isAnd) {
+    llvm::Value* va = toBool(eval(a));
+    llvm::BasicBlock* aBlock = builder.GetInsertBlock();
+    llvm::BasicBlock* bBlock = createBlock(isAnd ? "and.rhs" : "or.rhs");
+    llvm::BasicBlock* merge = createBlock(isAnd ? "and.end" : "or.end");
+    if (isAnd) {
+      builder.CreateCondBr(va, bBlock, merge);
+    } else {
+      builder.CreateCondBr(va, merge, bBlock);
+    }
+
+    builder.SetInsertPoint(bBlock);
+    llvm::Value* vb = toBool(eval(b));
+    bBlock = builder.GetInsertBlock();
+    builder.CreateBr(merge);
+
+    builder.SetInsertPoint(merge);
+    llvm::PHINode* phi = builder.CreatePHI(builder.getInt1Ty(), 2);
+    phi->addIncoming(builder.getInt1(!isAnd), aBlock);
+    phi->addIncoming(vb, bBlock);
+    value = phi;
+  }
+
+  void visit(const And* op) {
+    shortCircuit(op->a, op->b, true);
+  }
+
+  void visit(const Or* op) {
+    shortCircuit(op->a, op->b, false);
+  }
+
+  void visit(const IfThenElse* op) {
+    llvm::Value* cond = toBool(eval(op->cond));
+    llvm::BasicBlock* thenBlock = createBlock("if.then");
+    llvm::BasicBlock* elseBlock = op->otherwise.defined()
+                                  ? createBlock("if.else") : nullptr;
+    llvm::BasicBlock* merge = createBlock("if.end");
+    builder.CreateCondBr(cond, thenBlock, elseBlock ? elseBlock : merge);
+
+    builder.SetInsertPoint(thenBlock);
+    op->then.accept(this);
+    builder.CreateBr(merge);
+    if (elseBlock) {
+      builder.SetInsertPoint(elseBlock);
+      op->otherwise.accept(this);
+      builder.CreateBr(merge);
+    }
+    builder.SetInsertPoint(merge);
+  }
+
+  void visit(const Case* op) {
+    llvm::BasicBlock* merge = createBlock("case.end");
+    for (size_t i = 0; i < op->clauses.size(); i++) {
+      auto& clause = op->clauses[i];
+      if (i == op->clauses.size()-1 && op->alwaysMatch) {
+        clause.second.accept(this);
+        break;
+      }
+      llvm::Value* cond = toBool(eval(clause.first));
+      llvm::BasicBlock* body = createBlock("case.body");
+      llvm::BasicBlock* next = createBlock("case.next");
+      builder.CreateCondBr(cond, body, next);
+      builder.SetInsertPoint(body);
+      clause.second.accept(this);
+      builder.CreateBr(merge);
+      builder.SetInsertPoint(next);
+    }
+    builder.CreateBr(merge);
+    builder.SetInsertPoint(merge);
+  }
+
+  llvm::Value* getElementPtr(Expr arr, Expr loc, llvm::Type** elementType) {
+    llvm::Value* ptr = eval(arr);
+    *elementType = ptr->getType()->getPointerElementType();
+    llvm::Value* index = loc.defined()
+        ? convert(eval(loc), loc.type(), builder.getInt64Ty())
+        : builder.getInt64(0);
+    return builder.CreateInBoundsGEP(*elementType, ptr, index);
+  }
+
+  void visit(const Load* op) {
+    llvm::Type* elementType;
+    llvm::Value* ptr = getElementPtr(op->arr, op->loc, &elementType);
+    value = builder.CreateLoad(elementType, ptr);
+  }
+
+  // Parallel loops run serially, so atomic stores are plain stores
+  void visit(const Store* op) {
+    llvm::Type* elementType;
+    llvm::Value* ptr = getElementPtr(op->arr, op->loc, &elementType);
+    builder.CreateStore(convert(eval(op->data), op->data.type(), elementType),
+                        ptr);
+  }
+
+  void visit(const For* op) {
+    llvm::Value* slot = getSlot(op->var);
+    llvm::Type* type = getSlotType(slot);
+    builder.CreateStore(convert(eval(op->start), op->start.type(), type), slot);
+
+    llvm::BasicBlock* condBlock = createBlock("for.cond");
+    llvm::BasicBlock* body = createBlock("for.body");
+    llvm::BasicBlock* exit = createBlock("for.end");
+    builder.CreateBr(condBlock);
+
+    builder.SetInsertPoint(condBlock);
+    llvm::Value* var = builder.CreateLoad(type, slot);
+    llvm::Value* end = convert(eval(op->end), op->end.type(), type);
+    llvm::Value* cond = op->var.type().isInt()
+                        ? builder.CreateICmpSLT(var, end)
+                        : builder.CreateICmpULT(var, end);
+    builder.CreateCondBr(cond, body, exit);
+
+    builder.SetInsertPoint(body);
+    op->contents.accept(this);
+    llvm::Value* increment = convert(eval(op->increment),
+                                     op->increment.type(), type);
+    builder.CreateStore(builder.CreateAdd(builder.CreateLoad(type, slot),
+                                          increment), slot);
+    llvm::BranchInst* backedge = builder.CreateBr(condBlock);
+    if (op->kind == LoopKind::Vectorized) {
+      addVectorizeHints(backedge, op->vec_width);
+    }
+
+    builder.SetInsertPoint(exit);
+  }
+
+  void visit(const While* op) {
+    llvm::BasicBlock* condBlock = createBlock("while.cond");
+    llvm::BasicBlock* body = createBlock("while.body");
+    llvm::BasicBlock* exit = createBlock("while.end");
+    builder.CreateBr(condBlock);
+
+    builder.SetInsertPoint(condBlock);
+    builder.CreateCondBr(toBool(eval(op->cond)), body, exit);
+
+    builder.SetInsertPoint(body);
+    op->contents.accept(this);
+    llvm::BranchInst* backedge = builder.CreateBr(condBlock);
+    if (op->kind == LoopKind::Vectorized) {
+      addVectorizeHints(backedge, op->vec_width);
+    }
+
+    builder.SetInsertPoint(exit);
+  }
+
+  void visit(const Block* op) {
+    for (auto& stmt : op->contents) {
+      if (stmt.defined()) {
+        stmt.accept(this);
+      }
+    }
+  }
+
+  void visit(const Scope* op) {
+    op->scopedStmt.accept(this);
+  }
+
+  void visit(const Function* op) {
+    tensors.clear();
+    slots.clear();
+    propertySlots.clear();
+    outputProperties.clear();
+    outputs = op->outputs;
+
+    vector<Expr> params = util::combine(op->outputs, op->inputs);
+    vector<llvm::Type*> paramTypes;
+    for (auto& param : params) {
+      auto var = to<Var>(param);
+      llvm::Type* type = var->is_tensor ? tensorType : getType(var->type);
+      paramTypes.push_back(var->is_ptr ? type->getPointerTo() : type);
+    }
+    llvm::Function* function = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getInt32Ty(), paramTypes, false),
+        llvm::Function::ExternalLinkage, op->name, module);
+
+    entry = llvm::BasicBlock::Create(context, "entry", function);
+    unpack = llvm::BasicBlock::Create(context, "unpack", function);
+    llvm::BasicBlock* body = llvm::BasicBlock::Create(context, "body",
+                                                      function);
+    builder.SetInsertPoint(entry);
+    builder.CreateBr(unpack);
+    builder.SetInsertPoint(unpack);
+    builder.CreateBr(body);
+    builder.SetInsertPoint(body);
+
+    for (size_t i = 0; i < params.size(); i++) {
+      auto var = to<Var>(params[i]);
+      llvm::Argument* arg = function->getArg(i);
+      arg->setName(var->name);
+      if (var->is_tensor) {
+        tensors[params[i]] = arg;
+      } else {
+        llvm::IRBuilder<> unpackBuilder(unpack->getTerminator());
+        unpackBuilder.CreateStore(arg, getSlot(params[i]));
+      }
+    }
+
+    op->body.accept(this);
+
+    CheckForAlloc allocChecker;
+    op->accept(&allocChecker);
+    if (allocChecker.hasAlloc) {
+      packOutputProperties();
+    }
+    builder.CreateRet(builder.getInt32(0));
+  }
+
+  void visit(const VarAssign* op) {
+    llvm::Value* slot = getSlot(op->lhs);
+    builder.CreateStore(convert(eval(op->rhs), op->rhs.type(),
+                                getSlotType(slot)), slot);
+  }
+
+  // Arrays are allocated through the allocation hooks of the process, like
+  // the taco_malloc and taco_realloc of the C runtime
+  void visit(const Allocate* op) {
+    llvm::Value* slot = getSlot(op->var);
+    llvm::Type* elementType = getType(op->var.type());
+    uint64_t elementSize =
+        module->getDataLayout().getTypeAllocSize(elementType);
+    llvm::Value* size = builder.CreateMul(
+        convert(eval(op->num_elements), op->num_elements.type(),
+                builder.getInt64Ty()),
+        builder.getInt64(elementSize));
+
+    llvm::Type* i8Ptr = builder.getInt8PtrTy();
+    llvm::Value* array;
+    if (op->is_realloc) {
+      llvm::FunctionCallee reallocate = module->getOrInsertFunction(
+          "taco_reallocate", i8Ptr, i8Ptr, builder.getInt64Ty());
+      llvm::Value* old = builder.CreateBitCast(
+          builder.CreateLoad(getSlotType(slot), slot), i8Ptr);
+      array = builder.CreateCall(reallocate, {old, size});
+    } else {
+      llvm::FunctionCallee allocate = module->getOrInsertFunction(
+          "taco_allocate", i8Ptr, builder.getInt64Ty());
+      array = builder.CreateCall(allocate, {size});
+    }
+    builder.CreateStore(builder.CreateBitCast(array, getSlotType(slot)), slot);
+  }
+
+  void visit(const Comment*) {
+  }
+
+  void visit(const BlankLine*) {
+  }
+
+  void visit(const Print* op) {
+    llvm::FunctionCallee printf = module->getOrInsertFunction("printf",
+        llvm::FunctionType::get(builder.getInt32Ty(), {builder.getInt8PtrTy()},
+                                true));
+    vector<llvm::Value*> args = {builder.CreateGlobalStringPtr(op->fmt)};
+    for (auto& param : op->params) {
+      // variadic arguments are promoted like in C
+      llvm::Value* v = eval(param);
+      if (v->getType()->isFloatingPointTy()) {
+        v = convert(v, param.type(), builder.getDoubleTy());
+      } else if (v->getType()->isIntegerTy() &&
+                 v->getType()->getIntegerBitWidth() < 32) {
+        v = convert(v, param.type(), builder.getInt32Ty());
+      }
+      args.push_back(v);
+    }
+    builder.CreateCall(printf, args);
+  }
+
+  void visit(const GetProperty* op) {
+    llvm::Value* slot = getPropertySlot(op);
+    value = builder.CreateLoad(getSlotType(slot), slot, op->name);
+  }
+
+  // Kernels run on one thread, and other functions are resolved in the
+  // process
+  void visit(const Call* op) {
+    if (op->func == "taco_get_num_threads") {
+      value = llvm::ConstantInt::get(getType(op->type), 1);
+      return;
+    }
+    vector<llvm::Value*> args;
+    vector<llvm::Type*> argTypes;
+    for (auto& arg : op->args) {
+      args.push_back(eval(arg));
+      argTypes.push_back(args.back()->getType());
+    }
+    llvm::FunctionCallee callee = module->getOrInsertFunction(op->func,
+        llvm::FunctionType::get(getType(op->type), argTypes, false));
+    value = builder.CreateCall(callee, args);
+  }
+};
+
+void checkError(llvm::Error error) {
+  if (error) {
+    taco_uerror << llvm::toString(std::move(error));
+  }
+}
+
+template <typename T>
+T checkError(llvm::Expected<T> expected) {
+  if (!expected) {
+    taco_uerror << llvm::toString(expected.takeError());
+  }
+  return std::move(*expected);
+}
+
+} // anonymous namespace
+
+struct CodeGen_LLVM::Content {
+  Target target;
+  std::unique_ptr<llvm::orc::LLJIT> jit;
+  std::string ir;
+
+  Content(const Target& target) : target(target) {}
+};
+
+CodeGen_LLVM::CodeGen_LLVM(const Target& target)
+    : content(new Content(target)) {
+  static std::once_flag initialized;
+  std::call_once(initialized, []() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+}
+
+CodeGen_LLVM::~CodeGen_LLVM() {}
+
+void CodeGen_LLVM::compile(const vector<Stmt>& funcs) {
+  auto machineBuilder =
+      checkError(llvm::orc::JITTargetMachineBuilder::detectHost());
+  machineBuilder.setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+  auto targetMachine = checkError(machineBuilder.createTargetMachine());
+  content->jit = checkError(llvm::orc::LLJITBuilder()
+      .setJITTargetMachineBuilder(machineBuilder).create());
+  auto& jit = content->jit;
+  jit->getMainJITDylib().addGenerator(checkError(
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          jit->getDataLayout().getGlobalPrefix())));
+
+  auto context = std::make_unique<llvm::LLVMContext>();
+  auto module = std::make_unique<llvm::Module>("taco", *context);
+  module->setDataLayout(jit->getDataLayout());
+  module->setTargetTriple(targetMachine->getTargetTriple().str());
+
+  LLVMGenerator generator(module.get());
+  for (auto& func : funcs) {
+    generator.compile(func);
+  }
+  for (auto& func : funcs) {
+    generator.compileShim(to<Function>(func));
+  }
+
+  string errors;
+  llvm::raw_string_ostream errorStream(errors);
+  if (llvm::verifyModule(*module, &errorStream)) {
+    taco_ierror << "Invalid LLVM IR: " << errorStream.str();
+  }
+
+  // optimize at -O3 for the host
+  llvm::PassBuilder passBuilder(targetMachine.get());
+  llvm::LoopAnalysisManager loopAnalyses;
+  llvm::FunctionAnalysisManager functionAnalyses;
+  llvm::CGSCCAnalysisManager cgsccAnalyses;
+  llvm::ModuleAnalysisManager moduleAnalyses;
+  passBuilder.registerModuleAnalyses(moduleAnalyses);
+  passBuilder.registerCGSCCAnalyses(cgsccAnalyses);
+  passBuilder.registerFunctionAnalyses(functionAnalyses);
+  passBuilder.registerLoopAnalyses(loopAnalyses);
+  passBuilder.crossRegisterProxies(loopAnalyses, functionAnalyses,
+                                   cgsccAnalyses, moduleAnalyses);
+  passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3)
+      .run(*module, moduleAnalyses);
+
+  content->ir.clear();
+  llvm::raw_string_ostream irStream(content->ir);
+  module->print(irStream, nullptr);
+  irStream.flush();
+
+  checkError(jit->addIRModule(
+      llvm::orc::ThreadSafeModule(std::move(module), std::move(context))));
+}
+
+string CodeGen_LLVM::getIR() const {
+  return content->ir;
+}
+
+void* CodeGen_LLVM::getFunc(const string& name) {
+  taco_iassert(content->jit != nullptr) <<
+      "The functions have not been compiled";
+  auto symbol = content->jit->lookup(name);
+  if (!symbol) {
+    llvm::consumeError(symbol.takeError());
+    return nullptr;
+  }
+  return reinterpret_cast<void*>(symbol->getAddress());
+}
+
+bool CodeGen_LLVM::isAvailable() {
+  return true;
+}
+
+#else
+
+struct CodeGen_LLVM::Content {
+};
+
+CodeGen_LLVM::CodeGen_LLVM(const Target& target) {
+  taco_uerror << "taco was built without the LLVM backend";
+}
+
+CodeGen_LLVM::~CodeGen_LLVM() {}
+
+void CodeGen_LLVM::compile(const vector<Stmt>& funcs) {
+}
+
+string CodeGen_LLVM::getIR() const {
+  return "";
+}
+
+void* CodeGen_LLVM::getFunc(const string& name) {
+  return nullptr;
+}
+
+bool CodeGen_LLVM::isAvailable() {
+  return false;
+}
+
+#endif
+
+} // namespace ir
+} // namespace taco
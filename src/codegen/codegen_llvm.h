@@ -0,0 +1,45 @@
+#ifndef TACO_BACKEND_LLVM_H
+#define TACO_BACKEND_LLVM_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taco/target.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace ir {
+
+/// Compiles lowered functions to machine code in memory with LLVM's ORC JIT,
+/// without writing files or running the C compiler.  The functions are
+/// translated to LLVM IR, optimized at -O3 with fast math, and linked against
+/// the running process (e.g. for taco's allocation hooks).  Parallel loops run
+/// serially and their vectorized loops get LLVM vectorization hints.
+class CodeGen_LLVM {
+public:
+  CodeGen_LLVM(const Target& target);
+  ~CodeGen_LLVM();
+
+  /// Compile lowered functions, each with a `_shim_` function that unpacks an
+  /// array of pointers into its arguments (see CodeGen_C::generateShim).
+  void compile(const std::vector<Stmt>& funcs);
+
+  /// Get the optimized LLVM IR of the compiled functions.
+  std::string getIR() const;
+
+  /// Get a pointer to a compiled function, or nullptr if there's no function
+  /// of this name.
+  void* getFunc(const std::string& name);
+
+  /// True iff taco was built with the LLVM backend.
+  static bool isAvailable();
+
+private:
+  struct Content;
+  std::shared_ptr<Content> content;
+};
+
+} // namespace ir
+} // namespace taco
+#endif
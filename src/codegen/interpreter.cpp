@@ -0,0 +1,733 @@
+#include "interpreter.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
+#include "taco/error.h"
+#include "taco/type.h"
+#include "taco/taco_tensor_t.h"
+#include "taco/ir/ir_visitor.h"
+#include "taco/storage/allocator.h"
+#include "taco/util/collections.h"
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+namespace {
+
+// A scalar or an array of the interpreted code.  Integers are held sign- or
+// zero-extended to 64 bits and floats in double precision, and they are
+// truncated or rounded to their type whenever they are computed, like in C.
+struct Value {
+  enum Kind {Int, UInt, Float, Pointer} kind;
+  union {
+    int64_t i;
+    uint64_t u;
+    double f;
+    void* p;
+  };
+
+  Value() : kind(Int), i(0) {}
+};
+
+Value makeInt(int64_t i) {
+  Value value;
+  value.kind = Value::Int;
+  value.i = i;
+  return value;
+}
+
+Value makeUInt(uint64_t u) {
+  Value value;
+  value.kind = Value::UInt;
+  value.u = u;
+  return value;
+}
+
+Value makeFloat(double f) {
+  Value value;
+  value.kind = Value::Float;
+  value.f = f;
+  return value;
+}
+
+Value makePointer(void* p) {
+  Value value;
+  value.kind = Value::Pointer;
+  value.p = p;
+  return value;
+}
+
+int64_t toInt(const Value& v) {
+  switch (v.kind) {
+    case Value::Int:     return v.i;
+    case Value::UInt:    return (int64_t)v.u;
+    case Value::Float:   return (int64_t)v.f;
+    case Value::Pointer: return (int64_t)(intptr_t)v.p;
+  }
+  return 0;
+}
+
+uint64_t toUInt(const Value& v) {
+  if (v.kind == Value::Float) {
+    return (v.f < 0.0) ? (uint64_t)(int64_t)v.f : (uint64_t)v.f;
+  }
+  return (uint64_t)toInt(v);
+}
+
+double toFloat(const Value& v) {
+  switch (v.kind) {
+    case Value::Int:     return (double)v.i;
+    case Value::UInt:    return (double)v.u;
+    case Value::Float:   return v.f;
+    case Value::Pointer: break;
+  }
+  taco_ierror << "Pointers can't be converted to floats";
+  return 0.0;
+}
+
+bool toBool(const Value& v) {
+  switch (v.kind) {
+    case Value::Float:   return v.f != 0.0;
+    case Value::Pointer: return v.p != nullptr;
+    case Value::Int:
+    case Value::UInt:
+      break;
+  }
+  return v.u != 0;
+}
+
+// Convert a scalar to a type like a C cast.  The 16-bit floating point types
+// compute in single precision, like the generated C code.
+Value convert(const Value& v, DataType type) {
+  switch (type.getKind()) {
+    case DataType::Bool:     return makeUInt(toBool(v));
+    case DataType::UInt8:    return makeUInt((uint8_t)toUInt(v));
+    case DataType::UInt16:   return makeUInt((uint16_t)toUInt(v));
+    case DataType::UInt32:   return makeUInt((uint32_t)toUInt(v));
+    case DataType::UInt64:   return makeUInt(toUInt(v));
+    case DataType::Int8:     return makeInt((int8_t)toInt(v));
+    case DataType::Int16:    return makeInt((int16_t)toInt(v));
+    case DataType::Int32:    return makeInt((int32_t)toInt(v));
+    case DataType::Int64:    return makeInt(toInt(v));
+    case DataType::Float16:
+    case DataType::BFloat16:
+    case DataType::Float32:  return makeFloat((float)toFloat(v));
+    case DataType::Float64:  return makeFloat(toFloat(v));
+    case DataType::UInt128:
+    case DataType::Int128:
+    case DataType::Complex64:
+    case DataType::Complex128:
+    case DataType::Undefined:
+      break;
+  }
+  taco_uerror << "The interpreter does not support " << type << " values";
+  return Value();
+}
+
+template <typename T>
+T* element(void* array, int64_t index) {
+  return static_cast<T*>(array) + index;
+}
+
+Value load(void* array, int64_t index, DataType type) {
+  switch (type.getKind()) {
+    case DataType::Bool:   return makeUInt(*element<bool>(array, index));
+    case DataType::UInt8:  return makeUInt(*element<uint8_t>(array, index));
+    case DataType::UInt16: return makeUInt(*element<uint16_t>(array, index));
+    case DataType::UInt32: return makeUInt(*element<uint32_t>(array, index));
+    case DataType::UInt64: return makeUInt(*element<uint64_t>(array, index));
+    case DataType::Int8:   return makeInt(*element<int8_t>(array, index));
+    case DataType::Int16:  return makeInt(*element<int16_t>(array, index));
+    case DataType::Int32:  return makeInt(*element<int32_t>(array, index));
+    case DataType::Int64:  return makeInt(*element<int64_t>(array, index));
+    case DataType::Float16:
+      return makeFloat((float)*element<float16>(array, index));
+    case DataType::BFloat16:
+      return makeFloat((float)*element<bfloat16>(array, index));
+    case DataType::Float32: return makeFloat(*element<float>(array, index));
+    case DataType::Float64: return makeFloat(*element<double>(array, index));
+    default:
+      break;
+  }
+  taco_uerror << "The interpreter does not support " << type << " values";
+  return Value();
+}
+
+void store(void* array, int64_t index, DataType type, const Value& v) {
+  Value value = convert(v, type);
+  switch (type.getKind()) {
+    case DataType::Bool:   *element<bool>(array, index) = value.u;     break;
+    case DataType::UInt8:  *element<uint8_t>(array, index) = value.u;  break;
+    case DataType::UInt16: *element<uint16_t>(array, index) = value.u; break;
+    case DataType::UInt32: *element<uint32_t>(array, index) = value.u; break;
+    case DataType::UInt64: *element<uint64_t>(array, index) = value.u; break;
+    case DataType::Int8:   *element<int8_t>(array, index) = value.i;   break;
+    case DataType::Int16:  *element<int16_t>(array, index) = value.i;  break;
+    case DataType::Int32:  *element<int32_t>(array, index) = value.i;  break;
+    case DataType::Int64:  *element<int64_t>(array, index) = value.i;  break;
+    case DataType::Float16:
+      *element<float16>(array, index) = float16((float)value.f);
+      break;
+    case DataType::BFloat16:
+      *element<bfloat16>(array, index) = bfloat16((float)value.f);
+      break;
+    case DataType::Float32: *element<float>(array, index) = value.f;  break;
+    case DataType::Float64: *element<double>(array, index) = value.f; break;
+    default:
+      taco_ierror << "Unsupported type " << type;
+  }
+}
+
+// True iff a is less than b, which have the same kind
+bool lessThan(const Value& a, const Value& b) {
+  switch (a.kind) {
+    case Value::Int:     return a.i < b.i;
+    case Value::UInt:    return a.u < b.u;
+    case Value::Float:   return a.f < b.f;
+    case Value::Pointer: return a.p < b.p;
+  }
+  return false;
+}
+
+typedef tuple<const Var*, TensorProperty, int, int> PropertyKey;
+
+// Check if a function has an Allocate node, in which case the properties of
+// its outputs are stored back into their taco_tensor_t structs
+class CheckForAlloc : public IRVisitor {
+public:
+  bool hasAlloc = false;
+protected:
+  using IRVisitor::visit;
+  void visit(const Allocate *op) {
+    hasAlloc = true;
+  }
+};
+
+// Check if the interpreter supports every type and call of a function: values
+// are held in 64 bits, and complex values are not supported
+class CheckSupported : public IRVisitor {
+public:
+  bool supported = true;
+protected:
+  using IRVisitor::visit;
+  void check(DataType type) {
+    supported &= !type.isComplex() && type.getKind() != DataType::UInt128 &&
+                 type.getKind() != DataType::Int128;
+  }
+  void visit(const Literal* op) {
+    check(op->type);
+  }
+  void visit(const Var* op) {
+    check(op->type);
+  }
+  void visit(const Load* op) {
+    check(op->arr.type());
+    IRVisitor::visit(op);
+  }
+  void visit(const Store* op) {
+    check(op->arr.type());
+    IRVisitor::visit(op);
+  }
+  void visit(const Allocate* op) {
+    check(op->var.type());
+    IRVisitor::visit(op);
+  }
+  void visit(const GetProperty* op) {
+    check(op->type);
+    IRVisitor::visit(op);
+  }
+  void visit(const Call* op) {
+    supported &= (op->func == "taco_get_num_threads");
+    IRVisitor::visit(op);
+  }
+};
+
+// Executes one call of a lowered function.  Variables and tensor properties
+// live in slots that are created when they are first used, and tensor
+// properties are unpacked from their taco_tensor_t structs at that point,
+// like CodeGen_C's unpackTensorProperty.
+class Evaluator : public IRVisitorStrict {
+public:
+  int call(const Function* func, void** args) {
+    vector<Expr> params = util::combine(func->outputs, func->inputs);
+    for (size_t i = 0; i < params.size(); i++) {
+      auto var = to<Var>(params[i]);
+      if (var->is_tensor) {
+        tensors[var] = static_cast<taco_tensor_t*>(args[i]);
+      } else if (var->is_ptr) {
+        vars[var] = makePointer(args[i]);
+      } else {
+        // scalars are cast to pointers in the pack, like the shims expect
+        vars[var] = convert(makeInt((intptr_t)args[i]), var->type);
+      }
+    }
+    for (auto& output : func->outputs) {
+      outputs.insert(to<Var>(output));
+    }
+
+    func->body.accept(this);
+
+    CheckForAlloc allocChecker;
+    func->accept(&allocChecker);
+    if (allocChecker.hasAlloc) {
+      packOutputProperties();
+    }
+    return 0;
+  }
+
+private:
+  // the value of the last visited expression
+  Value value;
+
+  unordered_map<const Var*, taco_tensor_t*> tensors;
+  unordered_map<const Var*, Value> vars;
+  map<PropertyKey, Value> properties;
+  unordered_map<const GetProperty*, Value*> propertySlots;
+  vector<PropertyKey> outputProperties;
+  set<const Var*> outputs;
+
+  Value eval(const Expr& expr) {
+    expr.accept(this);
+    return value;
+  }
+
+  Value& getSlot(const Expr& expr) {
+    if (isa<GetProperty>(expr)) {
+      return getPropertySlot(to<GetProperty>(expr));
+    }
+    taco_iassert(isa<Var>(expr)) << "Can only assign to variables";
+    return vars[to<Var>(expr)];
+  }
+
+  // Unpack a tensor property like CodeGen_C's unpackTensorProperty
+  Value& getPropertySlot(const GetProperty* op) {
+    auto slot = propertySlots.find(op);
+    if (slot != propertySlots.end()) {
+      return *slot->second;
+    }
+
+    auto tensorVar = to<Var>(op->tensor);
+    PropertyKey key(tensorVar, op->property, op->mode, op->index);
+    auto property = properties.find(key);
+    if (property == properties.end()) {
+      taco_iassert(tensors.count(tensorVar)) << "Unknown tensor " << op->tensor;
+      taco_tensor_t* tensor = tensors.at(tensorVar);
+      Value unpacked;
+      bool isDimension = false;
+      if (op->property == TensorProperty::Values) {
+        unpacked = makePointer(tensor->vals);
+      } else {
+        taco_iassert((size_t)op->mode < tensorVar->format.getOrder()) <<
+            "Trying to access a nonexistent mode";
+        ModeType modeType = tensorVar->format.getModeTypes()[op->mode];
+        isDimension = op->property == TensorProperty::Dimension &&
+                      (modeType == ModeType::Dense ||
+                       modeType == ModeType::Fixed);
+        unpacked = isDimension
+            ? makeInt(*element<int32_t>(tensor->indices[op->mode][0], 0))
+            : makePointer(tensor->indices[op->mode][op->index]);
+      }
+      property = properties.insert({key, unpacked}).first;
+      if (outputs.count(tensorVar) && !isDimension) {
+        outputProperties.push_back(key);
+      }
+    }
+    propertySlots[op] = &property->second;
+    return property->second;
+  }
+
+  // Store the (possibly reallocated) arrays of the outputs back into their
+  // taco_tensor_t structs, like CodeGen_C's printPack
+  void packOutputProperties() {
+    for (auto& key : outputProperties) {
+      uint8_t* array = static_cast<uint8_t*>(properties.at(key).p);
+      taco_tensor_t* tensor = tensors.at(get<0>(key));
+      if (get<1>(key) == TensorProperty::Values) {
+        tensor->vals = array;
+      } else {
+        tensor->indices[get<2>(key)][get<3>(key)] = array;
+      }
+    }
+  }
+
+  enum class BinaryOp {Add, Sub, Mul, Div, Rem, BitAnd};
+
+  // Compute in the type of the operation, with wrapping integer arithmetic
+  Value arithmetic(DataType type, Value a, Value b, BinaryOp op) {
+    a = convert(a, type);
+    b = convert(b, type);
+    switch (a.kind) {
+      case Value::Float:
+        switch (op) {
+          case BinaryOp::Add: return convert(makeFloat(a.f + b.f), type);
+          case BinaryOp::Sub: return convert(makeFloat(a.f - b.f), type);
+          case BinaryOp::Mul: return convert(makeFloat(a.f * b.f), type);
+          case BinaryOp::Div: return convert(makeFloat(a.f / b.f), type);
+          case BinaryOp::Rem: return convert(makeFloat(fmod(a.f, b.f)), type);
+          case BinaryOp::BitAnd: break;
+        }
+        taco_ierror << "Bitwise and of floats";
+        break;
+      case Value::Int:
+        switch (op) {
+          case BinaryOp::Add: return convert(makeUInt(a.u + b.u), type);
+          case BinaryOp::Sub: return convert(makeUInt(a.u - b.u), type);
+          case BinaryOp::Mul: return convert(makeUInt(a.u * b.u), type);
+          case BinaryOp::Div: return convert(makeInt(a.i / b.i), type);
+          case BinaryOp::Rem: return convert(makeInt(a.i % b.i), type);
+          case BinaryOp::BitAnd: return convert(makeInt(a.i & b.i), type);
+        }
+        break;
+      case Value::UInt:
+        switch (op) {
+          case BinaryOp::Add: return convert(makeUInt(a.u + b.u), type);
+          case BinaryOp::Sub: return convert(makeUInt(a.u - b.u), type);
+          case BinaryOp::Mul: return convert(makeUInt(a.u * b.u), type);
+          case BinaryOp::Div: return convert(makeUInt(a.u / b.u), type);
+          case BinaryOp::Rem: return convert(makeUInt(a.u % b.u), type);
+          case BinaryOp::BitAnd: return convert(makeUInt(a.u & b.u), type);
+        }
+        break;
+      case Value::Pointer:
+        taco_ierror << "Arithmetic on pointers";
+        break;
+    }
+    return Value();
+  }
+
+  Value arithmetic(DataType type, Expr a, Expr b, BinaryOp op) {
+    Value va = eval(a);
+    return arithmetic(type, va, eval(b), op);
+  }
+
+  enum class CompareOp {Eq, Neq, Gt, Lt, Gte, Lte};
+
+  template <typename T>
+  static bool compare(T a, T b, CompareOp op) {
+    switch (op) {
+      case CompareOp::Eq:  return a == b;
+      case CompareOp::Neq: return a != b;
+      case CompareOp::Gt:  return a > b;
+      case CompareOp::Lt:  return a < b;
+      case CompareOp::Gte: return a >= b;
+      case CompareOp::Lte: return a <= b;
+    }
+    return false;
+  }
+
+  // Compare two values following the usual arithmetic conversions of C
+  Value compare(Expr a, Expr b, CompareOp op) {
+    Value va = eval(a);
+    Value vb = eval(b);
+    bool result;
+    if (va.kind == Value::Float || vb.kind == Value::Float) {
+      result = compare(toFloat(va), toFloat(vb), op);
+    } else if (!a.type().isInt() && !b.type().isInt()) {
+      result = compare(toUInt(va), toUInt(vb), op);
+    } else {
+      result = compare(toInt(va), toInt(vb), op);
+    }
+    return makeUInt(result);
+  }
+
+  void visit(const Literal* op) {
+    if (op->type.isBool()) {
+      value = makeUInt(op->bool_value);
+    } else if (op->type.isUInt()) {
+      value = convert(makeUInt(op->uint_value), op->type);
+    } else if (op->type.isInt()) {
+      value = convert(makeInt(op->int_value), op->type);
+    } else {
+      value = convert(makeFloat(op->float_value), op->type);
+    }
+  }
+
+  void visit(const Var* op) {
+    taco_iassert(!op->is_tensor) << "Tensors are only used through properties";
+    value = vars[op];
+  }
+
+  void visit(const Neg* op) {
+    Value a = convert(eval(op->a), op->type);
+    value = (a.kind == Value::Float)
+            ? makeFloat(-a.f)
+            : arithmetic(op->type, makeInt(0), a, BinaryOp::Sub);
+  }
+
+  void visit(const Sqrt* op) {
+    value = convert(makeFloat(sqrt(toFloat(eval(op->a)))), op->type);
+  }
+
+  void visit(const Add* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Add);
+  }
+
+  void visit(const Sub* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Sub);
+  }
+
+  void visit(const Mul* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Mul);
+  }
+
+  void visit(const Div* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Div);
+  }
+
+  void visit(const Rem* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::Rem);
+  }
+
+  void visit(const BitAnd* op) {
+    value = arithmetic(op->type, op->a, op->b, BinaryOp::BitAnd);
+  }
+
+  void visit(const Min* op) {
+    Value result;
+    bool first = true;
+    for (auto& operand : op->operands) {
+      Value v = convert(eval(operand), op->type);
+      if (first || lessThan(v, result)) {
+        result = v;
+      }
+      first = false;
+    }
+    value = result;
+  }
+
+  void visit(const Max* op) {
+    Value a = convert(eval(op->a), op->type);
+    Value b = convert(eval(op->b), op->type);
+    value = lessThan(a, b) ? b : a;
+  }
+
+  void visit(const Eq* op) {
+    value = compare(op->a, op->b, CompareOp::Eq);
+  }
+
+  void visit(const Neq* op) {
+    value = compare(op->a, op->b, CompareOp::Neq);
+  }
+
+  void visit(const Gt* op) {
+    value = compare(op->a, op->b, CompareOp::Gt);
+  }
+
+  void visit(const Lt* op) {
+    value = compare(op->a, op->b, CompareOp::Lt);
+  }
+
+  void visit(const Gte* op) {
+    value = compare(op->a, op->b, CompareOp::Gte);
+  }
+
+  void visit(const Lte* op) {
+    value = compare(op->a, op->b, CompareOp::Lte);
+  }
+
+  // And and Or short-circuit like in C, since the right operand may load
+  // from a location that is only valid if the left operand holds
+  void visit(const And* op) {
+    value = makeUInt(toBool(eval(op->a)) && toBool(eval(op->b)));
+  }
+
+  void visit(const Or* op) {
+    value = makeUInt(toBool(eval(op->a)) || toBool(eval(op->b)));
+  }
+
+  void visit(const IfThenElse* op) {
+    if (toBool(eval(op->cond))) {
+      op->then.accept(this);
+    } else if (op->otherwise.defined()) {
+      op->otherwise.accept(this);
+    }
+  }
+
+  void visit(const Case* op) {
+    for (size_t i = 0; i < op->clauses.size(); i++) {
+      auto& clause = op->clauses[i];
+      if ((i == op->clauses.size()-1 && op->alwaysMatch) ||
+          toBool(eval(clause.first))) {
+        clause.second.accept(this);
+        break;
+      }
+    }
+  }
+
+  void* getArray(const Expr& arr) {
+    Value array = eval(arr);
+    taco_iassert(array.kind == Value::Pointer) << arr << " is not an array";
+    return array.p;
+  }
+
+  void visit(const Load* op) {
+    void* array = getArray(op->arr);
+    int64_t index = op->loc.defined() ? toInt(eval(op->loc)) : 0;
+    value = load(array, index, op->arr.type());
+  }
+
+  // Parallel loops run serially, so atomic stores are plain stores
+  void visit(const Store* op) {
+    void* array = getArray(op->arr);
+    int64_t index = op->loc.defined() ? toInt(eval(op->loc)) : 0;
+    store(array, index, op->arr.type(), eval(op->data));
+  }
+
+  void visit(const For* op) {
+    DataType type = op->var.type();
+    Value& var = getSlot(op->var);
+    var = convert(eval(op->start), type);
+    while (lessThan(var, convert(eval(op->end), type))) {
+      op->contents.accept(this);
+      Value increment = eval(op->increment);
+      var = arithmetic(type, var, increment, BinaryOp::Add);
+    }
+  }
+
+  void visit(const While* op) {
+    while (toBool(eval(op->cond))) {
+      op->contents.accept(this);
+    }
+  }
+
+  void visit(const Block* op) {
+    for (auto& stmt : op->contents) {
+      if (stmt.defined()) {
+        stmt.accept(this);
+      }
+    }
+  }
+
+  void visit(const Scope* op) {
+    op->scopedStmt.accept(this);
+  }
+
+  void visit(const Function* op) {
+    taco_ierror << "Functions can't be nested";
+  }
+
+  void visit(const VarAssign* op) {
+    Value rhs = eval(op->rhs);
+    Value& lhs = getSlot(op->lhs);
+    bool isPointer = isa<Var>(op->lhs) ? to<Var>(op->lhs)->is_ptr
+                                       : lhs.kind == Value::Pointer;
+    lhs = isPointer ? rhs : convert(rhs, op->lhs.type());
+  }
+
+  // Arrays are allocated through the allocation hooks of the process, like
+  // the taco_malloc and taco_realloc of the C runtime
+  void visit(const Allocate* op) {
+    size_t size = toInt(eval(op->num_elements)) *
+                  op->var.type().getNumBytes();
+    Value& array = getSlot(op->var);
+    array = makePointer(op->is_realloc ? taco_reallocate(array.p, size)
+                                       : taco_allocate(size));
+  }
+
+  void visit(const Comment*) {
+  }
+
+  void visit(const BlankLine*) {
+  }
+
+  // The arguments of printf can't be built at run time, so each conversion
+  // is printed on its own with its argument promoted to a 64-bit value
+  void visit(const Print* op) {
+    const string& fmt = op->fmt;
+    size_t param = 0;
+    size_t pos = 0;
+    while (pos < fmt.size()) {
+      size_t next = fmt.find_first_of("%\\", pos);
+      fwrite(fmt.data() + pos, 1, min(next, fmt.size()) - pos, stdout);
+      if (next == string::npos) {
+        break;
+      }
+      if (next+1 < fmt.size() && fmt[next] == '\\') {
+        // the format is a C string literal
+        char escaped = fmt[next+1];
+        putchar(escaped == 'n' ? '\n' : escaped == 't' ? '\t' : escaped);
+        pos = next + 2;
+        continue;
+      }
+      if (next+1 < fmt.size() && fmt[next+1] == '%') {
+        putchar('%');
+        pos = next + 2;
+        continue;
+      }
+      size_t end = fmt.find_first_of("diouxXcfFeEgGaAp", next+1);
+      taco_uassert(end != string::npos && param < op->params.size()) <<
+          "Invalid format string: " << fmt;
+      string flags;
+      for (char c : fmt.substr(next, end - next)) {
+        if (!strchr("hlLqjzt", c)) {
+          flags += c;
+        }
+      }
+      char conversion = fmt[end];
+      Value v = eval(op->params[param++]);
+      if (strchr("fFeEgGaA", conversion)) {
+        printf((flags + conversion).c_str(), toFloat(v));
+      } else if (conversion == 'p') {
+        printf((flags + conversion).c_str(), v.p);
+      } else if (conversion == 'c') {
+        printf((flags + conversion).c_str(), (int)toInt(v));
+      } else if (conversion == 'd' || conversion == 'i') {
+        printf((flags + "ll" + conversion).c_str(), (long long)toInt(v));
+      } else {
+        printf((flags + "ll" + conversion).c_str(),
+               (unsigned long long)toUInt(v));
+      }
+      pos = end + 1;
+    }
+  }
+
+  void visit(const GetProperty* op) {
+    value = getPropertySlot(op);
+  }
+
+  // Kernels run on one thread
+  void visit(const Call* op) {
+    taco_uassert(op->func == "taco_get_num_threads") <<
+        "The interpreter can't call " << op->func;
+    value = convert(makeInt(1), op->type);
+  }
+};
+
+} // anonymous namespace
+
+Interpreter::Interpreter(const vector<Stmt>& funcs) {
+  for (auto& func : funcs) {
+    taco_iassert(isa<Function>(func)) << "Can only interpret functions";
+    this->funcs[to<Function>(func)->name] = func;
+  }
+}
+
+bool Interpreter::canInterpret(const vector<Stmt>& funcs) {
+  CheckSupported checker;
+  for (auto& func : funcs) {
+    func.accept(&checker);
+  }
+  return checker.supported;
+}
+
+bool Interpreter::hasFunction(const string& name) const {
+  return funcs.count(name) > 0;
+}
+
+int Interpreter::callFuncPacked(const string& name, void** args) const {
+  taco_iassert(hasFunction(name)) << "Unknown function " << name;
+  Evaluator evaluator;
+  return evaluator.call(to<Function>(funcs.at(name)), args);
+}
+
+} // namespace ir
+} // namespace taco
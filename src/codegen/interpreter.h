@@ -0,0 +1,42 @@
+#ifndef TACO_INTERPRETER_H
+#define TACO_INTERPRETER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace ir {
+
+/// Executes lowered functions by walking their IR, without generating or
+/// compiling code, so that kernels can run as soon as they are lowered.  It
+/// is much slower than compiled code and is meant to run the first calls of a
+/// module while it compiles (see Module::setTieredExecution).  Parallel loops
+/// run serially.  An interpreter may be called from several threads at once.
+class Interpreter {
+public:
+  /// Create an interpreter of lowered functions.
+  Interpreter(const std::vector<Stmt>& funcs);
+
+  /// True iff the interpreter supports the types and calls of the functions.
+  /// It does not support complex or 128-bit values, and calls no functions
+  /// but taco_get_num_threads.
+  static bool canInterpret(const std::vector<Stmt>& funcs);
+
+  /// True iff the interpreter has a function of this name.
+  bool hasFunction(const std::string& name) const;
+
+  /// Call a function with an array of pointers to its arguments, packed like
+  /// the arguments of its compiled `_shim_` function (see
+  /// CodeGen_C::generateShim), and return its result.
+  int callFuncPacked(const std::string& name, void** args) const;
+
+private:
+  std::map<std::string, Stmt> funcs;
+};
+
+} // namespace ir
+} // namespace taco
+#endif
@@ -1,7 +1,14 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
 #include <dlfcn.h>
 #include <unistd.h>
+#ifdef TACO_LINUX
+#include <sys/mman.h>
+#endif
 
 
 #include "module.h"
@@ -29,7 +36,7 @@ void Module::addFunction(Stmt func) {
   funcs.push_back(func);
 }
 
-void Module::compileToSource(string path, string prefix) {
+void Module::generateSource() {
   if (!moduleFromUserSource) {
   
     // create a codegen instance and add all the funcs
@@ -42,8 +49,13 @@ void Module::compileToSource(string path, string prefix) {
     
     taco_tassert(target.arch == Target::C99) <<
         "Only C99 codegen supported currently";
-    CodeGen_C codegen(source, CodeGen_C::OutputKind::C99Implementation);
+    CodeGen_C codegen(source, CodeGen_C::OutputKind::C99Implementation,
+                      assumeAligned, simdIntrinsics, target.multiversion);
     CodeGen_C headergen(header, CodeGen_C::OutputKind::C99Header);
+
+    // record the target and compiler flags that the kernels are built for
+    source << "// Target: " << target << "\n";
+    source << "// Compiler flags: " << getCompilerFlags() << "\n";
     
     
     for (auto func: funcs) {
@@ -52,6 +64,10 @@ void Module::compileToSource(string path, string prefix) {
       didGenRuntime = true;
     }
   }
+}
+
+void Module::compileToSource(string path, string prefix) {
+  generateSource();
 
   ofstream source_file;
   source_file.open(path+prefix+".c");
@@ -64,69 +80,470 @@ void Module::compileToSource(string path, string prefix) {
   header_file.close();
 }
 
-void Module::compileToStaticLibrary(string path, string prefix) {
-  taco_tassert(false) << "Compiling to a static library is not supported";
+void Module::addKernels(string key, string assemble, string compute) {
+  kernels.push_back({key, assemble, compute});
 }
-  
+
 namespace {
 
-void writeShims(vector<Stmt> funcs, string path, string prefix) {
-  stringstream shims;
-  
-  for (auto func: funcs) {
-    CodeGen_C::generateShim(func, shims);
+/// Returns a C string literal of the string.
+string toCString(const string& str) {
+  string literal = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      literal += '\\';
+    }
+    literal += c;
   }
-  
-  ofstream shims_file;
-  shims_file.open(path+prefix+"_shims.c");
-  shims_file << "#include \"" << path << prefix << ".h\"\n";
-  shims_file << shims.str();
-  shims_file.close();
+  return literal + "\"";
 }
 
 } // anonymous namespace
 
-string Module::compile() {
-  string prefix = tmpdir+libname;
-  string fullpath = prefix + ".so";
-  
-  string cc = util::getFromEnv("TACO_CC", "cc");
-  string cflags = util::getFromEnv("TACO_CFLAGS",
-    "-O3 -ffast-math -std=c99") + " -shared -fPIC";
-  
-  string cmd = cc + " " + cflags + " " +
-    prefix + ".c " +
-    prefix + "_shims.c " +
-    "-o " + prefix + ".so";
+void Module::compileToStaticLibrary(string path, string prefix) {
+  taco_uassert(target.arch == Target::C99) <<
+      "Static libraries can only be compiled for C99 targets";
+  compileToSource(path, prefix);
 
-  // open the output file & write out the source
-  compileToSource(tmpdir, libname);
-  
-  // write out the shims
-  writeShims(funcs, tmpdir, libname);
-  
-  // now compile it
+  // taco_set_parallel is the only external function of the runtime, so it is
+  // renamed for the library, and the shims follow the functions
+  stringstream library;
+  library << "#define taco_set_parallel " << prefix << "_set_parallel\n";
+  library << source.str();
+  for (auto func : funcs) {
+    CodeGen_C::generateShim(func, library);
+  }
+  ofstream source_file;
+  source_file.open(path+prefix+".c");
+  source_file << library.str();
+  source_file.close();
+
+  // the header declares the functions and the shims with C linkage, and C++
+  // programs register the kernels with the taco runtime that they link
+  stringstream declarations;
+  CodeGen_C headergen(declarations, CodeGen_C::OutputKind::C99Header);
+  for (auto func : funcs) {
+    headergen.compile(func, false);
+  }
+  ofstream header_file;
+  header_file.open(path+prefix+".h");
+  header_file << "// Generated by the Tensor Algebra Compiler "
+              << "(tensor-compiler.org)\n";
+  header_file << "#ifndef TACO_LIBRARY_" << prefix << "\n";
+  header_file << "#define TACO_LIBRARY_" << prefix << "\n";
+  header_file << "#include <stdint.h>\n";
+  header_file << "#include \"taco/taco_tensor_t.h\"\n";
+  header_file << "#ifdef __cplusplus\n";
+  header_file << "extern \"C\" {\n";
+  header_file << "#endif\n";
+  header_file << declarations.str() << "\n";
+  for (auto func : funcs) {
+    header_file << "int _shim_" << func.as<Function>()->name
+                << "(void** parameterPack);\n";
+  }
+  header_file << "void " << prefix << "_set_parallel(int32_t parallelize, "
+              << "int32_t num_threads, int32_t schedule, int32_t chunk_size);\n";
+  header_file << "#ifdef __cplusplus\n";
+  header_file << "}\n";
+  header_file << "#include \"taco/precompiled.h\"\n";
+  header_file << "static inline void " << prefix << "_register() {\n";
+  for (auto& kernel : kernels) {
+    header_file << "  taco::registerKernels(" << toCString(kernel.key)
+                << ", {_shim_" << kernel.assemble << ", _shim_"
+                << kernel.compute << ", " << prefix << "_set_parallel});\n";
+  }
+  header_file << "}\n";
+  header_file << "#endif\n";
+  header_file << "#endif\n";
+  header_file.close();
+
+  // position independent, so that the library can be linked into shared
+  // libraries too
+  string cc = util::getFromEnv("TACO_CC", "cc");
+  string object = path + prefix + ".o";
+  string cmd = cc + " " + getCompilerFlags() + " -fPIC -c " + path + prefix +
+               ".c -o " + object;
   int err = system(cmd.data());
   taco_uassert(err == 0) << "Compilation command failed:\n" << cmd
     << "\nreturned " << err;
 
-  // use dlsym() to open the compiled library
-  lib_handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
+  string ar = util::getFromEnv("TACO_AR", "ar");
+  string archive = path + prefix + ".a";
+  unlink(archive.data());
+  cmd = ar + " rcs " + archive + " " + object;
+  err = system(cmd.data());
+  taco_uassert(err == 0) << "Archive command failed:\n" << cmd
+    << "\nreturned " << err;
+  unlink(object.data());
+}
+  
+namespace {
+
+/// True iff libraries are built in memory files (see Module::compile), which
+/// needs memfd_create and /proc/self/fd and isn't turned off by
+/// `TACO_KEEP_FILES`.
+bool buildsInMemory() {
+#ifdef TACO_LINUX
+  static const bool hasMemoryFiles = []() {
+    int fd = memfd_create("taco", MFD_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+    close(fd);
+    return true;
+  }();
+  return hasMemoryFiles && util::getFromEnv("TACO_KEEP_FILES", "").empty();
+#else
+  return false;
+#endif
+}
+
+/// Write the data to a pipe, returning false if its reader closed it.  SIGPIPE
+/// is blocked in the calling thread while writing, and a SIGPIPE raised by the
+/// write is discarded, so that a compiler that exits early doesn't kill the
+/// program.
+bool writeToPipe(int fd, const string& data) {
+  sigset_t sigpipe, oldMask, pending;
+  sigemptyset(&sigpipe);
+  sigaddset(&sigpipe, SIGPIPE);
+  sigpending(&pending);
+  bool wasPending = sigismember(&pending, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipe, &oldMask);
+
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      break;
+    }
+    written += n;
+  }
+
+  if (written < data.size() && !wasPending) {
+    struct timespec zero = {0, 0};
+    sigtimedwait(&sigpipe, nullptr, &zero);
+  }
+  pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+  return written == data.size();
+}
+
+} // anonymous namespace
+
+void* Module::buildLibrary(string cflags, string suffix, string* cmd) {
+  string cc = util::getFromEnv("TACO_CC", "cc");
+  cflags += " -shared -fPIC";
+
+#ifdef TACO_LINUX
+  // the source is piped to the compiler, which writes the library into a
+  // memory file that is loaded through /proc.  The file isn't inherited by
+  // compilers (which may be running for other modules), so the compiler opens
+  // it through this process' fd directory.  It stays open until the library
+  // is unloaded, since the loader would take a library whose path is reused
+  // for one that it has loaded.
+  if (inMemory) {
+    int fd = memfd_create(("taco_" + libname + suffix).data(), MFD_CLOEXEC);
+    if (fd < 0) {
+      *cmd = string("memfd_create: ") + strerror(errno);
+      return nullptr;
+    }
+    string path = "/proc/" + to_string(getpid()) + "/fd/" + to_string(fd);
+    *cmd = cc + " " + cflags + " -x c - -o " + path;
+    FILE* compiler = popen(cmd->data(), "w");
+    bool compiled = compiler != nullptr &&
+                    writeToPipe(fileno(compiler), librarySource);
+    compiled = (compiler != nullptr && pclose(compiler) == 0) && compiled;
+    void* handle = compiled ? dlopen(path.data(), RTLD_NOW | RTLD_LOCAL)
+                            : nullptr;
+    if (handle == nullptr) {
+      close(fd);
+      return nullptr;
+    }
+    lock_guard<mutex> lock(tierMutex);
+    libraries.push_back({handle, fd});
+    return handle;
+  }
+#endif
+
+  string prefix = tmpdir + libname;
+  string fullpath = prefix + suffix + ".so";
+  *cmd = cc + " " + cflags + " " + prefix + ".c -o " + fullpath;
+  if (system(cmd->data()) != 0) {
+    return nullptr;
+  }
+  void* handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
+  if (handle != nullptr) {
+    lock_guard<mutex> lock(tierMutex);
+    libraries.push_back({handle, -1});
+  }
+  return handle;
+}
+
+void Module::closeLibraries() {
+  lib_handle = nullptr;
+  for (auto& library : libraries) {
+    dlclose(library.first);
+    if (library.second >= 0) {
+      close(library.second);
+    }
+  }
+  libraries.clear();
+}
+
+string Module::compile() {
+  if (target.arch == Target::X86) {
+    taco_uassert(!moduleFromUserSource) <<
+        "User-provided source can only be compiled for C99 targets";
+    jit = make_shared<CodeGen_LLVM>(target);
+    jit->compile(funcs);
+    source.str("");
+    source << jit->getIR();
+    return "";
+  }
+
+  // the libraries of the previous compile are unloaded once the one that's
+  // built in the background is in place
+  if (library.valid()) {
+    library.wait();
+  }
+  closeLibraries();
+
+  // the library is built from the source followed by the shims
+  generateSource();
+  stringstream shims;
+  for (auto func : funcs) {
+    CodeGen_C::generateShim(func, shims);
+  }
+  librarySource = source.str() + "\n" + shims.str();
+
+  // files are only written (and the temporary directory checked) if the
+  // library can't be built in memory or they're kept for debugging
+  inMemory = buildsInMemory();
+  string fullpath;
+  if (!inMemory) {
+    if (tmpdir.empty()) {
+      setJITTmpdir();
+    }
+    fullpath = tmpdir + libname + ".so";
+    ofstream source_file;
+    source_file.open(tmpdir + libname + ".c");
+    source_file << librarySource;
+    source_file.close();
+  }
+
+  libraryFailed = false;
+  optimized = false;
+
+  // interpret the functions until the library is built in the background,
+  // if the interpreter supports them
+  if (tieredExecution && !moduleFromUserSource &&
+      Interpreter::canInterpret(funcs)) {
+    lock_guard<mutex> lock(tierMutex);
+    interpreter = make_shared<Interpreter>(funcs);
+    lib_handle = nullptr;
+    interpretedCalls = 0;
+    if (tierThreshold <= 0) {
+      startLibraryBuild();
+    }
+    return fullpath;
+  }
+
+  // run a quick build until the optimized one is built in the background
+  if (tieredCompilation) {
+    string cmd;
+    void* handle = buildLibrary(getQuickCompilerFlags(), "_quick", &cmd);
+    taco_uassert(handle != nullptr) << "Compilation command failed:\n" << cmd;
+    lib_handle = handle;
+    lock_guard<mutex> lock(tierMutex);
+    startLibraryBuild();
+    return fullpath;
+  }
+
+  // now compile it and open it
+  string cmd;
+  lib_handle = buildLibrary(getCompilerFlags(), "", &cmd);
+  taco_uassert(lib_handle != nullptr) << "Compilation command failed:\n"
+    << cmd;
+  optimized = true;
 
   return fullpath;
 }
 
+namespace {
+
+// Pass parallel execution parameters to a module's taco_set_parallel
+bool setParallelParams(void* v_func_ptr, const int params[4]) {
+  typedef void (*fnptr_t)(int32_t, int32_t, int32_t, int32_t);
+  if (v_func_ptr == nullptr) {
+    return false;
+  }
+  fnptr_t func_ptr;
+  *reinterpret_cast<void**>(&func_ptr) = v_func_ptr;
+  func_ptr(params[0], params[1], params[2], params[3]);
+  return true;
+}
+
+} // anonymous namespace
+
+// Build the optimized library in a background thread, which swaps it in for
+// the interpreter or the quick build.  The previous code isn't unloaded until
+// the module is recompiled or destroyed, so that calls that are running it
+// when the library is swapped finish safely.
+// The caller must hold tierMutex.
+void Module::startLibraryBuild() {
+  library = async(launch::async, [this]() {
+    string cmd;
+    void* handle = buildLibrary(getCompilerFlags(), "", &cmd);
+    lock_guard<mutex> lock(tierMutex);
+    if (handle == nullptr) {
+      libraryCommand = cmd;
+      libraryFailed = true;
+      return;
+    }
+    if (hasParallelParams) {
+      setParallelParams(dlsym(handle, "taco_set_parallel"), parallelParams);
+    }
+    lib_handle = handle;
+    interpreter = nullptr;
+    optimized = true;
+  }).share();
+}
+
+void Module::waitForLibrary() {
+  shared_future<void> build;
+  {
+    lock_guard<mutex> lock(tierMutex);
+    if (optimized || (interpreter == nullptr && !library.valid())) {
+      return;
+    }
+    if (!library.valid()) {
+      startLibraryBuild();
+    }
+    build = library;
+  }
+  build.wait();
+  checkLibrary();
+}
+
+void Module::checkLibrary() const {
+  taco_uassert(!libraryFailed) << "Compilation command failed:\n" <<
+      libraryCommand;
+}
+
+void Module::setTieredExecution(bool tiered, int threshold) {
+  this->tieredExecution = tiered;
+  this->tierThreshold = threshold;
+}
+
+void Module::setTieredCompilation(bool tiered) {
+  this->tieredCompilation = tiered;
+}
+
+bool Module::isInterpreted() {
+  lock_guard<mutex> lock(tierMutex);
+  return interpreter != nullptr;
+}
+
+bool Module::isOptimized() {
+  lock_guard<mutex> lock(tierMutex);
+  return optimized;
+}
+
 void Module::setSource(string source) {
   this->source << source;
   moduleFromUserSource = true;
 }
 
+void Module::setAssumeAligned(bool assumeAligned) {
+  this->assumeAligned = assumeAligned;
+}
+
+bool Module::getAssumeAligned() const {
+  return assumeAligned;
+}
+
+void Module::setSimdIntrinsics(bool simdIntrinsics) {
+  this->simdIntrinsics = simdIntrinsics;
+}
+
+bool Module::getSimdIntrinsics() const {
+  return simdIntrinsics;
+}
+
+void Module::setTarget(const Target& target) {
+  this->target = target;
+}
+
+const Target& Module::getTarget() const {
+  return target;
+}
+
+string Module::getCompilerFlags() const {
+  string cflags = util::getFromEnv("TACO_CFLAGS",
+    "-O3 -ffast-math -std=c99 -fopenmp-simd");
+  string targetFlags = target.getCompilerFlags();
+  return targetFlags.empty() ? cflags : targetFlags + " " + cflags;
+}
+
+string Module::getQuickCompilerFlags() const {
+  return util::getFromEnv("TACO_QUICK_CFLAGS", "-O0 -std=c99");
+}
+
 string Module::getSource() {
   return source.str();
 }
 
 void* Module::getFunc(std::string name) {
-  return dlsym(lib_handle, name.data());
+  if (jit) {
+    return jit->getFunc(name);
+  }
+  // raw functions are only in libraries, so wait for one to be loaded
+  void* handle = lib_handle;
+  if (handle == nullptr) {
+    waitForLibrary();
+    handle = lib_handle;
+  }
+  return dlsym(handle, name.data());
+}
+
+bool Module::setParallel(bool parallelize, int numThreads, int schedule,
+                         int chunkSize) {
+  int params[4] = {parallelize, numThreads, schedule, chunkSize};
+  if (jit) {
+    return setParallelParams(jit->getFunc("taco_set_parallel"), params);
+  }
+
+  // the parameters are kept for the optimized library, which gets them when
+  // it's loaded, and the interpreter runs serially
+  lock_guard<mutex> lock(tierMutex);
+  copy(params, params + 4, parallelParams);
+  hasParallelParams = true;
+  void* handle = lib_handle;
+  if (handle == nullptr) {
+    return interpreter != nullptr;
+  }
+  return setParallelParams(dlsym(handle, "taco_set_parallel"), params);
+}
+
+int Module::callFuncPacked(std::string name, void** args) {
+  checkLibrary();
+  if (tieredExecution && lib_handle == nullptr) {
+    shared_ptr<Interpreter> interpreter;
+    {
+      lock_guard<mutex> lock(tierMutex);
+      interpreter = this->interpreter;
+      if (interpreter != nullptr && !library.valid() &&
+          ++interpretedCalls >= tierThreshold) {
+        startLibraryBuild();
+      }
+    }
+    if (interpreter != nullptr) {
+      return interpreter->callFuncPacked(name, args);
+    }
+  }
+  return callFuncPackedRaw("_shim_"+name, args);
 }
 
 int Module::callFuncPackedRaw(std::string name, void** args) {
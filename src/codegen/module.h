@@ -1,7 +1,11 @@
 #ifndef TACO_MODULE_H
 #define TACO_MODULE_H
 
+#include <atomic>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <utility>
@@ -9,6 +13,8 @@
 #include "taco/target.h"
 #include "taco/ir/ir.h"
 #include "codegen_c.h"
+#include "codegen_llvm.h"
+#include "interpreter.h"
 
 namespace taco {
 namespace ir {
@@ -17,12 +23,33 @@ class Module {
 public:
   /// Create a module for some target
   Module(Target target=getTargetFromEnvironment())
-    : moduleFromUserSource(false), target(target) {
+    : inMemory(false), lib_handle(nullptr), moduleFromUserSource(false),
+      assumeAligned(false), simdIntrinsics(false), target(target),
+      tieredExecution(false), tierThreshold(0), tieredCompilation(false),
+      interpretedCalls(0), parallelParams{0, 0, 0, 0}, hasParallelParams(false),
+      libraryFailed(false), optimized(false) {
     setJITLibname();
-    setJITTmpdir();
   }
 
-  /// Compile the source into a library, returning its full path
+  /// Wait for the library that is being built in the background, if any, and
+  /// unload the module's libraries.
+  ~Module() {
+    if (library.valid()) {
+      library.wait();
+    }
+    closeLibraries();
+  }
+
+  /// Compile the source into a library, returning its full path.  On Linux,
+  /// the source is piped to the C compiler, which writes the library into a
+  /// memory file (memfd_create), so that no files are written and concurrent
+  /// processes can't collide, and an empty path is returned.  Setting
+  /// `TACO_KEEP_FILES` writes the source and the library to the temporary
+  /// directory instead, for debugging.  Modules whose target architecture is
+  /// X86 are instead compiled in memory with LLVM (see CodeGen_LLVM), without
+  /// files or subprocesses, and an empty path is returned.  Tiered modules
+  /// return before the library is built (see setTieredExecution and
+  /// setTieredCompilation).
   std::string compile();
   
   /// Compile the module into a source file located
@@ -32,13 +59,23 @@ public:
   
   /// Compile the module into a static library located
   /// at the specified location path and prefix.  The generated
-  /// library will be path/prefix.a
+  /// library will be path/prefix.a, with the header path/prefix.h.  The
+  /// library's symbols are its functions, their `_shim_` functions and
+  /// `prefix_set_parallel`, so that the libraries of several modules can be
+  /// linked into one program.  In C++, the header defines the function
+  /// `prefix_register`, which registers the module's kernels (see addKernels
+  /// and registerKernels).
   void compileToStaticLibrary(std::string path, std::string prefix);
   
   /// Add a lowered function to this module */
   void addFunction(Stmt func);
+
+  /// Record that the functions named `assemble` and `compute` are the kernels
+  /// of the tensor expression with this key (see TensorBase::getKernelKey),
+  /// so that static libraries register them under it.
+  void addKernels(std::string key, std::string assemble, std::string compute);
   
-  /// Get the source of the module as a string */
+  /// Get the source of the module as a string (LLVM IR for X86 targets) */
   std::string getSource();
   
   /// Get a function pointer to a compiled function. This returns a void*
@@ -57,9 +94,7 @@ public:
   
   /// Call a function using the taco_tensor_t interface and return
   /// the result
-  int callFuncPacked(std::string name, void** args) {
-    return callFuncPackedRaw("_shim_"+name, args);
-  }
+  int callFuncPacked(std::string name, void** args);
   
   /// Call a function using the taco_tensor_t interface and return
   /// the result
@@ -67,24 +102,147 @@ public:
     return callFuncPacked(name, args.data());
   }
   
+  /// Set the parallel execution parameters of the module's kernels: whether
+  /// to run their parallel loops in parallel, the number of threads (0 for the
+  /// OpenMP default), the schedule (0 for the loops' own, 1 static, 2 dynamic,
+  /// 3 guided) and the chunk size (0 for the schedule's default). Returns
+  /// false if the compiled module has no parameters to set, e.g. because it
+  /// was created from user-provided source.
+  bool setParallel(bool parallelize, int numThreads, int schedule,
+                   int chunkSize);
+
   /// Set the source of the module
   void setSource(std::string source);
+
+  /// Promise that every tensor array passed to the module's functions is
+  /// `storage::ARRAY_ALIGNMENT`-aligned, so that the generated code may tell
+  /// the C compiler.  Must be set before the module is compiled.
+  void setAssumeAligned(bool assumeAligned);
+
+  /// True iff the generated code assumes aligned tensor arrays.
+  bool getAssumeAligned() const;
+
+  /// Set whether the generated code computes recognized gather loops (e.g.
+  /// the rows of a CSR matrix-vector product) with AVX-512/AVX2 intrinsics,
+  /// picked at run time by the CPU features of the host.  Must be set before
+  /// the module is compiled.
+  void setSimdIntrinsics(bool simdIntrinsics);
+
+  /// True iff the generated code uses SIMD intrinsics.
+  bool getSimdIntrinsics() const;
+
+  /// Set the target to generate and compile code for.  Must be set before the
+  /// module is compiled.
+  void setTarget(const Target& target);
+
+  /// Get the target of the module.
+  const Target& getTarget() const;
+
+  /// Get the flags that the module passes to the C compiler: the target's
+  /// flags followed by `TACO_CFLAGS`, which take precedence.
+  std::string getCompilerFlags() const;
+
+  /// Get the flags of the quick builds of tiered compilation:
+  /// `TACO_QUICK_CFLAGS`, or `-O0 -std=c99` by default.
+  std::string getQuickCompilerFlags() const;
+
+  /// Set whether the module's functions are interpreted (see Interpreter)
+  /// until their library is built, so that they can be called as soon as
+  /// compile() returns.  A background thread builds the library when the
+  /// module is compiled or, if `threshold` is positive, once the functions
+  /// have been called `threshold` times, so that modules that are called a
+  /// few times are never built.  Calls switch to the library as soon as it is
+  /// loaded.  Must be set before the module is compiled, and only applies to
+  /// C99 modules generated by taco whose functions the interpreter supports
+  /// (see Interpreter::canInterpret); other modules are compiled as if it
+  /// were off.
+  void setTieredExecution(bool tiered, int threshold=0);
+
+  /// Set whether compile() builds the library with the quick compiler flags
+  /// (see getQuickCompilerFlags), which take a fraction of the time of the
+  /// optimizer, and returns.  A background thread then builds the library
+  /// with the optimizing flags and swaps it in for the quick build: calls
+  /// that start after the swap run the optimized code and calls that are
+  /// running the quick build, on any thread, finish with it, since the
+  /// superseded library is kept loaded until the module is recompiled or
+  /// destroyed.  Must be set before the module is compiled, and is overridden
+  /// by tiered execution.
+  void setTieredCompilation(bool tiered);
+
+  /// True iff calls to the module's functions are currently interpreted.
+  bool isInterpreted();
+
+  /// True iff calls to the module's functions run its optimized library.
+  bool isOptimized();
+
+  /// Wait until the optimized library of a tiered module is loaded, starting
+  /// its build if it waits for a call threshold.
+  void waitForLibrary();
   
 private:
   std::stringstream source;
   std::stringstream header;
+  // the source of the module's shared library and whether it's built in a
+  // memory file
+  std::string librarySource;
+  bool inMemory;
   std::string libname;
   std::string tmpdir;
-  void* lib_handle;
+  std::atomic<void*> lib_handle;
+  // the libraries that are loaded for the module, with their memory files (or
+  // -1), which are kept until the module is recompiled or destroyed
+  std::vector<std::pair<void*, int>> libraries;
   std::vector<Stmt> funcs;
+
+  // the keys of the module's kernels, with their assemble and compute
+  // functions
+  struct Kernels {
+    std::string key;
+    std::string assemble;
+    std::string compute;
+  };
+  std::vector<Kernels> kernels;
   
   // true iff the module was created from user-provided source
   bool moduleFromUserSource;
 
+  // true iff the generated code may assume aligned tensor arrays
+  bool assumeAligned;
+
+  // true iff the generated code uses SIMD intrinsics for gather loops
+  bool simdIntrinsics;
+
   Target target;
+
+  // the in-memory compiler of X86 targets
+  std::shared_ptr<CodeGen_LLVM> jit;
+
+  // tiered execution and compilation: the interpreter or a quick build run
+  // calls until the optimized library, which is built in the background by
+  // `library`, is loaded and swapped in.  The parallel execution parameters
+  // are kept for the optimized library until then.  `tierMutex` guards the
+  // state that is shared with the background build.
+  bool tieredExecution;
+  int tierThreshold;
+  bool tieredCompilation;
+  std::shared_ptr<Interpreter> interpreter;
+  std::string libraryCommand;
+  int interpretedCalls;
+  int parallelParams[4];
+  bool hasParallelParams;
+  std::atomic<bool> libraryFailed;
+  bool optimized;
+  std::mutex tierMutex;
+  std::shared_future<void> library;
   
   void setJITLibname();
   void setJITTmpdir();
+  void generateSource();
+  void* buildLibrary(std::string cflags, std::string suffix,
+                     std::string* cmd);
+  void closeLibraries();
+  void startLibraryBuild();
+  void checkLibrary() const;
 };
 
 } // namespace ir
@@ -23,12 +23,26 @@ const std::string expr_distribution =
 const std::string compile_without_expr =
   "An index expression must be defined before compile is called.";
 
+const std::string compile_pattern_result =
+  "Boolean pattern tensors have no values and can only be operands.";
+
+const std::string pattern_format =
+  "Boolean pattern tensors must have dense and sparse modes only, and their "
+  "last mode must be sparse, since every component they store is one.";
+
+const std::string compile_diagonal_result =
+  "Tensors with diagonal modes can only be operands.";
+
 const std::string assemble_without_compile =
   "The compile method must be called before assemble.";
 
 const std::string compute_without_compile =
    "The compile method must be called before compute.";
 
+const std::string unaligned_arrays =
+   "The kernel was compiled for 64-byte aligned tensor arrays, but a tensor "
+   "array is no longer aligned. Call compile again after replacing storage.";
+
 const std::string requires_matrix =
     "The argument must be a matrix.";
 
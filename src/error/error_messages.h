@@ -17,12 +17,16 @@ extern const std::string expr_distribution;
 
 // compile error messages
 extern const std::string compile_without_expr;
+extern const std::string compile_pattern_result;
+extern const std::string pattern_format;
+extern const std::string compile_diagonal_result;
 
 // assemble error messages
 extern const std::string assemble_without_compile;
 
 // compute error messages
 extern const std::string compute_without_compile;
+extern const std::string unaligned_arrays;
 
 // factory function error messages
 extern const std::string requires_matrix;
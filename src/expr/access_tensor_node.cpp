@@ -0,0 +1,52 @@
+#include "access_tensor_node.h"
+
+#include <set>
+
+#include "taco/expr/expr_visitor.h"
+#include "taco/util/collections.h"
+
+using namespace std;
+
+namespace taco {
+
+vector<TensorBase> getTensors(const IndexExpr& expr) {
+  struct GetTensors : public ExprVisitor {
+    using ExprVisitor::visit;
+    set<TensorBase> inserted;
+    vector<TensorBase> tensors;
+    void visit(const AccessNode* node) {
+      taco_iassert(isa<AccessTensorNode>(node)) << "Unknown subexpression";
+      TensorBase tensor = to<AccessTensorNode>(node)->tensor;
+      if (!util::contains(inserted, tensor)) {
+        inserted.insert(tensor);
+        tensors.push_back(tensor);
+      }
+    }
+  };
+  GetTensors getTensors;
+  expr.accept(&getTensors);
+  return getTensors.tensors;
+}
+
+map<IndexExpr,IndexExpr> getSubstitutions(const IndexExpr& expr,
+                                          const TensorBase& tensor,
+                                          const TensorBase& replacement) {
+  struct GetSubstitutions : public ExprVisitor {
+    using ExprVisitor::visit;
+    TensorBase tensor, replacement;
+    map<IndexExpr,IndexExpr> substitutions;
+    void visit(const AccessNode* node) {
+      auto access = to<AccessTensorNode>(node);
+      if (access->tensor == tensor) {
+        substitutions.insert({node, replacement(access->indexVars)});
+      }
+    }
+  };
+  GetSubstitutions getSubstitutions;
+  getSubstitutions.tensor = tensor;
+  getSubstitutions.replacement = replacement;
+  expr.accept(&getSubstitutions);
+  return getSubstitutions.substitutions;
+}
+
+}
@@ -0,0 +1,32 @@
+#ifndef TACO_EXPR_ACCESS_TENSOR_NODE_H
+#define TACO_EXPR_ACCESS_TENSOR_NODE_H
+
+#include <map>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr/expr.h"
+#include "taco/expr/expr_nodes.h"
+
+namespace taco {
+
+/// Inherits Access and adds a TensorBase object, so that we can retrieve the
+/// tensors that was used in an expression when we later want to pack arguments.
+struct AccessTensorNode : public AccessNode {
+  AccessTensorNode(TensorBase tensor, const std::vector<IndexVar>& indices)
+      :  AccessNode(tensor.getTensorVar(), indices), tensor(tensor) {}
+  TensorBase tensor;
+};
+
+/// Returns the tensors accessed by an expression, in the order they are first
+/// accessed.
+std::vector<TensorBase> getTensors(const IndexExpr& expr);
+
+/// Returns, for every access of `tensor` in an expression, an access of
+/// `replacement` with the same index variables, for use with `replace`.
+std::map<IndexExpr,IndexExpr> getSubstitutions(const IndexExpr& expr,
+                                               const TensorBase& tensor,
+                                               const TensorBase& replacement);
+
+}
+#endif
@@ -291,6 +291,7 @@ struct TensorVar::Content {
   vector<IndexVar> freeVars;
   IndexExpr indexExpr;
   bool accumulate;
+  DataType accumulationType;
 
   Schedule schedule;
 };
@@ -361,6 +362,16 @@ const Schedule& TensorVar::getSchedule() const {
   return content->schedule;
 }
 
+DataType TensorVar::getAccumulationType() const {
+  return content->accumulationType;
+}
+
+void TensorVar::setAccumulationType(DataType type) {
+  taco_uassert(type == DataType() || (!type.isBool() && !type.isHalf()))
+      << "Temporaries cannot accumulate in " << type.getKind();
+  content->accumulationType = type;
+}
+
 void TensorVar::setName(std::string name) {
   content->name = name;
 }
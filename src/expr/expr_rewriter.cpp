@@ -1,6 +1,7 @@
 #include "taco/expr/expr_rewriter.h"
 
 #include "taco/expr/expr_nodes.h"
+#include "taco/error.h"
 #include "taco/util/collections.h"
 
 namespace taco {
@@ -153,4 +154,82 @@ IndexExpr replace(IndexExpr expr,
   return ReplaceRewriter(substitutions).rewrite(expr);
 }
 
+IndexExpr getDeltaExpr(IndexExpr expr,
+                       const std::map<IndexExpr,IndexExpr>& deltas) {
+  // Sets `expr` to the change of the visited expression, or to an undefined
+  // expression if it does not change.
+  struct DeltaRewriter : public ExprRewriterStrict {
+    using ExprRewriterStrict::visit;
+
+    const std::map<IndexExpr,IndexExpr>& deltas;
+    DeltaRewriter(const std::map<IndexExpr,IndexExpr>& deltas)
+        : deltas(deltas) {}
+
+    void visit(const AccessNode* op) {
+      IndexExpr e = op;
+      expr = util::contains(deltas, e) ? deltas.at(e) : IndexExpr();
+    }
+
+    void visit(const NegNode* op) {
+      IndexExpr a = rewrite(op->a);
+      expr = a.defined() ? IndexExpr(new NegNode(a)) : IndexExpr();
+    }
+
+    void visit(const SqrtNode* op) {
+      taco_uassert(!rewrite(op->a).defined()) <<
+          "The change of " << IndexExpr(op) << " is not linear";
+      expr = IndexExpr();
+    }
+
+    void visit(const AddNode* op) {
+      IndexExpr a = rewrite(op->a);
+      IndexExpr b = rewrite(op->b);
+      expr = (a.defined() && b.defined()) ? IndexExpr(new AddNode(a, b))
+           : a.defined() ? a : b;
+    }
+
+    void visit(const SubNode* op) {
+      IndexExpr a = rewrite(op->a);
+      IndexExpr b = rewrite(op->b);
+      expr = (a.defined() && b.defined()) ? IndexExpr(new SubNode(a, b))
+           : a.defined() ? a
+           : b.defined() ? IndexExpr(new NegNode(b)) : IndexExpr();
+    }
+
+    void visit(const MulNode* op) {
+      IndexExpr a = rewrite(op->a);
+      IndexExpr b = rewrite(op->b);
+      taco_uassert(!a.defined() || !b.defined()) <<
+          "The change of " << IndexExpr(op) << " is not linear";
+      expr = a.defined() ? IndexExpr(new MulNode(a, op->b))
+           : b.defined() ? IndexExpr(new MulNode(op->a, b)) : IndexExpr();
+    }
+
+    void visit(const DivNode* op) {
+      IndexExpr a = rewrite(op->a);
+      taco_uassert(!rewrite(op->b).defined()) <<
+          "The change of " << IndexExpr(op) << " is not linear";
+      expr = a.defined() ? IndexExpr(new DivNode(a, op->b)) : IndexExpr();
+    }
+
+    void visit(const IntImmNode* op) {
+      expr = IndexExpr();
+    }
+
+    void visit(const FloatImmNode* op) {
+      expr = IndexExpr();
+    }
+
+    void visit(const ComplexImmNode* op) {
+      expr = IndexExpr();
+    }
+
+    void visit(const UIntImmNode* op) {
+      expr = IndexExpr();
+    }
+  };
+
+  return DeltaRewriter(deltas).rewrite(expr);
+}
+
 }
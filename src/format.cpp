@@ -84,6 +84,9 @@ std::ostream& operator<<(std::ostream& os, const ModeType& modeType) {
     case ModeType::Fixed:
       os << "fixed";
       break;
+    case ModeType::Diagonal:
+      os << "diagonal";
+      break;
   }
   return os;
 }
@@ -93,6 +96,7 @@ const Format CSR({Dense, Sparse}, {0,1});
 const Format CSC({Dense, Sparse}, {1,0});
 const Format DCSR({Sparse, Sparse}, {0,1});
 const Format DCSC({Sparse, Sparse}, {1,0});
+const Format DIA({Dense, Diagonal}, {0,1});
 
 bool isDense(const Format& format) {
   for (ModeType modeType : format.getModeTypes()) {
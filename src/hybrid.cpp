@@ -0,0 +1,245 @@
+#include "taco/hybrid.h"
+
+#include <algorithm>
+#include <complex>
+#include <functional>
+#include <map>
+#include <tuple>
+
+#include "taco/error.h"
+#include "taco/expr/expr_nodes.h"
+#include "taco/expr/expr_visitor.h"
+#include "taco/expr/expr_rewriter.h"
+#include "expr/access_tensor_node.h"
+#include "taco/util/collections.h"
+
+using namespace std;
+
+namespace taco {
+
+const Format ELL({Dense, Fixed}, {0,1});
+
+template <typename T>
+struct SplitTyped {
+  static void apply(const TensorBase& matrix, int* width,
+                    TensorBase* ell, TensorBase* coo) {
+    // Collect the non-zeros in row-major order
+    vector<tuple<int,int,T>> nonzeros;
+    for (auto& component : iterate<T>(matrix)) {
+      if (component.second != T()) {
+        nonzeros.push_back(make_tuple(component.first[0], component.first[1],
+                                      component.second));
+      }
+    }
+    std::sort(nonzeros.begin(), nonzeros.end(),
+              [](const tuple<int,int,T>& a, const tuple<int,int,T>& b) {
+                return make_pair(get<0>(a), get<1>(a)) <
+                       make_pair(get<0>(b), get<1>(b));
+              });
+
+    if (*width < 0) {
+      vector<int> rowLengths(matrix.getDimension(0), 0);
+      for (auto& nonzero : nonzeros) {
+        rowLengths[get<0>(nonzero)]++;
+      }
+      *width = getHybridWidth(rowLengths);
+    }
+
+    int row = -1;
+    int rowLength = 0;
+    for (auto& nonzero : nonzeros) {
+      if (get<0>(nonzero) != row) {
+        row = get<0>(nonzero);
+        rowLength = 0;
+      }
+      TensorBase* part = (rowLength < *width) ? ell : coo;
+      part->insert({get<0>(nonzero), get<1>(nonzero)}, get<2>(nonzero));
+      rowLength++;
+    }
+    ell->pack();
+    coo->pack();
+  }
+};
+
+HybridTensor::HybridTensor(const TensorBase& matrix, int width)
+    : ell(matrix.getName() + "_ell", matrix.getComponentType(),
+          matrix.getDimensions(), ELL),
+      coo(matrix.getName() + "_coo", matrix.getComponentType(),
+          matrix.getDimensions(), Format({Sparse,Sparse})),
+      width(width) {
+  taco_uassert(matrix.getOrder() == 2) <<
+      "Hybrid storage is only supported for matrices";
+
+  dispatchType<SplitTyped>(matrix.getComponentType(), matrix, &this->width,
+                           &ell, &coo);
+}
+
+const TensorBase& HybridTensor::getEll() const {
+  return ell;
+}
+
+const TensorBase& HybridTensor::getCoo() const {
+  return coo;
+}
+
+int HybridTensor::getWidth() const {
+  return width;
+}
+
+IndexExpr HybridTensor::operator()(const IndexVar& i,
+                                   const IndexVar& j) const {
+  return ell(i,j) + coo(i,j);
+}
+
+/// Returns true if the addition `sub` is a sub-expression of `expr`.
+static bool contains(const IndexExpr& expr, const IndexExpr& sub) {
+  struct ContainsVisitor : public ExprVisitor {
+    using ExprVisitor::visit;
+    const ExprNode* sub;
+    bool found = false;
+    void visit(const AddNode* op) {
+      found |= (op == sub);
+      ExprVisitor::visit(op);
+    }
+  };
+  ContainsVisitor visitor;
+  visitor.sub = sub.ptr;
+  expr.accept(&visitor);
+  return visitor.found;
+}
+
+/// Returns true if `expr` is a linear function of the sub-expression `sub`,
+/// that is if the path from `expr` to `sub` only goes through products,
+/// negations and numerators.
+static bool isLinearIn(const IndexExpr& expr, const IndexExpr& sub) {
+  if (expr == sub) {
+    return true;
+  }
+  if (isa<NegNode>(expr)) {
+    return isLinearIn(to<NegNode>(expr)->a, sub);
+  }
+  if (isa<MulNode>(expr)) {
+    auto mul = to<MulNode>(expr);
+    return (isLinearIn(mul->a, sub) && !contains(mul->b, sub)) ||
+           (isLinearIn(mul->b, sub) && !contains(mul->a, sub));
+  }
+  if (isa<DivNode>(expr)) {
+    auto div = to<DivNode>(expr);
+    return isLinearIn(div->a, sub) && !contains(div->b, sub);
+  }
+  return false;
+}
+
+/// Rename the given index variables in every tensor access of `expr`.
+static IndexExpr rename(const IndexExpr& expr,
+                        const map<IndexVar,IndexVar>& renames) {
+  struct RenameRewriter : public ExprRewriter {
+    using ExprRewriter::visit;
+    map<IndexVar,IndexVar> renames;
+    void visit(const AccessNode* op) {
+      taco_iassert(isa<AccessTensorNode>(op)) << "Unknown subexpression";
+      vector<IndexVar> indexVars;
+      for (auto& indexVar : op->indexVars) {
+        indexVars.push_back(util::contains(renames, indexVar)
+                            ? renames.at(indexVar) : indexVar);
+      }
+      expr = static_cast<const AccessTensorNode*>(op)->tensor(indexVars);
+    }
+  };
+  RenameRewriter rewriter;
+  rewriter.renames = renames;
+  return rewriter.rewrite(expr);
+}
+
+void HybridTensor::fuse(TensorBase result) const {
+  const TensorVar& tensorVar = result.getTensorVar();
+  taco_uassert(tensorVar.getIndexExpr().defined()) <<
+      "The result must be assigned an expression before it can be fused";
+  const vector<IndexVar>& freeVars = tensorVar.getFreeVars();
+
+  // Find the hybrid sums `ell(i,j) + coo(i,j)` in the expression
+  struct FindHybridSums : public ExprVisitor {
+    using ExprVisitor::visit;
+    TensorVar ell, coo;
+    vector<IndexExpr> sums;
+    void visit(const AddNode* op) {
+      if (isa<AccessNode>(op->a) && isa<AccessNode>(op->b) &&
+          to<AccessNode>(op->a)->tensorVar == ell &&
+          to<AccessNode>(op->b)->tensorVar == coo) {
+        sums.push_back(op);
+      }
+      ExprVisitor::visit(op);
+    }
+  };
+  FindHybridSums findHybridSums;
+  findHybridSums.ell = ell.getTensorVar();
+  findHybridSums.coo = coo.getTensorVar();
+  tensorVar.getIndexExpr().accept(&findHybridSums);
+
+  // Split every top-level term that is linear in a hybrid sum
+  function<IndexExpr(const IndexExpr&)> split = [&](const IndexExpr& expr) {
+    if (isa<AddNode>(expr) && !util::contains(findHybridSums.sums, expr)) {
+      return split(to<AddNode>(expr)->a) + split(to<AddNode>(expr)->b);
+    }
+    if (isa<SubNode>(expr)) {
+      return split(to<SubNode>(expr)->a) - split(to<SubNode>(expr)->b);
+    }
+    for (auto& sum : findHybridSums.sums) {
+      if (!isLinearIn(expr, sum)) {
+        continue;
+      }
+      IndexExpr ellTerm = replace(expr, {{sum, to<AddNode>(sum)->a}});
+      IndexExpr cooTerm = replace(expr, {{sum, to<AddNode>(sum)->b}});
+
+      // Give the tail term its own reduction variables so that it is reduced
+      // in its own loops rather than merged with the ELL loops
+      map<IndexVar,IndexVar> renames;
+      struct GetIndexVars : public ExprVisitor {
+        using ExprVisitor::visit;
+        vector<IndexVar> indexVars;
+        void visit(const AccessNode* op) {
+          util::append(indexVars, op->indexVars);
+        }
+      };
+      GetIndexVars getIndexVars;
+      cooTerm.accept(&getIndexVars);
+      for (auto& indexVar : getIndexVars.indexVars) {
+        if (!util::contains(freeVars, indexVar) &&
+            !util::contains(renames, indexVar)) {
+          renames.insert({indexVar, IndexVar()});
+        }
+      }
+      return ellTerm + rename(cooTerm, renames);
+    }
+    return expr;
+  };
+
+  result.setIndexExpression(freeVars, split(tensorVar.getIndexExpr()),
+                            tensorVar.isAccumulating());
+}
+
+int getHybridWidth(const vector<int>& rowLengths) {
+  if (rowLengths.empty()) {
+    return 0;
+  }
+
+  // Histogram of the row lengths
+  int maxLength = *std::max_element(rowLengths.begin(), rowLengths.end());
+  vector<size_t> histogram(maxLength + 1, 0);
+  for (int rowLength : rowLengths) {
+    histogram[rowLength]++;
+  }
+
+  // The largest width that at least a third of the rows fill completely
+  size_t minRows = (rowLengths.size() + 2) / 3;
+  size_t rowsAtLeast = 0;
+  for (int width = maxLength; width > 0; width--) {
+    rowsAtLeast += histogram[width];
+    if (rowsAtLeast >= minRows) {
+      return width;
+    }
+  }
+  return 0;
+}
+
+}
@@ -319,11 +319,12 @@ Stmt Scope::make(Stmt scopedStmt) {
 }
 
 // Store to an array
-Stmt Store::make(Expr arr, Expr loc, Expr data) {
+Stmt Store::make(Expr arr, Expr loc, Expr data, bool use_atomics) {
   Store *store = new Store;
   store->arr = arr;
   store->loc = loc;
   store->data = data;
+  store->use_atomics = use_atomics;
   return store;
 }
 
@@ -364,7 +365,7 @@ Stmt Case::make(std::vector<std::pair<Expr,Stmt>> clauses, bool alwaysMatch) {
 
 // For loop
 Stmt For::make(Expr var, Expr start, Expr end, Expr increment, Stmt contents,
-  LoopKind kind, int vec_width) {
+  LoopKind kind, int vec_width, Expr reduction_var, Expr reduction_size) {
   For *loop = new For;
   loop->var = var;
   loop->start = start;
@@ -373,6 +374,8 @@ Stmt For::make(Expr var, Expr start, Expr end, Expr increment, Stmt contents,
   loop->contents = Scope::make(contents);
   loop->kind = kind;
   loop->vec_width = vec_width;
+  loop->reduction_var = reduction_var;
+  loop->reduction_size = reduction_size;
   return loop;
 }
 
@@ -462,6 +465,16 @@ Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
 }
 
 
+// Call
+Expr Call::make(const std::string& func, const std::vector<Expr>& args,
+                DataType type) {
+  Call* call = new Call;
+  call->func = func;
+  call->args = args;
+  call->type = type;
+  return call;
+}
+
 // GetProperty
 Expr GetProperty::make(Expr tensor, TensorProperty property, int mode) {
   GetProperty* gp = new GetProperty;
@@ -574,6 +587,8 @@ template<> void StmtNode<Print>::accept(IRVisitorStrict *v)
     const { v->visit((const Print*)this); }
 template<> void ExprNode<GetProperty>::accept(IRVisitorStrict *v)
     const { v->visit((const GetProperty*)this); }
+template<> void ExprNode<Call>::accept(IRVisitorStrict *v)
+    const { v->visit((const Call*)this); }
 
 // printing methods
 std::ostream& operator<<(std::ostream& os, const Stmt& stmt) {
@@ -403,6 +403,17 @@ void IRPrinter::visit(const GetProperty* op) {
   stream << op->name;
 }
 
+void IRPrinter::visit(const Call* op) {
+  omitNextParen = false;
+  stream << op->func << "(";
+  for (size_t i=0; i<op->args.size(); i++) {
+    op->args[i].accept(this);
+    if (i < op->args.size()-1)
+      stream << ", ";
+  }
+  stream << ")";
+}
+
 void IRPrinter::resetNameCounters() {
   // seed the unique names with all C99 keywords
   // from: http://en.cppreference.com/w/c/keyword
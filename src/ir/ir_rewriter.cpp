@@ -207,7 +207,7 @@ void IRRewriter::visit(const Store* op) {
     stmt = op;
   }
   else {
-    stmt = Store::make(arr, loc, data);
+    stmt = Store::make(arr, loc, data, op->use_atomics);
   }
 }
 
@@ -223,7 +223,7 @@ void IRRewriter::visit(const For* op) {
   }
   else {
     stmt = For::make(var, start, end, increment, contents, op->kind,
-                     op->vec_width);
+                     op->vec_width, op->reduction_var, op->reduction_size);
   }
 }
 
@@ -355,5 +355,23 @@ void IRRewriter::visit(const GetProperty* op) {
   }
 }
 
+void IRRewriter::visit(const Call* op) {
+  vector<Expr> args;
+  bool argsSame = true;
+  for (const Expr& arg : op->args) {
+    Expr rewrittenArg = rewrite(arg);
+    args.push_back(rewrittenArg);
+    if (rewrittenArg != arg) {
+      argsSame = false;
+    }
+  }
+  if (argsSame) {
+    expr = op;
+  }
+  else {
+    expr = Call::make(op->func, args, op->type);
+  }
+}
+
 
 }}
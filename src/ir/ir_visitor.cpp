@@ -176,6 +176,11 @@ void IRVisitor::visit(const GetProperty* op) {
   op->tensor.accept(this);
 }
 
+void IRVisitor::visit(const Call* op) {
+  for (auto e: op->args)
+    e.accept(this);
+}
+
 void IRVisitor::visit(const Comment* op) {
 }
 
@@ -3,6 +3,9 @@
 #include <vector>
 #include <stack>
 #include <set>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
 
 #include "taco/expr/expr.h"
 
@@ -23,6 +26,7 @@
 #include "taco/util/name_generator.h"
 #include "taco/util/collections.h"
 #include "taco/util/strings.h"
+#include "taco/util/env.h"
 
 using namespace std;
 
@@ -32,6 +36,35 @@ namespace lower {
 using namespace taco::ir;
 using taco::storage::Iterator;
 
+/// The passes of sparse result assembly.
+enum AssemblyPass {
+  /// Assemble the result in one pass, growing its arrays as needed
+  SerialAssembly,
+
+  /// Count the nonzeros of each segment of the last result level into its pos
+  /// array
+  CountPass,
+
+  /// Fill each segment of the last result level from its precomputed start
+  FillPass
+};
+
+/// How the iterations of a parallel reduction loop combine their results.
+enum ReductionStrategy {
+  /// Reduction loops are not parallelized
+  NoReduction,
+
+  /// Sum a scalar result into a temporary with an OpenMP reduction clause
+  ScalarReduction,
+
+  /// Sum a dense result into per-thread private copies of its values, which
+  /// are added to the result when the loop ends
+  PrivatizedReduction,
+
+  /// Sum a dense result with atomic updates of its values
+  AtomicReduction
+};
+
 struct Context {
   /// Determines what kind of code to emit (e.g. compute and/or assembly)
   set<Property>        properties;
@@ -49,6 +82,32 @@ struct Context {
   /// (Not clear if this approach to temporaries is too hacky.)
   map<TensorVar,Expr> temporaries;
 
+  /// The type of scalar temporaries, or undefined to use the type of the
+  /// expression they hold.
+  DataType             accumulationType;
+
+  /// The component type of the result tensor
+  DataType             resultType;
+
+  /// The pass of a parallel assembly, if any, that the emitted loops belong to
+  AssemblyPass         assemblyPass = SerialAssembly;
+
+  /// How a parallel root reduction loop combines its results, and the variable
+  /// (and array size) that a scalar or privatized reduction sums into
+  ReductionStrategy    reductionStrategy = NoReduction;
+  Expr                 reductionVar;
+  Expr                 reductionSize;
+
+  /// The rows and nonzeros of the nonzero-balanced partition that the emitted
+  /// loops cover, if any. The root loop iterates over the rows in
+  /// [partitionRowBegin, partitionRowEnd), and the loop over the balanced
+  /// sparse level starts no earlier than partitionPosBegin and ends at
+  /// partitionPosEnd instead of the end of the row, if they are defined.
+  Expr                 partitionRowBegin;
+  Expr                 partitionRowEnd;
+  Expr                 partitionPosBegin;
+  Expr                 partitionPosEnd;
+
   Context(const IterationGraph& iterationGraph,
           const set<Property>& properties,
           const map<TensorVar,Expr>& tensorVars) {
@@ -130,6 +189,21 @@ static bool needsZero(const Context& ctx) {
   return false;
 }
 
+/// Returns the type of a temporary that holds an expression of the given type.
+/// 16-bit floats are only a storage format, so they accumulate in single
+/// precision unless another accumulation type is requested. Expressions over
+/// pattern tensors only (e.g. the row degrees of a boolean matrix) are counted
+/// in the type of the result.
+static DataType getTemporaryType(const Context& ctx, DataType type) {
+  if (ctx.accumulationType != DataType()) {
+    return ctx.accumulationType;
+  }
+  if (type.isBool()) {
+    return ctx.resultType;
+  }
+  return type.isHalf() ? Float32() : type;
+}
+
 static IndexExpr emitAvailableExprs(const IndexVar& indexVar,
                                     const IndexExpr& indexExpr, Context* ctx,
                                     vector<Stmt>* stmts) {
@@ -137,9 +211,10 @@ static IndexExpr emitAvailableExprs(const IndexVar& indexVar,
   vector<IndexExpr> availExprs = getAvailableExpressions(indexExpr, visited);
   map<IndexExpr,IndexExpr> substitutions;
   for (const IndexExpr& availExpr : availExprs) {
-    TensorVar t("t" + indexVar.getName(), availExpr.getDataType());
+    DataType type = getTemporaryType(*ctx, availExpr.getDataType());
+    TensorVar t("t" + indexVar.getName(), type);
     substitutions.insert({availExpr, taco::Access(t)});
-    Expr tensorVarExpr = Var::make(t.getName(), availExpr.getDataType());
+    Expr tensorVarExpr = Var::make(t.getName(), type);
     ctx->temporaries.insert({t, tensorVarExpr});
     Expr expr = lowerToScalarExpression(availExpr, ctx->iterators,
                                         ctx->iterationGraph, ctx->temporaries);
@@ -158,6 +233,11 @@ static void emitComputeExpr(const Target& target, const IndexVar& indexVar,
     Stmt store = iterationGraph.hasReductionVariableAncestor(indexVar) || accum
         ? compoundStore(target.tensor, target.pos, expr)
         :   Store::make(target.tensor, target.pos, expr);
+    if (ctx.reductionStrategy == AtomicReduction) {
+      store = Store::make(target.tensor, target.pos,
+                          Add::make(Load::make(target.tensor, target.pos), expr),
+                          true);
+    }
     stmts->push_back(store);
   }
   else {
@@ -171,13 +251,16 @@ static void emitComputeExpr(const Target& target, const IndexVar& indexVar,
 static LoopKind doParallelize(const IndexVar& indexVar, const Expr& tensor, 
                               const Context& ctx) {
   if (ctx.iterationGraph.getAncestors(indexVar).size() != 1 ||
-      ctx.iterationGraph.isReduction(indexVar)) {
+      (ctx.iterationGraph.isReduction(indexVar) &&
+       ctx.reductionStrategy == NoReduction)) {
     return LoopKind::Serial;
   }
 
+  // The passes of a parallel assembly write disjoint segments of the result
   const TensorPath& resultPath = ctx.iterationGraph.getResultTensorPath();
   for (size_t i = 0; i < resultPath.getSize(); i++){
-    if (!ctx.iterators[resultPath.getStep(i)].isDense()) {
+    if (!ctx.iterators[resultPath.getStep(i)].isDense() &&
+        ctx.assemblyPass == SerialAssembly) {
       return LoopKind::Serial;
     }
   }
@@ -206,6 +289,31 @@ static LoopKind doParallelize(const IndexVar& indexVar, const Expr& tensor,
   return LoopKind::Dynamic;
 }
 
+/// Returns true iff the loop over an innermost index variable can run its
+/// iterations as SIMD lanes: it computes into a scalar temporary that sums
+/// over the loop (e.g. `tj += A_vals[pA2] * x_vals[jA]`), or it stores into a
+/// random access level of the result, which gives every iteration its own
+/// location (e.g. `y_vals[pA2] = B_vals[pB2] * c`). Loops that merge, guard
+/// their iterations or assemble a sequential result level are not vectorized.
+static bool canVectorize(const Target& target, const IndexVar& indexVar,
+                         const MergeLattice& lattice,
+                         const Iterator& resultIterator, const Context& ctx) {
+  const IterationGraph& iterationGraph = ctx.iterationGraph;
+  if (!util::contains(ctx.properties, Compute) ||
+      !iterationGraph.getChildren(indexVar).empty() ||
+      lattice.getSize() != 1 || needsMerge(lattice)) {
+    return false;
+  }
+
+  if (!target.pos.defined()) {
+    return iterationGraph.isReduction(indexVar) &&
+           !target.tensor.type().isComplex();
+  }
+  return resultIterator.defined() && resultIterator.isRandomAccess() &&
+         !iterationGraph.isReduction(indexVar) &&
+         ctx.reductionStrategy != AtomicReduction;
+}
+
 /// Expression evaluates to true iff none of the iteratators are exhausted
 static Expr noneExhausted(const vector<Iterator>& iterators) {
   vector<Expr> stepIterLqEnd;
@@ -281,6 +389,72 @@ static Stmt createIfStatements(vector<pair<Expr,Stmt>> cases,
   }
 }
 
+/// Replaces the sub-expressions of `expr` that are structurally equal to `sub`
+/// with `replacement`. Returns an undefined expression if `sub` does not occur.
+static IndexExpr replaceEqual(IndexExpr expr, IndexExpr sub,
+                              IndexExpr replacement) {
+  struct ReplaceEqual : public ExprRewriter {
+    using ExprRewriter::visit;
+
+    IndexExpr sub;
+    IndexExpr replacement;
+    bool replaced = false;
+
+    bool replaceIfEqual(const taco::ExprNode* op) {
+      if (!equals(op, sub)) {
+        return false;
+      }
+      expr = replacement;
+      replaced = true;
+      return true;
+    }
+
+    void visit(const AccessNode* op) {
+      if (!replaceIfEqual(op)) ExprRewriter::visit(op);
+    }
+    void visit(const NegNode* op) {
+      if (!replaceIfEqual(op)) ExprRewriter::visit(op);
+    }
+    void visit(const SqrtNode* op) {
+      if (!replaceIfEqual(op)) ExprRewriter::visit(op);
+    }
+    void visit(const AddNode* op) {
+      if (!replaceIfEqual(op)) ExprRewriter::visit(op);
+    }
+    void visit(const SubNode* op) {
+      if (!replaceIfEqual(op)) ExprRewriter::visit(op);
+    }
+    void visit(const MulNode* op) {
+      if (!replaceIfEqual(op)) ExprRewriter::visit(op);
+    }
+    void visit(const DivNode* op) {
+      if (!replaceIfEqual(op)) ExprRewriter::visit(op);
+    }
+  };
+  ReplaceEqual rewriter;
+  rewriter.sub = sub;
+  rewriter.replacement = replacement;
+  IndexExpr result = rewriter.rewrite(expr);
+  return rewriter.replaced ? result : IndexExpr();
+}
+
+/// True iff `expr` is zero wherever the tensor that `iterator` iterates over
+/// is zero, since the tensor is a factor of the product that `expr` computes.
+static bool isAnnihilatedBy(const IndexExpr& expr, const Iterator& iterator) {
+  if (isa<AccessNode>(expr)) {
+    return to<AccessNode>(expr)->tensorVar.getName() ==
+           iterator.getTensor().as<Var>()->name;
+  }
+  if (isa<NegNode>(expr)) {
+    return isAnnihilatedBy(to<NegNode>(expr)->a, iterator);
+  }
+  if (isa<MulNode>(expr)) {
+    return isAnnihilatedBy(to<MulNode>(expr)->a, iterator) ||
+           isAnnihilatedBy(to<MulNode>(expr)->b, iterator);
+  }
+  return false;
+}
+
 /// Lowers an index expression to imperative code according to the loop ordering
 /// described by an iteration graph. This  algorithm was first outlined in paper
 /// "The Tensor Algebra Compiler", but has since been generalized.
@@ -355,6 +529,20 @@ static vector<Stmt> lower(const Target&      target,
       loopBody.push_back(initPos);
     }
 
+    // Emit code to start the segment of the last result level, at zero when
+    // counting and at its precomputed start when filling, so that every
+    // iteration of a parallel assembly has its own result pos variable:
+    // int32_t pA2 = A2_pos[pA1];
+    const vector<IndexVar>& resultVars = resultPath.getVariables();
+    if (ctx.assemblyPass != SerialAssembly &&
+        indexVar == resultVars[resultVars.size() - 2]) {
+      Iterator segmentIterator = ctx.iterators[resultPath.getLastStep()];
+      Expr segmentBegin = (ctx.assemblyPass == CountPass)
+                          ? (long long) 0 : segmentIterator.begin();
+      loopBody.push_back(VarAssign::make(segmentIterator.getPtrVar(),
+                                         segmentBegin, true));
+    }
+
     // Emit one case per lattice point in the sub-lattice rooted at lp
     vector<pair<Expr,Stmt>> cases;
     for (MergeLatticePoint& lq : lpLattice) {
@@ -383,8 +571,9 @@ static vector<Stmt> lower(const Target&      target,
             if (!childExpr.defined()) continue;
 
             // Reduce child expression into temporary
-            TensorVar t("t" + child.getName(), childExpr.getDataType());
-            Expr tensorVarExpr = Var::make(t.getName(), childExpr.getDataType());
+            DataType type = getTemporaryType(ctx, childExpr.getDataType());
+            TensorVar t("t" + child.getName(), type);
+            Expr tensorVarExpr = Var::make(t.getName(), type);
             ctx.temporaries.insert({t, tensorVarExpr});
             childTarget.tensor = tensorVarExpr;
             childTarget.pos    = Expr();
@@ -409,6 +598,11 @@ static vector<Stmt> lower(const Target&      target,
       else {
         // Recursive call to emit iteration graph children
         vector<IndexExpr> childVars;
+
+        // The expression with every child sub-expression replaced by the
+        // temporary it is reduced into, if all of them could be replaced. This
+        // keeps sums of children (e.g. `B(i,j)*c(j) + D(i,k)*e(k)`) intact.
+        IndexExpr combinedExpr = lqexpr;
         for (auto& child : iterationGraph.getChildren(indexVar)) {
           IndexExpr childExpr = lqexpr;
           Target childTarget = target;
@@ -419,8 +613,9 @@ static vector<Stmt> lower(const Target&      target,
             if (!childExpr.defined()) continue;
 
             // Reduce child expression into temporary
-            TensorVar t("t" + child.getName(), childExpr.getDataType());
-            Expr tensorVarExpr = Var::make(t.getName(), childExpr.getDataType());
+            DataType type = getTemporaryType(ctx, childExpr.getDataType());
+            TensorVar t("t" + child.getName(), type);
+            Expr tensorVarExpr = Var::make(t.getName(), type);
             ctx.temporaries.insert({t, tensorVarExpr});
             childTarget.tensor = tensorVarExpr;
             childTarget.pos    = Expr();
@@ -433,6 +628,9 @@ static vector<Stmt> lower(const Target&      target,
             IndexExpr childVar = taco::Access(t);
             lqexpr = replace(lqexpr, {{childExpr,childVar}});
             childVars.push_back(childVar);
+            if (combinedExpr.defined()) {
+              combinedExpr = replaceEqual(combinedExpr, childExpr, childVar);
+            }
           }
 
           auto childCode = lower::lower(childTarget, child, childExpr, exhausted, ctx);
@@ -441,21 +639,28 @@ static vector<Stmt> lower(const Target&      target,
 
         // Emit code to compute and store/assign result
         if (emitCompute && (ivarCase==LAST_FREE || ivarCase==BELOW_LAST_FREE)) {
-          /// Multiply expressions computed sub-expressions
-          auto currentExprs = getAvailableExpressions(lqexpr, iterationGraph.getAncestors(indexVar));
-          auto factors = util::combine(currentExprs,childVars);
-          taco_iassert(factors.size() > 0);
-          IndexExpr expr = factors[0];
-          for (auto& factor : util::excludeFirst(factors)) {
-            expr = expr * factor;
+          if (combinedExpr.defined() && !childVars.empty()) {
+            emitComputeExpr(target, indexVar, combinedExpr, ctx, &caseBody,
+                            accumulate);
+          }
+          else {
+            /// Multiply expressions computed sub-expressions
+            auto currentExprs = getAvailableExpressions(lqexpr, iterationGraph.getAncestors(indexVar));
+            auto factors = util::combine(currentExprs,childVars);
+            taco_iassert(factors.size() > 0);
+            IndexExpr expr = factors[0];
+            for (auto& factor : util::excludeFirst(factors)) {
+              expr = expr * factor;
+            }
+            emitComputeExpr(target, indexVar, expr, ctx, &caseBody, accumulate);
           }
-          emitComputeExpr(target, indexVar, expr, ctx, &caseBody, accumulate);
         }
       }
 
       // Emit a store of the index variable value to the result idx index array
       // A2_idx_arr[A2_pos] = j;
-      if (emitAssemble && resultIterator.defined()){
+      if (emitAssemble && resultIterator.defined() &&
+          ctx.assemblyPass != CountPass) {
         Stmt idxStore = resultIterator.storeIdx(idx);
         if (idxStore.defined()) {
           caseBody.push_back(idxStore);
@@ -468,8 +673,9 @@ static vector<Stmt> lower(const Target&      target,
         Expr rpos = resultIterator.getPtrVar();
         Stmt posInc = VarAssign::make(rpos, Add::make(rpos, (long long) 1));
 
-        // Conditionally resize result `idx` and `pos` arrays
-        if (emitAssemble) {
+        // Conditionally resize result `idx` and `pos` arrays (the arrays of a
+        // parallel assembly are sized by the count pass)
+        if (emitAssemble && ctx.assemblyPass == SerialAssembly) {
           Expr resize =
               And::make(Eq::make((long long) 0, BitAnd::make(Add::make(rpos, (long long) 1), rpos)),
                         Lte::make(ctx.allocSize, Add::make(rpos, (long long) 1)));
@@ -510,7 +716,35 @@ static vector<Stmt> lower(const Target&      target,
       auto caseIterators = removeIterator(idx, lq.getRangeIterators());
       cases.push_back({allEqualTo(caseIterators,idx), Block::make(caseBody)});
     }
-    loopBody.push_back(createIfStatements(cases, lpLattice));
+    // Skip iterations where an iterator sits on padding, such as diagonal
+    // entries outside the matrix or repeated entries of fixed segments:
+    // if (0 <= jA && jA < A2_size[1]) { ... }
+    // Padding that holds valid coordinates and zero values is instead summed
+    // into innermost reductions that it annihilates (e.g. the ELL SpMV loop),
+    // which keeps them branch-free so they can vectorize.
+    Stmt casesStmt = createIfStatements(cases, lpLattice);
+    bool sumsPadding = !emitMerge && iterationGraph.isReduction(indexVar) &&
+                       iterationGraph.getChildren(indexVar).empty();
+    vector<Expr> boundsChecks;
+    for (auto& iterator : lpIterators) {
+      if (sumsPadding && iterator.isZeroPadded() &&
+          isAnnihilatedBy(lp.getExpr(), iterator)) {
+        continue;
+      }
+      Expr inBounds = iterator.inBounds();
+      if (inBounds.defined()) {
+        // Padding never coincides with a stored coordinate of another
+        // iterator, so only guard iterations where this iterator is at idx
+        if (emitMerge && iterator.getIdxVar() != idx) {
+          inBounds = Or::make(Neq::make(iterator.getIdxVar(), idx), inBounds);
+        }
+        boundsChecks.push_back(inBounds);
+      }
+    }
+    if (!boundsChecks.empty()) {
+      casesStmt = IfThenElse::make(conjunction(boundsChecks), casesStmt);
+    }
+    loopBody.push_back(casesStmt);
 
     // Emit code to increment sequential access `pos` variables. Variables that
     // may not be consumed in an iteration (i.e. their iteration space is
@@ -541,9 +775,42 @@ static vector<Stmt> lower(const Target&      target,
     }
     else {
       Iterator iter = lp.getRangeIterators()[0];
-      loop = For::make(iter.getIteratorVar(), iter.begin(), iter.end(), (long long) 1,
-                       Block::make(loopBody), 
-                       doParallelize(indexVar, iter.getTensor(), ctx));
+      Expr begin = iter.begin();
+      Expr end = iter.end();
+      LoopKind kind = LoopKind::Serial;
+      if (ctx.partitionRowBegin.defined()) {
+        if (iterationGraph.getAncestors(indexVar).size() == 1) {
+          begin = ctx.partitionRowBegin;
+          end = ctx.partitionRowEnd;
+        }
+        else {
+          if (ctx.partitionPosBegin.defined()) {
+            begin = Max::make(begin, ctx.partitionPosBegin);
+          }
+          if (ctx.partitionPosEnd.defined()) {
+            end = ctx.partitionPosEnd;
+          }
+        }
+      }
+      else {
+        kind = doParallelize(indexVar, iter.getTensor(), ctx);
+      }
+      Expr reductionVar;
+      Expr reductionSize;
+      if (kind != LoopKind::Serial && iterationGraph.isReduction(indexVar)) {
+        reductionVar  = ctx.reductionVar;
+        reductionSize = ctx.reductionSize;
+      }
+      else if (kind == LoopKind::Serial && boundsChecks.empty() &&
+               canVectorize(target, indexVar, lattice, resultIterator, ctx)) {
+        kind = LoopKind::Vectorized;
+        if (!target.pos.defined()) {
+          reductionVar = target.tensor;
+        }
+      }
+      loop = For::make(iter.getIteratorVar(), begin, end, (long long) 1,
+                       Block::make(loopBody), kind, 0,
+                       reductionVar, reductionSize);
     }
     loops.push_back(loop);
   }
@@ -551,7 +818,8 @@ static vector<Stmt> lower(const Target&      target,
 
   // Emit a store of the  segment size to the result pos index
   // A2_pos_arr[A1_pos + 1] = A2_pos;
-  if (emitAssemble && resultIterator.defined()) {
+  if (emitAssemble && resultIterator.defined() &&
+      ctx.assemblyPass != FillPass) {
     Stmt posStore = resultIterator.storePtr();
     if (posStore.defined()) {
       util::append(code, {posStore});
@@ -561,6 +829,527 @@ static vector<Stmt> lower(const Target&      target,
   return code;
 }
 
+/// Returns true iff the result can be assembled in parallel: its modes are
+/// dense except for the last, which is sparse, the result variables are the
+/// outermost loops, and the outermost loop does not merge, so that its
+/// iterations produce disjoint segments of the last result level.
+static bool canAssembleInParallel(const TensorVar& tensorVar,
+                                  const IndexExpr& indexExpr,
+                                  const Context& ctx) {
+  const set<Property>& properties = ctx.properties;
+  if (!util::contains(properties, ParallelAssemble) ||
+      (util::contains(properties, Accumulate) &&
+       util::contains(properties, Assemble))) {
+    return false;
+  }
+
+  const vector<ModeType>& modeTypes = tensorVar.getFormat().getModeTypes();
+  if (modeTypes.size() < 2 || modeTypes.back() != Sparse) {
+    return false;
+  }
+  for (size_t i = 0; i + 1 < modeTypes.size(); i++) {
+    if (modeTypes[i] != Dense) {
+      return false;
+    }
+  }
+
+  const IterationGraph& iterationGraph = ctx.iterationGraph;
+  const vector<IndexVar>& resultVars =
+      iterationGraph.getResultTensorPath().getVariables();
+  if (iterationGraph.getRoots().size() != 1 ||
+      iterationGraph.getRoots()[0] != resultVars[0]) {
+    return false;
+  }
+  for (size_t i = 1; i < resultVars.size(); i++) {
+    if (iterationGraph.getParent(resultVars[i]) != resultVars[i-1]) {
+      return false;
+    }
+  }
+
+  MergeLattice lattice = MergeLattice::make(indexExpr, resultVars[0],
+                                            iterationGraph, ctx.iterators);
+  return !needsMerge(lattice);
+}
+
+/// Emit the count pass, the prefix sum, the allocations and the fill pass of a
+/// parallel assembly, or only the fill pass when computing into an assembled
+/// result.
+static vector<Stmt> lowerParallelAssembly(const Target& target,
+                                          const IndexExpr& indexExpr,
+                                          Context& ctx) {
+  const IndexVar& root = ctx.iterationGraph.getRoots()[0];
+  const TensorPath& resultPath = ctx.iterationGraph.getResultTensorPath();
+  Iterator lastIterator = ctx.iterators[resultPath.getLastStep()];
+  Expr tensor = lastIterator.getTensor();
+  int level = (int)resultPath.getSize() - 1;
+  string tensorName = tensor.as<Var>()->name;
+  Expr posArr = GetProperty::make(tensor, TensorProperty::Indices, level, 0,
+                                  tensorName + to_string(level + 1) + "_pos");
+  Expr idxArr = GetProperty::make(tensor, TensorProperty::Indices, level, 1,
+                                  tensorName + to_string(level + 1) + "_idx");
+
+  vector<Stmt> code;
+  const set<Property> properties = ctx.properties;
+  if (util::contains(properties, Assemble)) {
+    // The number of segments of the last level
+    Expr numSegments = (long long) 1;
+    for (size_t i = 0; i + 1 < resultPath.getSize(); i++) {
+      numSegments = Mul::make(numSegments,
+                              ctx.iterators[resultPath.getStep(i)].end());
+    }
+    code.push_back(Allocate::make(posArr,
+                                  Add::make(numSegments, (long long) 1)));
+    code.push_back(Store::make(posArr, (long long) 0, (long long) 0));
+
+    // Count the nonzeros of each segment into A2_pos[pA1 + 1]
+    ctx.assemblyPass = CountPass;
+    ctx.properties.erase(Compute);
+    util::append(code, lower(target, root, indexExpr, {}, ctx));
+    ctx.properties = properties;
+
+    // Prefix sum the counts into the segment bounds and size the arrays
+    Expr segment = Var::make("s" + tensorName + to_string(level), Int());
+    Expr next = Add::make(segment, (long long) 1);
+    code.push_back(For::make(segment, (long long) 0, numSegments, (long long) 1,
+        Store::make(posArr, next, Add::make(Load::make(posArr, next),
+                                            Load::make(posArr, segment)))));
+    Expr nnz = Load::make(posArr, numSegments);
+    code.push_back(Allocate::make(idxArr, nnz));
+    code.push_back(Allocate::make(target.tensor, nnz));
+  }
+
+  ctx.assemblyPass = FillPass;
+  util::append(code, lower(target, root, indexExpr, {}, ctx));
+  ctx.assemblyPass = SerialAssembly;
+  return code;
+}
+
+/// Returns the sparse level that the loop nest of `y(i) = A(i,j) * x(j)`-like
+/// expressions can balance across threads by nonzeros, or an undefined
+/// iterator: the result is a dense vector indexed by the root loop, which
+/// iterates over the dense first level of a matrix without merging, and the
+/// only other loop sums over its sparse second level without merging.
+static Iterator getBalancedIterator(const TensorVar& tensorVar,
+                                    const IndexExpr& indexExpr,
+                                    const Context& ctx) {
+  const set<Property>& properties = ctx.properties;
+  if (!util::contains(properties, BalanceNonzeros) ||
+      !util::contains(properties, Compute)) {
+    return Iterator();
+  }
+
+  const vector<ModeType>& modeTypes = tensorVar.getFormat().getModeTypes();
+  if (modeTypes.size() != 1 || modeTypes[0] != Dense) {
+    return Iterator();
+  }
+
+  const IterationGraph& iterationGraph = ctx.iterationGraph;
+  if (iterationGraph.getRoots().size() != 1) {
+    return Iterator();
+  }
+  const IndexVar& root = iterationGraph.getRoots()[0];
+  if (iterationGraph.getChildren(root).size() != 1) {
+    return Iterator();
+  }
+  const IndexVar& child = iterationGraph.getChildren(root)[0];
+  if (!iterationGraph.getChildren(child).empty() ||
+      !iterationGraph.isReduction(child)) {
+    return Iterator();
+  }
+
+  MergeLattice rootLattice = MergeLattice::make(indexExpr, root,
+                                                iterationGraph, ctx.iterators);
+  MergeLattice childLattice = MergeLattice::make(indexExpr, child,
+                                                 iterationGraph, ctx.iterators);
+  if (needsMerge(rootLattice) || needsMerge(childLattice)) {
+    return Iterator();
+  }
+  Iterator rowIterator = rootLattice[0].getRangeIterators()[0];
+  Iterator nonzeroIterator = childLattice[0].getRangeIterators()[0];
+  if (!rowIterator.isDense() || !(nonzeroIterator.getParent() == rowIterator)) {
+    return Iterator();
+  }
+
+  // The nonzeros must be stored in a pos array, which the partitions search
+  for (const TensorPath& tensorPath : iterationGraph.getTensorPaths()) {
+    if (tensorPath.getSize() == 2 &&
+        ctx.iterators[tensorPath.getStep(1)] == nonzeroIterator) {
+      const Format& format = tensorPath.getAccess().getTensorVar().getFormat();
+      if (format.getModeTypes()[format.getModeOrdering()[1]] == Sparse) {
+        return nonzeroIterator;
+      }
+    }
+  }
+  return Iterator();
+}
+
+/// Emit a merge-path search for the coordinate where the merge of the row
+/// ends in `pos[1..numRows]` with the nonzeros crosses `diagonal`: the rows
+/// before `row` end at or before the first `diagonal - row` nonzeros.
+static vector<Stmt> emitMergePathSearch(Expr diagonal, Expr numRows, Expr nnz,
+                                        Expr posArr, Expr row, Expr pos) {
+  vector<Stmt> code;
+  string name = row.as<Var>()->name;
+  Expr hi = Var::make(name + "_hi", Int());
+  Expr mid = Var::make(name + "_mid", Int());
+  code.push_back(VarAssign::make(row, Max::make(Sub::make(diagonal, nnz),
+                                                (long long) 0), true));
+  code.push_back(VarAssign::make(hi, Min::make(diagonal, numRows), true));
+  Expr endsBefore = Lte::make(Load::make(posArr, Add::make(mid, (long long) 1)),
+                              Sub::make(Sub::make(diagonal, mid),
+                                        (long long) 1));
+  code.push_back(While::make(Lt::make(row, hi), Block::make({
+      VarAssign::make(mid, Div::make(Add::make(row, hi), (long long) 2), true),
+      IfThenElse::make(endsBefore,
+                       VarAssign::make(row, Add::make(mid, (long long) 1)),
+                       VarAssign::make(hi, mid))
+  })));
+  code.push_back(VarAssign::make(pos, Sub::make(diagonal, row), true));
+  return code;
+}
+
+/// Emit a loop nest whose iterations take equal shares of the rows plus the
+/// nonzeros of a CSR-like operand, found by merge-path searches on its pos
+/// array. Each partition writes the rows it covers entirely, while the rows it
+/// shares with its neighbours (its first and last row) are fixed up with
+/// atomic additions into the zeroed result.
+static vector<Stmt> lowerBalancedNonzeros(const Target& target,
+                                          const IndexExpr& indexExpr,
+                                          const Iterator& nonzeroIterator,
+                                          Context& ctx) {
+  const IndexVar& root = ctx.iterationGraph.getRoots()[0];
+  Expr tensor = nonzeroIterator.getTensor();
+  string tensorName = tensor.as<Var>()->name;
+  string posName = "p" + tensorName + "2";
+  string rowName = "i" + tensorName;
+  Expr posArr = GetProperty::make(tensor, TensorProperty::Indices, 1, 0,
+                                  tensorName + "2_pos");
+  Expr numRows = nonzeroIterator.getParent().end();
+
+  vector<Stmt> code;
+  if (!util::contains(ctx.properties, Accumulate)) {
+    Expr result = to<GetProperty>(target.tensor)->tensor;
+    Expr p = Var::make("p" + to<Var>(result)->name, Int());
+    code.push_back(For::make(p, (long long) 0, numRows, (long long) 1,
+                             Store::make(target.tensor, p, 0.0)));
+  }
+
+  // Split the merge of the row ends with the nonzeros into one partition per
+  // thread, e.g. diagonals 7 and 14 of 21 rows plus nonzeros for 3 threads
+  Expr nnz = Var::make("nnz" + tensorName, Int());
+  Expr numPartitions = Var::make("num_partitions" + tensorName, Int());
+  Expr work = Var::make("work" + tensorName, Int());
+  code.push_back(VarAssign::make(nnz, Load::make(posArr, numRows), true));
+  code.push_back(VarAssign::make(work, Add::make(numRows, nnz), true));
+  code.push_back(VarAssign::make(numPartitions,
+                                 Call::make("taco_get_num_threads", {}, Int()),
+                                 true));
+  Expr partition = Var::make("partition" + tensorName, Int());
+  auto getDiagonal = [&](Expr partition) {
+    return Add::make(Mul::make(Div::make(work, numPartitions), partition),
+                     Min::make(partition, Rem::make(work, numPartitions)));
+  };
+
+  Expr diagonalBegin = Var::make("d" + tensorName + "_begin", Int());
+  Expr diagonalEnd = Var::make("d" + tensorName + "_end", Int());
+  Expr rowBegin = Var::make(rowName + "_begin", Int());
+  Expr rowEnd = Var::make(rowName + "_end", Int());
+  Expr posBegin = Var::make(posName + "_begin", Int());
+  Expr posEnd = Var::make(posName + "_end", Int());
+  vector<Stmt> body;
+  body.push_back(VarAssign::make(diagonalBegin, getDiagonal(partition), true));
+  body.push_back(VarAssign::make(
+      diagonalEnd, getDiagonal(Add::make(partition, (long long) 1)), true));
+  util::append(body, emitMergePathSearch(diagonalBegin, numRows, nnz, posArr,
+                                         rowBegin, posBegin));
+  util::append(body, emitMergePathSearch(diagonalEnd, numRows, nnz, posArr,
+                                         rowEnd, posEnd));
+
+  // The first row is shared if it starts before the partition, and the last
+  // row if the partition ends inside it
+  Expr rowHead = Var::make(rowName + "_head", Int());
+  Expr rowTail = Var::make(rowName + "_tail", Int());
+  body.push_back(VarAssign::make(rowHead, rowBegin, true));
+  body.push_back(IfThenElse::make(
+      And::make(Lt::make(rowBegin, rowEnd),
+                Gt::make(posBegin, Load::make(posArr, rowBegin))),
+      VarAssign::make(rowHead, Add::make(rowBegin, (long long) 1))));
+  body.push_back(VarAssign::make(rowTail, rowEnd, true));
+  body.push_back(IfThenElse::make(Gt::make(posEnd, Load::make(posArr, rowEnd)),
+                 VarAssign::make(rowTail, Add::make(rowEnd, (long long) 1))));
+
+  const ReductionStrategy reductionStrategy = ctx.reductionStrategy;
+  auto lowerRows = [&](Expr begin, Expr end, Expr posBegin, Expr posEnd,
+                       bool atomic) {
+    ctx.partitionRowBegin = begin;
+    ctx.partitionRowEnd   = end;
+    ctx.partitionPosBegin = posBegin;
+    ctx.partitionPosEnd   = posEnd;
+    ctx.reductionStrategy = atomic ? AtomicReduction : reductionStrategy;
+    util::append(body, lower(target, root, indexExpr, {}, ctx));
+  };
+  lowerRows(rowBegin, rowHead, posBegin, Expr(), true);
+  lowerRows(rowHead, rowEnd, Expr(), Expr(), false);
+  lowerRows(rowEnd, rowTail, posBegin, posEnd, true);
+  ctx.partitionRowBegin = Expr();
+  ctx.partitionRowEnd   = Expr();
+  ctx.partitionPosBegin = Expr();
+  ctx.partitionPosEnd   = Expr();
+  ctx.reductionStrategy = reductionStrategy;
+
+  code.push_back(For::make(partition, (long long) 0, numPartitions,
+                           (long long) 1, Block::make(body),
+                           LoopKind::Static));
+  return code;
+}
+
+/// Returns the diagonal level of a DIA matrix that the loop nest of
+/// `y(i) = A(i,j) * x(j)`-like expressions can run over diagonal by diagonal,
+/// or an undefined iterator: the result is a dense vector indexed by the root
+/// loop, which iterates over the rows of the matrix without merging, and the
+/// only other loop sums over its stored diagonals without merging. Every
+/// operand must be indexed by the summed variable, so that the sum can be
+/// added into the result one diagonal at a time, in the result type.
+static Iterator getDiagonalIterator(const TensorVar& tensorVar,
+                                    const IndexExpr& indexExpr,
+                                    const Context& ctx) {
+  if (!util::contains(ctx.properties, Compute)) {
+    return Iterator();
+  }
+
+  const vector<ModeType>& modeTypes = tensorVar.getFormat().getModeTypes();
+  if (modeTypes.size() != 1 || modeTypes[0] != Dense ||
+      ctx.resultType.isHalf() ||
+      !(getTemporaryType(ctx, indexExpr.getDataType()) == ctx.resultType)) {
+    return Iterator();
+  }
+
+  const IterationGraph& iterationGraph = ctx.iterationGraph;
+  if (iterationGraph.getRoots().size() != 1) {
+    return Iterator();
+  }
+  const IndexVar& root = iterationGraph.getRoots()[0];
+  if (iterationGraph.getChildren(root).size() != 1) {
+    return Iterator();
+  }
+  const IndexVar& child = iterationGraph.getChildren(root)[0];
+  if (!iterationGraph.getChildren(child).empty() ||
+      !iterationGraph.isReduction(child) ||
+      !equals(getSubExprOld(indexExpr, {child}), indexExpr)) {
+    return Iterator();
+  }
+
+  MergeLattice rootLattice = MergeLattice::make(indexExpr, root,
+                                                iterationGraph, ctx.iterators);
+  MergeLattice childLattice = MergeLattice::make(indexExpr, child,
+                                                 iterationGraph, ctx.iterators);
+  if (needsMerge(rootLattice) || needsMerge(childLattice)) {
+    return Iterator();
+  }
+  Iterator rowIterator = rootLattice[0].getRangeIterators()[0];
+  Iterator diagonalIterator = childLattice[0].getRangeIterators()[0];
+  if (!rowIterator.isDense() || !(diagonalIterator.getParent() == rowIterator)) {
+    return Iterator();
+  }
+
+  for (const TensorPath& tensorPath : iterationGraph.getTensorPaths()) {
+    if (tensorPath.getSize() == 2 &&
+        ctx.iterators[tensorPath.getStep(1)] == diagonalIterator) {
+      const Format& format = tensorPath.getAccess().getTensorVar().getFormat();
+      if (format.getModeTypes()[format.getModeOrdering()[1]] == Diagonal) {
+        return diagonalIterator;
+      }
+    }
+  }
+  return Iterator();
+}
+
+/// Emit a loop nest over the stored diagonals of a DIA matrix whose inner loop
+/// runs over the rows that a diagonal covers, so that the diagonal's values
+/// and the operands indexed by its columns are loaded with unit stride, and
+/// the diagonal offset is loaded once per diagonal instead of once per row:
+/// for (int dA2 = 0; dA2 < A2_size[0]; dA2++) {
+///   int offsetA = A2_offset[dA2];
+///   for (int iA = max(0, -offsetA); iA < min(n, A2_size[1] - offsetA); iA++)
+///     y_vals[iA] += A_vals[dA2 * n + iA] * x_vals[iA + offsetA];
+/// }
+static vector<Stmt> lowerDiagonals(const Target& target,
+                                   const IndexExpr& indexExpr,
+                                   const Iterator& diagonalIterator,
+                                   Context& ctx) {
+  const IterationGraph& iterationGraph = ctx.iterationGraph;
+  const IndexVar& root = iterationGraph.getRoots()[0];
+  const IndexVar& child = iterationGraph.getChildren(root)[0];
+  const Iterator& rowIterator = diagonalIterator.getParent();
+  Expr tensor = diagonalIterator.getTensor();
+  string tensorName = tensor.as<Var>()->name;
+  Expr sizeArr = GetProperty::make(tensor, TensorProperty::Indices, 1, 0,
+                                   tensorName + "2_size");
+  Expr offsetArr = GetProperty::make(tensor, TensorProperty::Indices, 1, 1,
+                                     tensorName + "2_offset");
+  Expr numRows = rowIterator.end();
+
+  vector<Stmt> code;
+  if (!util::contains(ctx.properties, Accumulate)) {
+    Expr result = to<GetProperty>(target.tensor)->tensor;
+    Expr p = Var::make("p" + to<Var>(result)->name, Int());
+    code.push_back(For::make(p, (long long) 0, numRows, (long long) 1,
+                             Store::make(target.tensor, p, 0.0)));
+  }
+
+  // Initialize the pos variables of the row and its columns on the diagonal
+  Expr row = rowIterator.getIteratorVar();
+  Expr offset = Var::make("offset" + tensorName, Int());
+  vector<Stmt> rowBody;
+  const TensorPath& resultPath = iterationGraph.getResultTensorPath();
+  MergeLattice rootLattice = MergeLattice::make(indexExpr, root,
+                                                iterationGraph, ctx.iterators);
+  for (Iterator& iterator : getRandomAccessIterators(util::combine(
+           rootLattice[0].getIterators(),
+           {ctx.iterators[resultPath.getStep(root)]}))) {
+    Expr val = Add::make(Mul::make(iterator.getParent().getPtrVar(),
+                                   iterator.end()), row);
+    rowBody.push_back(VarAssign::make(iterator.getPtrVar(), val, true));
+  }
+  Expr rowPtr = rowIterator.getPtrVar();
+  Expr column = diagonalIterator.getIdxVar();
+  rowBody.push_back(VarAssign::make(
+      diagonalIterator.getPtrVar(),
+      Add::make(Mul::make(diagonalIterator.getIteratorVar(), numRows), rowPtr),
+      true));
+  rowBody.push_back(VarAssign::make(column, Add::make(rowPtr, offset), true));
+  MergeLattice childLattice = MergeLattice::make(indexExpr, child,
+                                                 iterationGraph, ctx.iterators);
+  for (Iterator& iterator :
+           getRandomAccessIterators(childLattice[0].getIterators())) {
+    Expr val = Add::make(Mul::make(iterator.getParent().getPtrVar(),
+                                   iterator.end()), column);
+    rowBody.push_back(VarAssign::make(iterator.getPtrVar(), val, true));
+  }
+
+  Expr expr = lowerToScalarExpression(indexExpr, ctx.iterators,
+                                      iterationGraph, ctx.temporaries);
+  rowBody.push_back(compoundStore(target.tensor, target.pos, expr));
+
+  // The rows that the diagonal covers, whose columns lie inside the matrix
+  Expr rowBegin = Max::make((long long) 0, Neg::make(offset));
+  Expr rowEnd = Min::make(numRows, Sub::make(Load::make(sizeArr, (long long) 1),
+                                             offset));
+  Stmt rowLoop = For::make(row, rowBegin, rowEnd, (long long) 1,
+                           Block::make(rowBody), LoopKind::Vectorized);
+  Expr diagonal = diagonalIterator.getIteratorVar();
+  code.push_back(For::make(diagonal, diagonalIterator.begin(),
+                           diagonalIterator.end(), (long long) 1,
+                           Block::make({
+      VarAssign::make(offset, Load::make(offsetArr, diagonal), true),
+      rowLoop
+  })));
+  return code;
+}
+
+/// Returns the extent of an index variable, from the dimension of the first
+/// access it indexes, or zero if that dimension is not fixed.
+static size_t getExtent(const IndexVar& indexVar, const Context& ctx) {
+  for (const TensorPath& tensorPath : ctx.iterationGraph.getTensorPaths()) {
+    const Access& access = tensorPath.getAccess();
+    const vector<IndexVar>& indexVars = access.getIndexVars();
+    for (size_t i = 0; i < indexVars.size(); i++) {
+      if (indexVars[i] == indexVar) {
+        Dimension dimension =
+            access.getTensorVar().getType().getShape().getDimension(i);
+        return dimension.isFixed() ? dimension.getSize() : 0;
+      }
+    }
+  }
+  return 0;
+}
+
+/// Returns how the root loop of a reduction (e.g. `a = b(i) * c(i)` or
+/// `y(j) = A(i,j) * x(i)`) can be parallelized. Scalar results are summed with
+/// an OpenMP reduction. Dense results are summed into private copies of their
+/// values if zeroing and adding the copies (about `2 * size` per thread) costs
+/// less than atomic updates, which we take to cost four times a plain update,
+/// and with atomics otherwise. The number of updates is estimated from the
+/// operand shapes, assuming a sparse loop visits at most eight coordinates.
+/// The strategy is chosen when the kernel is lowered, so the model assumes the
+/// OpenMP default thread count (`OMP_NUM_THREADS` or the number of hardware
+/// threads). A count set at run time through ParallelOptions::numThreads
+/// doesn't change the strategy; both strategies are correct for any count.
+static ReductionStrategy getReductionStrategy(const TensorVar& tensorVar,
+                                              const IndexExpr& indexExpr,
+                                              const Context& ctx) {
+  // The private copies of a reduction are allocated on the stack of each
+  // thread, which bounds their size
+  const size_t maxPrivatizedSize = 32768;
+  const size_t maxSparseExtent = 8;
+
+  const IterationGraph& iterationGraph = ctx.iterationGraph;
+  if (!util::contains(ctx.properties, Compute) ||
+      iterationGraph.getRoots().size() != 1 ||
+      !iterationGraph.isReduction(iterationGraph.getRoots()[0])) {
+    return NoReduction;
+  }
+  const IndexVar& root = iterationGraph.getRoots()[0];
+
+  // Complex and boolean values have no OpenMP reduction or atomic addition,
+  // and 16-bit floats are stored through conversions
+  DataType type = ctx.resultType;
+  if (type.isComplex() || type.isBool() || type.isHalf() ||
+      getTemporaryType(ctx, indexExpr.getDataType()).isComplex()) {
+    return NoReduction;
+  }
+
+  MergeLattice lattice = MergeLattice::make(indexExpr, root, iterationGraph,
+                                            ctx.iterators);
+  if (needsMerge(lattice)) {
+    return NoReduction;
+  }
+
+  const Format& format = tensorVar.getFormat();
+  if (format.getOrder() == 0) {
+    return ScalarReduction;
+  }
+  for (const ModeType& modeType : format.getModeTypes()) {
+    if (modeType != Dense) {
+      return NoReduction;
+    }
+  }
+
+  size_t size = 1;
+  const TensorPath& resultPath = iterationGraph.getResultTensorPath();
+  for (const IndexVar& indexVar : resultPath.getVariables()) {
+    size *= getExtent(indexVar, ctx);
+  }
+  if (size == 0 || size > maxPrivatizedSize) {
+    return AtomicReduction;
+  }
+
+  size_t updates = getExtent(root, ctx);
+  for (const IndexVar& indexVar : iterationGraph.getDescendants(root)) {
+    if (indexVar == root) {
+      continue;
+    }
+    size_t extent = getExtent(indexVar, ctx);
+    for (const TensorPath& tensorPath : iterationGraph.getTensorPaths()) {
+      if (util::contains(tensorPath.getVariables(), indexVar) &&
+          !ctx.iterators[tensorPath.getStep(indexVar)].isDense()) {
+        extent = std::min(extent, maxSparseExtent);
+        break;
+      }
+    }
+    updates *= extent;
+  }
+
+  // The thread count the kernel runs with is only known at run time
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  string numThreads = util::getFromEnv("OMP_NUM_THREADS", "");
+  if (!numThreads.empty() && atoi(numThreads.c_str()) > 0) {
+    threads = atoi(numThreads.c_str());
+  }
+  return (2 * size * threads <= 4 * updates) ? PrivatizedReduction
+                                             : AtomicReduction;
+}
+
 Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
            int allocSize) {
   const bool emitAssemble = util::contains(properties, Assemble);
@@ -582,11 +1371,20 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
 
   IterationGraph iterationGraph = IterationGraph::make(tensorVar);
   Context ctx(iterationGraph, properties, tensorVars);
+  ctx.accumulationType = tensorVar.getAccumulationType();
+  ctx.resultType = tensorVar.getType().getDataType();
+  const bool parallelAssemble = canAssembleInParallel(tensorVar, indexExpr,
+                                                      ctx);
+  ctx.reductionStrategy = getReductionStrategy(tensorVar, indexExpr, ctx);
+  const Iterator balancedIterator = getBalancedIterator(tensorVar, indexExpr,
+                                                        ctx);
+  const Iterator diagonalIterator = getDiagonalIterator(tensorVar, indexExpr,
+                                                        ctx);
 
   vector<Stmt> init, body;
 
   TensorPath resultPath = ctx.iterationGraph.getResultTensorPath();
-  if (emitAssemble) {
+  if (emitAssemble && !parallelAssemble) {
     for (auto& indexVar : resultPath.getVariables()) {
       Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
       Stmt allocStmts = iter.initStorage(ctx.allocSize);
@@ -606,7 +1404,7 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
   }
 
   // Initialize the result pos variables
-  if (emitCompute || emitAssemble) {
+  if ((emitCompute || emitAssemble) && !parallelAssemble) {
     Stmt prevIteratorInit;
     for (auto& indexVar : resultPath.getVariables()) {
       Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
@@ -629,7 +1427,15 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
   auto& roots = ctx.iterationGraph.getRoots();
 
   // Lower tensor expressions
-  if (roots.size() > 0) {
+  if (parallelAssemble) {
+    Target target;
+    target.tensor = GetProperty::make(
+        ctx.iterators[resultPath.getLastStep()].getTensor(),
+        TensorProperty::Values);
+    target.pos = ctx.iterators[resultPath.getLastStep()].getPtrVar();
+    util::append(body, lowerParallelAssembly(target, indexExpr, ctx));
+  }
+  else if (roots.size() > 0) {
     Iterator resultIterator = (resultPath.getSize() > 0)
         ? ctx.iterators[resultPath.getLastStep()]
         : ctx.iterators.getRoot(resultPath);  // e.g. `a = b(i) * c(i)`
@@ -638,7 +1444,18 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
                                       TensorProperty::Values);
     target.pos = resultIterator.getPtrVar();
 
-    if (emitCompute) {
+    // Sum a scalar result of a parallel reduction into a temporary
+    // double ta = 0;
+    Expr values = target.tensor;
+    if (ctx.reductionStrategy == ScalarReduction) {
+      DataType type = getTemporaryType(ctx, indexExpr.getDataType());
+      target.tensor = Var::make("t" + name, type);
+      target.pos    = Expr();
+      ctx.reductionVar = target.tensor;
+      body.push_back(VarAssign::make(target.tensor, 0.0, true));
+    }
+
+    if (emitCompute && ctx.reductionStrategy != ScalarReduction) {
       Expr size = (long long) 1;
       for (auto& indexVar : resultPath.getVariables()) {
         const Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
@@ -648,6 +1465,10 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
         }
         size = Mul::make(size, iter.end());
       }
+      if (ctx.reductionStrategy == PrivatizedReduction) {
+        ctx.reductionVar  = target.tensor;
+        ctx.reductionSize = size;
+      }
 
       if (emitAssemble) {
         Stmt allocVals = Allocate::make(target.tensor, size);
@@ -678,13 +1499,31 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
       }
       return false;
     }());
-    if (emitLoops) {
+    if (emitLoops && balancedIterator.defined()) {
+      util::append(body, lowerBalancedNonzeros(target, indexExpr,
+                                               balancedIterator, ctx));
+    }
+    else if (emitLoops && diagonalIterator.defined()) {
+      util::append(body, lowerDiagonals(target, indexExpr, diagonalIterator,
+                                        ctx));
+    }
+    else if (emitLoops) {
       for (auto& root : roots) {
         auto loopNest = lower::lower(target, root, indexExpr, {}, ctx);
         util::append(body, loopNest);
       }
     }
 
+    // a_vals[0] = ta;
+    if (ctx.reductionStrategy == ScalarReduction) {
+      if (emitAssemble) {
+        init.push_back(Allocate::make(values, (long long) 1));
+      }
+      body.push_back(util::contains(properties, Accumulate)
+                     ? compoundStore(values, (long long) 0, target.tensor)
+                     : Store::make(values, (long long) 0, target.tensor));
+    }
+
     if (emitAssemble && !emitCompute) {
       Expr size = (long long) 1;
       for (auto& indexVar : resultPath.getVariables()) {
@@ -45,6 +45,13 @@ getTensorVars(const TensorVar& tensor) {
       std::map<TensorVar,ir::Expr>> {parameters, results, mapping};
 }
 
+/// True iff `expr` is the integer literal one, such as the implicit value of a
+/// pattern tensor.
+static bool isOne(const ir::Expr& expr) {
+  return isa<Literal>(expr) && to<Literal>(expr)->type.isInt() &&
+         to<Literal>(expr)->int_value == 1;
+}
+
 ir::Expr lowerToScalarExpression(const IndexExpr& indexExpr,
                                  const Iterators& iterators,
                                  const IterationGraph& iterationGraph,
@@ -78,6 +85,14 @@ ir::Expr lowerToScalarExpression(const IndexExpr& indexExpr,
       }
       TensorPath path = iterationGraph.getTensorPath(op);
       Type type = op->tensorVar.getType();
+
+      // Pattern tensors have no values array; every stored value is one,
+      // since their formats store no padding (checked by compile)
+      if (type.getDataType().isBool()) {
+        expr = ir::Expr((long long)1);
+        return;
+      }
+
       storage::Iterator iterator = (type.getShape().getOrder() == 0)
           ? iterators.getRoot(path)
           : iterators[path.getLastStep()];
@@ -105,7 +120,9 @@ ir::Expr lowerToScalarExpression(const IndexExpr& indexExpr,
     }
 
     void visit(const MulNode* op) {
-      expr = ir::Mul::make(lower(op->a), lower(op->b));
+      ir::Expr a = lower(op->a);
+      ir::Expr b = lower(op->b);
+      expr = isOne(a) ? b : isOne(b) ? a : ir::Mul::make(a, b);
     }
 
     void visit(const DivNode* op) {
@@ -26,7 +26,8 @@ std::tuple<std::vector<ir::Expr>,        // parameters
 getTensorVars(const TensorVar&);
 
 /// Lower an index expression to an IR expression that computes the index
-/// expression for one point in the iteration space (a scalar computation)
+/// expression for one point in the iteration space (a scalar computation).
+/// Accesses to pattern (`Bool`) tensors are folded to the constant one.
 ir::Expr
 lowerToScalarExpression(const IndexExpr& indexExpr,
                         const Iterators& iterators,
@@ -0,0 +1,37 @@
+#include "taco/precompiled.h"
+
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+namespace taco {
+
+// Libraries may register their kernels from static initializers, so the
+// registry is constructed on first use
+static map<string,PrecompiledKernels>& getRegistry() {
+  static map<string,PrecompiledKernels> registry;
+  return registry;
+}
+
+static mutex& getRegistryMutex() {
+  static mutex registryMutex;
+  return registryMutex;
+}
+
+void registerKernels(const string& key, const PrecompiledKernels& kernels) {
+  lock_guard<mutex> lock(getRegistryMutex());
+  getRegistry()[key] = kernels;
+}
+
+bool getPrecompiledKernels(const string& key, PrecompiledKernels* kernels) {
+  lock_guard<mutex> lock(getRegistryMutex());
+  auto it = getRegistry().find(key);
+  if (it == getRegistry().end()) {
+    return false;
+  }
+  *kernels = it->second;
+  return true;
+}
+
+}
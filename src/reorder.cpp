@@ -0,0 +1,431 @@
+#include "taco/reorder.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/storage/pack.h"
+#include "taco/storage/numa.h"
+
+using namespace std;
+using namespace taco::storage;
+
+namespace taco {
+
+/// The symmetrized adjacency structure of a square matrix pattern, without
+/// self loops.
+struct Graph {
+  vector<int> pos;
+  vector<int> adj;
+
+  int getNumVertices() const {
+    return (int)pos.size() - 1;
+  }
+
+  int getDegree(int v) const {
+    return pos[v+1] - pos[v];
+  }
+};
+
+static Graph getGraph(const TensorBase& matrix) {
+  const Format& format = matrix.getFormat();
+  taco_uassert(matrix.getOrder() == 2 &&
+               format.getModeTypes()[0] == Dense &&
+               format.getModeTypes()[1] == Sparse) <<
+      "Graph orderings require a CSR or CSC matrix";
+  taco_uassert(matrix.getDimension(0) == matrix.getDimension(1)) <<
+      "Graph orderings require a square matrix";
+  const ModeIndex& modeIndex = matrix.getStorage().getIndex().getModeIndex(1);
+  taco_uassert(modeIndex.numIndexArrays() == 2) <<
+      "The matrix " << matrix.getName() << " must be packed";
+  const int* pos = (const int*)modeIndex.getIndexArray(0).getData();
+  const int* idx = (const int*)modeIndex.getIndexArray(1).getData();
+  const int n = matrix.getDimension(0);
+
+  // Count both directions of every off-diagonal entry
+  vector<int> degrees(n+1, 0);
+  for (int r = 0; r < n; r++) {
+    for (int p = pos[r]; p < pos[r+1]; p++) {
+      if (idx[p] != r) {
+        degrees[r+1]++;
+        degrees[idx[p]+1]++;
+      }
+    }
+  }
+  partial_sum(degrees.begin(), degrees.end(), degrees.begin());
+  vector<int> adj(degrees[n]);
+  vector<int> next(degrees.begin(), degrees.end()-1);
+  for (int r = 0; r < n; r++) {
+    for (int p = pos[r]; p < pos[r+1]; p++) {
+      if (idx[p] != r) {
+        adj[next[r]++] = idx[p];
+        adj[next[idx[p]]++] = r;
+      }
+    }
+  }
+
+  // Symmetric entries were added from both sides, so remove duplicates
+  Graph graph;
+  graph.pos.push_back(0);
+  for (int v = 0; v < n; v++) {
+    auto begin = adj.begin() + degrees[v];
+    auto end   = adj.begin() + degrees[v+1];
+    sort(begin, end);
+    graph.adj.insert(graph.adj.end(), begin, unique(begin, end));
+    graph.pos.push_back((int)graph.adj.size());
+  }
+  return graph;
+}
+
+/// Breadth-first search from `start` through the vertices `v` with
+/// `part[v] == id`, appending them to `order` and visiting the neighbors of
+/// each vertex by increasing degree. `mark` must hold no `stamp` entries.
+/// Returns the number of levels, and the position in `order` where the last
+/// level starts in `lastLevel`.
+static int search(const Graph& graph, int start, const vector<int>& part,
+                  int id, vector<int>& mark, int stamp, vector<int>* order,
+                  size_t* lastLevel) {
+  size_t begin = order->size();
+  order->push_back(start);
+  mark[start] = stamp;
+
+  int numLevels = 0;
+  vector<int> neighbors;
+  while (begin < order->size()) {
+    size_t end = order->size();
+    *lastLevel = begin;
+    numLevels++;
+    for (size_t k = begin; k < end; k++) {
+      int v = (*order)[k];
+      neighbors.clear();
+      for (int p = graph.pos[v]; p < graph.pos[v+1]; p++) {
+        int u = graph.adj[p];
+        if (part[u] == id && mark[u] != stamp) {
+          mark[u] = stamp;
+          neighbors.push_back(u);
+        }
+      }
+      stable_sort(neighbors.begin(), neighbors.end(), [&](int a, int b) {
+        return graph.getDegree(a) < graph.getDegree(b);
+      });
+      order->insert(order->end(), neighbors.begin(), neighbors.end());
+    }
+    begin = end;
+  }
+  return numLevels;
+}
+
+/// Returns a vertex of the component of `start` with a (nearly) maximal
+/// eccentricity, found by repeatedly searching from the vertex of smallest
+/// degree in the last level (George and Liu).
+static int getPseudoPeripheral(const Graph& graph, int start,
+                               const vector<int>& part, int id,
+                               vector<int>& mark, int& stamp) {
+  vector<int> order;
+  size_t lastLevel = 0;
+  int v = start;
+  int numLevels = search(graph, v, part, id, mark, ++stamp, &order,
+                         &lastLevel);
+  while (true) {
+    int u = order[lastLevel];
+    for (size_t k = lastLevel; k < order.size(); k++) {
+      if (graph.getDegree(order[k]) < graph.getDegree(u)) {
+        u = order[k];
+      }
+    }
+
+    vector<int> uorder;
+    size_t ulastLevel = 0;
+    int unumLevels = search(graph, u, part, id, mark, ++stamp, &uorder,
+                            &ulastLevel);
+    if (unumLevels <= numLevels) {
+      return v;
+    }
+    v = u;
+    numLevels = unumLevels;
+    order.swap(uorder);
+    lastLevel = ulastLevel;
+  }
+}
+
+/// Order the vertices `v` with `part[v] == id` by breadth-first searches from
+/// pseudo-peripheral vertices, one per connected component, and set their
+/// part to `newId`.
+static vector<int> getLevelOrder(const Graph& graph, const vector<int>& vertices,
+                                 vector<int>& part, int id, int newId,
+                                 vector<int>& mark, int& stamp) {
+  vector<int> order;
+  order.reserve(vertices.size());
+  for (int v : vertices) {
+    if (part[v] != id) {
+      continue;
+    }
+    int start = getPseudoPeripheral(graph, v, part, id, mark, stamp);
+    size_t begin = order.size();
+    size_t lastLevel;
+    search(graph, start, part, id, mark, ++stamp, &order, &lastLevel);
+    for (size_t k = begin; k < order.size(); k++) {
+      part[order[k]] = newId;
+    }
+  }
+  return order;
+}
+
+vector<int> getRCMOrdering(const TensorBase& matrix) {
+  Graph graph = getGraph(matrix);
+  const int n = graph.getNumVertices();
+
+  // Start the components from low-degree vertices
+  vector<int> vertices(n);
+  iota(vertices.begin(), vertices.end(), 0);
+  stable_sort(vertices.begin(), vertices.end(), [&](int a, int b) {
+    return graph.getDegree(a) < graph.getDegree(b);
+  });
+
+  vector<int> part(n, 0);
+  vector<int> mark(n, 0);
+  int stamp = 0;
+  vector<int> ordering = getLevelOrder(graph, vertices, part, 0, -1, mark,
+                                       stamp);
+  reverse(ordering.begin(), ordering.end());
+  return ordering;
+}
+
+static void bisect(const Graph& graph, const vector<int>& vertices,
+                   vector<int>& part, int& numParts, vector<int>& mark,
+                   int& stamp, int partSize, vector<int>* ordering) {
+  if ((int)vertices.size() <= partSize) {
+    ordering->insert(ordering->end(), vertices.begin(), vertices.end());
+    return;
+  }
+
+  // Split the level order in half, so that each half is a set of consecutive
+  // breadth-first levels
+  int id = part[vertices[0]];
+  vector<int> order = getLevelOrder(graph, vertices, part, id, -1, mark, stamp);
+  size_t half = order.size() / 2;
+  vector<int> first(order.begin(), order.begin() + half);
+  vector<int> second(order.begin() + half, order.end());
+  int firstId = numParts++;
+  int secondId = numParts++;
+  for (int v : first) {
+    part[v] = firstId;
+  }
+  for (int v : second) {
+    part[v] = secondId;
+  }
+  bisect(graph, first, part, numParts, mark, stamp, partSize, ordering);
+  bisect(graph, second, part, numParts, mark, stamp, partSize, ordering);
+}
+
+vector<int> getBisectionOrdering(const TensorBase& matrix, int partSize) {
+  taco_uassert(partSize > 0) << "The part size must be positive";
+  Graph graph = getGraph(matrix);
+  const int n = graph.getNumVertices();
+
+  vector<int> vertices(n);
+  iota(vertices.begin(), vertices.end(), 0);
+  vector<int> part(n, 0);
+  vector<int> mark(n, 0);
+  int stamp = 0;
+  int numParts = 1;
+  vector<int> ordering;
+  ordering.reserve(n);
+  bisect(graph, vertices, part, numParts, mark, stamp, partSize, &ordering);
+  return ordering;
+}
+
+/// Check that the tensor is packed with dense and sparse modes only.
+static void checkPermutable(const TensorBase& tensor) {
+  const Index& index = tensor.getStorage().getIndex();
+  for (size_t i = 0; i < tensor.getOrder(); i++) {
+    ModeType modeType = tensor.getFormat().getModeTypes()[i];
+    taco_uassert(modeType == Dense || modeType == Sparse) <<
+        "Only tensors with dense and sparse modes can be reordered";
+    taco_uassert(modeType == Dense ||
+                 index.getModeIndex(i).numIndexArrays() == 2) <<
+        "The tensor " << tensor.getName() << " must be packed";
+  }
+}
+
+vector<int> getDegreeOrdering(const TensorBase& tensor, bool decreasing) {
+  taco_uassert(tensor.getOrder() > 0) << "Scalars cannot be reordered";
+  checkPermutable(tensor);
+  const Format& format = tensor.getFormat();
+  const Index& index = tensor.getStorage().getIndex();
+  const size_t order = tensor.getOrder();
+  const int n = tensor.getDimension(format.getModeOrdering()[0]);
+
+  // The first-level positions and their coordinates
+  vector<pair<int,int>> positions;
+  if (format.getModeTypes()[0] == Dense) {
+    for (int c = 0; c < n; c++) {
+      positions.push_back({c, c});
+    }
+  }
+  else {
+    const int* pos = (const int*)index.getModeIndex(0).getIndexArray(0).getData();
+    const int* idx = (const int*)index.getModeIndex(0).getIndexArray(1).getData();
+    for (int p = pos[0]; p < pos[1]; p++) {
+      positions.push_back({p, idx[p]});
+    }
+  }
+
+  // Count the components under each position by following the segment
+  // bounds down the levels
+  vector<long long> degrees(n, 0);
+  for (auto& position : positions) {
+    long long begin = position.first;
+    long long end   = position.first + 1;
+    for (size_t i = 1; i < order; i++) {
+      if (format.getModeTypes()[i] == Dense) {
+        long long size = tensor.getDimension(format.getModeOrdering()[i]);
+        begin *= size;
+        end   *= size;
+      }
+      else {
+        const int* pos =
+            (const int*)index.getModeIndex(i).getIndexArray(0).getData();
+        begin = pos[begin];
+        end   = pos[end];
+      }
+    }
+    degrees[position.second] = end - begin;
+  }
+
+  vector<int> ordering(n);
+  iota(ordering.begin(), ordering.end(), 0);
+  stable_sort(ordering.begin(), ordering.end(), [&](int a, int b) {
+    return decreasing ? degrees[a] > degrees[b] : degrees[a] < degrees[b];
+  });
+  return ordering;
+}
+
+vector<int> invertPermutation(const vector<int>& permutation) {
+  vector<int> inverse(permutation.size());
+  for (size_t k = 0; k < permutation.size(); k++) {
+    inverse[permutation[k]] = (int)k;
+  }
+  return inverse;
+}
+
+/// Copy the subtree at position `pos` of level `i`, with permuted coordinates,
+/// appending the new index vectors to `indices` and the old positions of the
+/// values to `valuePositions`.
+static void permuteLevel(const vector<int>& dimensions, const Index& index,
+                         const vector<ModeType>& modeTypes,
+                         const vector<vector<int>>& permutations,
+                         const vector<vector<int>>& inverses, size_t i,
+                         long long pos, vector<vector<vector<int>>>* indices,
+                         vector<long long>* valuePositions) {
+  if (i == dimensions.size()) {
+    valuePositions->push_back(pos);
+    return;
+  }
+
+  const vector<int>& permutation = permutations[i];
+  switch (modeTypes[i]) {
+    case Dense: {
+      const int size = dimensions[i];
+      for (int k = 0; k < size; k++) {
+        int c = permutation.empty() ? k : permutation[k];
+        permuteLevel(dimensions, index, modeTypes, permutations, inverses, i+1,
+                     pos*size + c, indices, valuePositions);
+      }
+      break;
+    }
+    case Sparse: {
+      const ModeIndex& modeIndex = index.getModeIndex(i);
+      const int* oldPos = (const int*)modeIndex.getIndexArray(0).getData();
+      const int* oldIdx = (const int*)modeIndex.getIndexArray(1).getData();
+
+      // Relabel the segment, and sort it if the mode is permuted
+      vector<pair<int,int>> segment;
+      for (int p = oldPos[pos]; p < oldPos[pos+1]; p++) {
+        int c = permutation.empty() ? oldIdx[p] : inverses[i][oldIdx[p]];
+        segment.push_back({c, p});
+      }
+      if (!permutation.empty()) {
+        sort(segment.begin(), segment.end());
+      }
+
+      auto& newIndex = (*indices)[i];
+      for (auto& entry : segment) {
+        newIndex[1].push_back(entry.first);
+        permuteLevel(dimensions, index, modeTypes, permutations, inverses, i+1,
+                     entry.second, indices, valuePositions);
+      }
+      newIndex[0].push_back((int)newIndex[1].size());
+      break;
+    }
+    case Fixed:
+    case Diagonal:
+      taco_not_supported_yet;
+      break;
+  }
+}
+
+TensorBase permute(const TensorBase& tensor,
+                   const vector<vector<int>>& permutations) {
+  const size_t order = tensor.getOrder();
+  taco_uassert(permutations.size() == order) <<
+      "Expected one permutation per mode of " << tensor.getName();
+  checkPermutable(tensor);
+  const Format& format = tensor.getFormat();
+  const Storage& storage = tensor.getStorage();
+
+  // Permutations and dimensions in the storage order of the modes
+  vector<int> dimensions(order);
+  vector<vector<int>> levelPermutations(order), inverses(order);
+  for (size_t i = 0; i < order; i++) {
+    size_t mode = format.getModeOrdering()[i];
+    dimensions[i] = tensor.getDimension(mode);
+    levelPermutations[i] = permutations[mode];
+    if (!permutations[mode].empty()) {
+      taco_uassert(permutations[mode].size() == (size_t)dimensions[i]) <<
+          "The permutation of mode " << mode << " has the wrong size";
+      inverses[i] = invertPermutation(permutations[mode]);
+    }
+  }
+
+  vector<vector<vector<int>>> indices;
+  for (size_t i = 0; i < order; i++) {
+    indices.push_back(format.getModeTypes()[i] == Sparse
+                      ? vector<vector<int>>({{0}, {}})
+                      : vector<vector<int>>());
+  }
+  vector<long long> valuePositions;
+  permuteLevel(dimensions, storage.getIndex(), format.getModeTypes(),
+               levelPermutations, inverses, 0, 0, &indices, &valuePositions);
+
+  TensorBase result(tensor.getComponentType(), tensor.getDimensions(), format);
+  Storage permuted(format);
+  auto bounds = getLevelBounds(dimensions, format.getModeTypes(), indices);
+  permuted.setIndex(makeIndex(dimensions, format, indices, bounds));
+
+  // Gather the values into their new positions
+  const DataType type = tensor.getComponentType();
+  const char* vals = (const char*)storage.getValues().getData();
+  if (vals == nullptr || order == 0) {
+    permuted.setValues(storage.getValues());
+  }
+  else {
+    const size_t size = type.getNumBytes();
+    vector<char> gathered(valuePositions.size() * size);
+    for (size_t k = 0; k < valuePositions.size(); k++) {
+      memcpy(&gathered[k*size], vals + valuePositions[k]*size, size);
+    }
+    void* data = allocatePlaced(gathered.data(), size, valuePositions.size(),
+                                bounds[order-1]);
+    permuted.setValues(Array(type, data, valuePositions.size()));
+  }
+  result.getStorage() = permuted;
+  return result;
+}
+
+}
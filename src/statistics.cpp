@@ -0,0 +1,355 @@
+#include "taco/statistics.h"
+
+#include <algorithm>
+#include <complex>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+#include "taco/error.h"
+#include "taco/hybrid.h"
+#include "taco/expr/expr_nodes.h"
+#include "taco/expr/expr_visitor.h"
+#include "taco/expr/expr_rewriter.h"
+#include "expr/access_tensor_node.h"
+#include "taco/util/collections.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+
+namespace taco {
+
+static double getSize(const vector<int>& dimensions) {
+  double size = 1.0;
+  for (int dimension : dimensions) {
+    size *= dimension;
+  }
+  return size;
+}
+
+double SparsityStatistics::getDensity() const {
+  double size = getSize(dimensions);
+  return (size > 0) ? nnz / size : 0.0;
+}
+
+double SparsityStatistics::getBlockDensity() const {
+  return (numBlocks > 0) ? nnz / ((double)numBlocks * blockSize * blockSize)
+                         : 0.0;
+}
+
+double SparsityStatistics::getDiagonalDensity() const {
+  return (dimensions.size() == 2 && !diagonals.empty())
+         ? nnz / ((double)diagonals.size() * dimensions[0]) : 0.0;
+}
+
+double SparsityStatistics::getEllDensity() const {
+  return (dimensions.size() == 2 && maxSliceSize > 0)
+         ? nnz / ((double)maxSliceSize * dimensions[0]) : 0.0;
+}
+
+SparsityStatistics getStatistics(const vector<int>& dimensions,
+                                 vector<vector<int>> coordinates,
+                                 int blockSize) {
+  taco_uassert(blockSize > 0) << "The block size must be positive";
+  sort(coordinates.begin(), coordinates.end());
+  coordinates.erase(unique(coordinates.begin(), coordinates.end()),
+                    coordinates.end());
+
+  SparsityStatistics stats;
+  stats.dimensions = dimensions;
+  stats.nnz = coordinates.size();
+  if (dimensions.empty()) {
+    return stats;
+  }
+
+  stats.sliceSizes.resize(dimensions[0], 0);
+  for (auto& coordinate : coordinates) {
+    taco_uassert(coordinate.size() == dimensions.size()) <<
+        "Expected coordinates with " << dimensions.size() << " components";
+    stats.sliceSizes[coordinate[0]]++;
+  }
+  for (int sliceSize : stats.sliceSizes) {
+    stats.maxSliceSize = max(stats.maxSliceSize, sliceSize);
+    stats.numNonemptySlices += (sliceSize > 0);
+  }
+  stats.sliceHistogram.resize(stats.maxSliceSize + 1, 0);
+  for (int sliceSize : stats.sliceSizes) {
+    stats.sliceHistogram[sliceSize]++;
+  }
+
+  if (dimensions.size() == 2) {
+    set<int> diagonals;
+    set<pair<int,int>> blocks;
+    for (auto& coordinate : coordinates) {
+      int offset = coordinate[1] - coordinate[0];
+      stats.lowerBandwidth = max(stats.lowerBandwidth, -offset);
+      stats.upperBandwidth = max(stats.upperBandwidth, offset);
+      diagonals.insert(offset);
+      blocks.insert({coordinate[0] / blockSize, coordinate[1] / blockSize});
+    }
+    stats.diagonals.assign(diagonals.begin(), diagonals.end());
+    stats.blockSize = blockSize;
+    stats.numBlocks = blocks.size();
+  }
+  return stats;
+}
+
+template <typename T>
+struct GetCoordinates {
+  static void apply(const TensorBase& tensor,
+                    vector<vector<int>>* coordinates) {
+    for (auto& component : iterate<T>(tensor)) {
+      if (component.second != T()) {
+        coordinates->push_back(component.first);
+      }
+    }
+  }
+};
+
+SparsityStatistics getStatistics(const TensorBase& tensor, int blockSize) {
+  vector<vector<int>> coordinates;
+  dispatchType<GetCoordinates>(tensor.getComponentType(), tensor,
+                               &coordinates);
+  return getStatistics(tensor.getDimensions(), coordinates, blockSize);
+}
+
+std::ostream& operator<<(std::ostream& os, const SparsityStatistics& stats) {
+  os << "dimensions:  " << util::join(stats.dimensions, "x") << endl;
+  os << "nnz:         " << stats.nnz << " (density " << stats.getDensity()
+     << ")" << endl;
+  os << "slices:      " << stats.numNonemptySlices << " nonempty, at most "
+     << stats.maxSliceSize << " nonzeros";
+  if (stats.dimensions.size() == 2) {
+    os << endl;
+    os << "bandwidth:   " << stats.lowerBandwidth << " below, "
+       << stats.upperBandwidth << " above" << endl;
+    os << "diagonals:   " << stats.diagonals.size() << " (density "
+       << stats.getDiagonalDensity() << ")" << endl;
+    os << "blocks:      " << stats.numBlocks << " of " << stats.blockSize << "x"
+       << stats.blockSize << " (density " << stats.getBlockDensity() << ")";
+  }
+  return os;
+}
+
+vector<Format> getCandidateFormats(const SparsityStatistics& stats) {
+  const size_t order = stats.dimensions.size();
+  if (order == 0) {
+    return {Format()};
+  }
+
+  const Format dense(vector<ModeType>(order, Dense));
+  const bool hypersparse = stats.numNonemptySlices * 2 < stats.dimensions[0];
+  if (order != 2) {
+    vector<ModeType> modeTypes(order, Sparse);
+    modeTypes[0] = hypersparse ? Sparse : Dense;
+    Format sparse(modeTypes);
+    return (stats.getDensity() >= 0.25) ? vector<Format>({dense, sparse})
+                                        : vector<Format>({sparse, dense});
+  }
+
+  // Candidates that suit the structure, in order of preference, followed by
+  // the general sparse formats
+  vector<Format> candidates;
+  if (stats.getDensity() >= 0.25) {
+    candidates.push_back(dense);
+  }
+  if (stats.getDiagonalDensity() >= 0.5) {
+    candidates.push_back(DIA);
+  }
+  if (hypersparse) {
+    candidates.push_back(DCSR);
+  }
+  else if (stats.getEllDensity() >= 0.75) {
+    candidates.push_back(ELL);
+  }
+  for (const Format& format : {CSR, DCSR, dense}) {
+    if (!util::contains(candidates, format)) {
+      candidates.push_back(format);
+    }
+  }
+  return candidates;
+}
+
+Format adviseFormat(const SparsityStatistics& stats) {
+  return getCandidateFormats(stats)[0];
+}
+
+namespace {
+
+/// Computes an upper bound on the nonzeros of an expression, over the space of
+/// its index variables, from the nonzeros of its operands. A subexpression
+/// over fewer variables is repeated along the others, so its bound is scaled
+/// by their dimensions. Sums are then bounded by the sum, and products by the
+/// smallest scaled bound of a factor and by the product of the bounds, since
+/// every nonzero product needs a nonzero in each factor.
+struct EstimateNonzeros : public ExprVisitor {
+  using ExprVisitor::visit;
+  map<TensorBase,size_t> nnz;
+  map<IndexVar,int> dimensions;
+  double estimate;
+  set<IndexVar> vars;
+
+  double get(const IndexExpr& expr) {
+    expr.accept(this);
+    return estimate;
+  }
+
+  /// The volume of the space of the variables in `vars` but not in `exclude`.
+  double getVolume(const set<IndexVar>& exclude) const {
+    double size = 1.0;
+    for (auto& var : vars) {
+      if (!util::contains(exclude, var)) {
+        size *= dimensions.at(var);
+      }
+    }
+    return size;
+  }
+
+  void visit(const AccessNode* node) {
+    auto access = to<AccessTensorNode>(node);
+    estimate = nnz.at(access->tensor);
+    vars.clear();
+    for (size_t i = 0; i < access->indexVars.size(); i++) {
+      dimensions[access->indexVars[i]] = access->tensor.getDimension(i);
+      vars.insert(access->indexVars[i]);
+    }
+  }
+  void visit(const NegNode* node) {
+    estimate = get(node->a);
+  }
+  void visit(const SqrtNode* node) {
+    estimate = get(node->a);
+  }
+  void visit(const AddNode* node) {
+    visitSum(node->a, node->b);
+  }
+  void visit(const SubNode* node) {
+    visitSum(node->a, node->b);
+  }
+  void visit(const MulNode* node) {
+    double a = get(node->a);
+    set<IndexVar> aVars = vars;
+    double b = get(node->b);
+    set<IndexVar> bVars = vars;
+    vars.insert(aVars.begin(), aVars.end());
+    estimate = min({a * getVolume(aVars), b * getVolume(bVars), a * b,
+                    getVolume({})});
+  }
+  void visit(const DivNode* node) {
+    double a = get(node->a);
+    set<IndexVar> aVars = vars;
+    get(node->b);
+    vars.insert(aVars.begin(), aVars.end());
+    estimate = a * getVolume(aVars);
+  }
+  void visit(const IntImmNode*) {
+    visitImm();
+  }
+  void visit(const FloatImmNode*) {
+    visitImm();
+  }
+  void visit(const ComplexImmNode*) {
+    visitImm();
+  }
+  void visit(const UIntImmNode*) {
+    visitImm();
+  }
+
+  void visitSum(const IndexExpr& aExpr, const IndexExpr& bExpr) {
+    double a = get(aExpr);
+    set<IndexVar> aVars = vars;
+    double b = get(bExpr);
+    set<IndexVar> bVars = vars;
+    vars.insert(aVars.begin(), aVars.end());
+    estimate = min(a * getVolume(aVars) + b * getVolume(bVars), getVolume({}));
+  }
+  void visitImm() {
+    estimate = 1.0;
+    vars.clear();
+  }
+};
+
+}
+
+/// Returns a copy of a packed tensor in another format.
+static TensorBase convert(const TensorBase& tensor, const Format& format) {
+  TensorBase copy(tensor.getName(), tensor.getComponentType(),
+                  tensor.getDimensions(), format);
+  insertComponents(tensor, &copy);
+  copy.pack();
+  return copy;
+}
+
+/// Returns the median assemble and compute time, in milliseconds, of the
+/// expression of `result` with `operand` replaced by `replacement`.
+static double time(const TensorBase& result, const TensorBase& operand,
+                   const TensorBase& replacement, size_t allocSize,
+                   int repeat) {
+  IndexExpr expr = result.getTensorVar().getIndexExpr();
+  TensorBase kernel(result.getName(), result.getComponentType(),
+                    result.getDimensions(), result.getFormat());
+  kernel.setAllocSize(allocSize);
+  kernel.setIndexExpression(result.getTensorVar().getFreeVars(),
+                            replace(expr, getSubstitutions(expr, operand,
+                                                    replacement)));
+  kernel.compile();
+
+  util::Timer timer;
+  for (int i = 0; i < repeat; i++) {
+    timer.start();
+    kernel.assemble();
+    kernel.compute();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+FormatAdvice adviseFormats(const TensorBase& result, bool validate,
+                           int repeat) {
+  IndexExpr expr = result.getTensorVar().getIndexExpr();
+  taco_uassert(expr.defined()) << error::compile_without_expr;
+  taco_uassert(repeat > 0) << "The number of timed runs must be positive";
+
+
+  FormatAdvice advice;
+  EstimateNonzeros estimateNonzeros;
+  vector<vector<Format>> candidates;
+  for (auto& operand : getTensors(expr)) {
+    SparsityStatistics stats = getStatistics(operand);
+    estimateNonzeros.nnz.insert({operand, stats.nnz});
+    candidates.push_back(getCandidateFormats(stats));
+    advice.operands.push_back(operand);
+    advice.formats.push_back(candidates.back()[0]);
+  }
+
+  // Index allocations double when full, so round the estimate up to a power
+  // of two (the smallest allowed size is two)
+  double nnz = min(estimateNonzeros.get(expr),
+                   getSize(result.getDimensions()));
+  advice.allocSize = 2;
+  while (advice.allocSize < nnz) {
+    advice.allocSize *= 2;
+  }
+
+  if (validate) {
+    for (size_t i = 0; i < advice.operands.size(); i++) {
+      const TensorBase& operand = advice.operands[i];
+      if (operand.getOrder() == 0 || candidates[i].size() < 2) {
+        continue;
+      }
+      double fastest = -1.0;
+      for (auto& format : candidates[i]) {
+        double t = time(result, operand, convert(operand, format),
+                        advice.allocSize, repeat);
+        if (fastest < 0.0 || t < fastest) {
+          fastest = t;
+          advice.formats[i] = format;
+        }
+      }
+    }
+  }
+  return advice;
+}
+
+}
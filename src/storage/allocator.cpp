@@ -0,0 +1,285 @@
+#include "taco/storage/allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "taco/error.h"
+
+using namespace std;
+
+namespace taco {
+namespace storage {
+
+// The size (and alignment) of a transparent huge page on x86-64 and aarch64.
+static const size_t HUGE_PAGE_SIZE = size_t(1) << 21;
+
+/// Advise the kernel to back the whole pages of [ptr, ptr+size) with huge pages.
+static void adviseHugePages(void* ptr, size_t size) {
+#ifdef MADV_HUGEPAGE
+  static const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = ((uintptr_t)ptr + pageSize - 1) & ~(pageSize - 1);
+  uintptr_t end   = ((uintptr_t)ptr + size) & ~(pageSize - 1);
+  if (begin < end) {
+    // Advisory only: a kernel without THP support rejects it, which is fine.
+    madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+  }
+#endif
+}
+
+static size_t getPageSize() {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+}
+
+// class Allocator
+Allocator::~Allocator() {
+}
+
+void* Allocator::allocateAligned(size_t size, size_t alignment) {
+  return (alignment <= ARRAY_ALIGNMENT && isAligned()) ? allocate(size)
+                                                        : nullptr;
+}
+
+
+// class AlignedAllocator
+AlignedAllocator::AlignedAllocator(size_t hugePageThreshold)
+    : hugePageThreshold(hugePageThreshold) {
+}
+
+void* AlignedAllocator::allocate(size_t size) {
+  return allocateAligned(size, ARRAY_ALIGNMENT);
+}
+
+void* AlignedAllocator::allocateAligned(size_t size, size_t alignment) {
+  bool huge = hugePageThreshold > 0 && size >= hugePageThreshold;
+  alignment = max(alignment, huge ? HUGE_PAGE_SIZE : ARRAY_ALIGNMENT);
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, alignment, size) != 0) {
+    return nullptr;
+  }
+  if (huge) {
+    adviseHugePages(ptr, size);
+  }
+  return ptr;
+}
+
+void* AlignedAllocator::reallocate(void* ptr, size_t size) {
+  if (ptr == nullptr) {
+    return allocate(size);
+  }
+
+  // realloc usually keeps the allocation in place and only has to be undone
+  // when it moved the data to a misaligned address.
+  void* resized = realloc(ptr, size);
+  if (resized == nullptr) {
+    return nullptr;
+  }
+  if (!storage::isAligned(resized)) {
+    void* aligned = allocate(size);
+    if (aligned != nullptr) {
+      memcpy(aligned, resized, size);
+    }
+    free(resized);
+    return aligned;
+  }
+  if (hugePageThreshold > 0 && size >= hugePageThreshold) {
+    adviseHugePages(resized, size);
+  }
+  return resized;
+}
+
+void AlignedAllocator::deallocate(void* ptr) {
+  free(ptr);
+}
+
+bool AlignedAllocator::isAligned() const {
+  return true;
+}
+
+size_t AlignedAllocator::getHugePageThreshold() const {
+  return hugePageThreshold;
+}
+
+
+// class PoolAllocator
+static const int MIN_SIZE_CLASS = 6;  // log2(ARRAY_ALIGNMENT)
+
+static int getSizeClass(size_t size) {
+  int sizeClass = MIN_SIZE_CLASS;
+  while ((size_t(1) << sizeClass) < size) {
+    sizeClass++;
+  }
+  return sizeClass;
+}
+
+PoolAllocator::PoolAllocator(size_t maxCachedBytes, size_t hugePageThreshold)
+    : allocator(hugePageThreshold), maxCachedBytes(maxCachedBytes),
+      cachedBytes(0), numReused(0) {
+}
+
+PoolAllocator::~PoolAllocator() {
+  trim();
+}
+
+void* PoolAllocator::allocateBlock(int sizeClass) {
+  if ((size_t)sizeClass < freeLists.size() && !freeLists[sizeClass].empty()) {
+    void* ptr = freeLists[sizeClass].back();
+    freeLists[sizeClass].pop_back();
+    cachedBytes -= size_t(1) << sizeClass;
+    numReused++;
+    blocks[ptr] = sizeClass;
+    return ptr;
+  }
+  size_t size = size_t(1) << sizeClass;
+  void* ptr = allocator.allocateAligned(size, size >= getPageSize() ?
+                                              getPageSize() : ARRAY_ALIGNMENT);
+  if (ptr != nullptr) {
+    blocks[ptr] = sizeClass;
+  }
+  return ptr;
+}
+
+void PoolAllocator::releaseBlock(void* ptr, int sizeClass) {
+  blocks.erase(ptr);
+  size_t size = size_t(1) << sizeClass;
+  if (cachedBytes + size > maxCachedBytes) {
+    allocator.deallocate(ptr);
+    return;
+  }
+  if ((size_t)sizeClass >= freeLists.size()) {
+    freeLists.resize(sizeClass + 1);
+  }
+  freeLists[sizeClass].push_back(ptr);
+  cachedBytes += size;
+}
+
+void* PoolAllocator::allocate(size_t size) {
+  lock_guard<mutex> lock(blocksMutex);
+  return allocateBlock(getSizeClass(size));
+}
+
+void* PoolAllocator::allocateAligned(size_t size, size_t alignment) {
+  if (alignment > getPageSize()) {
+    return nullptr;
+  }
+  lock_guard<mutex> lock(blocksMutex);
+  return allocateBlock(getSizeClass(max(size, alignment)));
+}
+
+void* PoolAllocator::reallocate(void* ptr, size_t size) {
+  if (ptr == nullptr) {
+    return allocate(size);
+  }
+
+  lock_guard<mutex> lock(blocksMutex);
+  auto block = blocks.find(ptr);
+  if (block == blocks.end()) {
+    // not ours, so it was allocated with malloc
+    return allocator.reallocate(ptr, size);
+  }
+
+  int sizeClass = block->second;
+  int newSizeClass = getSizeClass(size);
+  if (newSizeClass <= sizeClass) {
+    return ptr;
+  }
+  void* resized = allocateBlock(newSizeClass);
+  if (resized != nullptr) {
+    memcpy(resized, ptr, size_t(1) << sizeClass);
+    releaseBlock(ptr, sizeClass);
+  }
+  return resized;
+}
+
+void PoolAllocator::deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  lock_guard<mutex> lock(blocksMutex);
+  auto block = blocks.find(ptr);
+  if (block == blocks.end()) {
+    allocator.deallocate(ptr);
+    return;
+  }
+  releaseBlock(ptr, block->second);
+}
+
+bool PoolAllocator::isAligned() const {
+  return allocator.isAligned();
+}
+
+void PoolAllocator::trim() {
+  lock_guard<mutex> lock(blocksMutex);
+  for (auto& freeList : freeLists) {
+    for (void* ptr : freeList) {
+      allocator.deallocate(ptr);
+    }
+    freeList.clear();
+  }
+  cachedBytes = 0;
+}
+
+size_t PoolAllocator::getCachedBytes() const {
+  lock_guard<mutex> lock(blocksMutex);
+  return cachedBytes;
+}
+
+size_t PoolAllocator::getNumReused() const {
+  lock_guard<mutex> lock(blocksMutex);
+  return numReused;
+}
+
+
+static shared_ptr<Allocator>& allocatorInstance() {
+  // Never destroyed, since static arrays may be released after main returns
+  static shared_ptr<Allocator>* allocator =
+      new shared_ptr<Allocator>(make_shared<AlignedAllocator>());
+  return *allocator;
+}
+
+shared_ptr<Allocator> getAllocator() {
+  return atomic_load(&allocatorInstance());
+}
+
+void setAllocator(shared_ptr<Allocator> allocator) {
+  taco_uassert(allocator != nullptr) << "The tensor allocator cannot be null";
+  atomic_store(&allocatorInstance(), allocator);
+}
+
+void* allocate(size_t size) {
+  return getAllocator()->allocate(size);
+}
+
+void* reallocate(void* ptr, size_t size) {
+  return getAllocator()->reallocate(ptr, size);
+}
+
+void deallocate(void* ptr) {
+  getAllocator()->deallocate(ptr);
+}
+
+bool isAligned(const void* ptr, size_t alignment) {
+  return (uintptr_t)ptr % alignment == 0;
+}
+
+}}
+
+extern "C" {
+
+void* taco_allocate(size_t size) {
+  return taco::storage::allocate(size);
+}
+
+void* taco_reallocate(void* ptr, size_t size) {
+  return taco::storage::reallocate(ptr, size);
+}
+
+void taco_deallocate(void* ptr) {
+  taco::storage::deallocate(ptr);
+}
+
+}
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <iostream>
 
+#include "taco/storage/allocator.h"
 #include "taco/type.h"
 #include "taco/error.h"
 #include "taco/util/uncopyable.h"
@@ -15,8 +16,8 @@ namespace storage {
 
 struct Array::Content : util::Uncopyable {
   DataType   type;
-  void*  data;
-  size_t size;
+  void*  data = nullptr;
+  size_t size = 0;
   Policy policy = Array::UserOwns;
 
   ~Content() {
@@ -25,7 +26,7 @@ struct Array::Content : util::Uncopyable {
         // do nothing
         break;
       case Free:
-        free(data);
+        deallocate(data);
         break;
       case Delete:
         switch (type.getKind()) {
@@ -62,6 +63,12 @@ struct Array::Content : util::Uncopyable {
           case DataType::Int128:
             delete[] ((long long*)data);
             break;
+          case DataType::Float16:
+            delete[] ((float16*)data);
+            break;
+          case DataType::BFloat16:
+            delete[] ((bfloat16*)data);
+            break;
           case DataType::Float32:
             delete[] ((float*)data);
             break;
@@ -162,6 +169,12 @@ std::ostream& operator<<(std::ostream& os, const Array& array) {
     case DataType::Int128:
       printData<long long>(os, array);
       break;
+    case DataType::Float16:
+      printData<float16>(os, array);
+      break;
+    case DataType::BFloat16:
+      printData<bfloat16>(os, array);
+      break;
     case DataType::Float32:
       printData<float>(os, array);
       break;
@@ -38,6 +38,10 @@ bool DenseIterator::isSequentialAccess() const {
   return false;
 }
 
+bool DenseIterator::isZeroPadded() const {
+  return false;
+}
+
 Expr DenseIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -61,6 +65,10 @@ Expr DenseIterator::end() const {
   return getSizeArr();
 }
 
+Expr DenseIterator::inBounds() const {
+  return Expr();
+}
+
 Stmt DenseIterator::initDerivedVars() const {
   Expr ptrVal = Add::make(Mul::make(getParent().getPtrVar(), end()),
                           getIdxVar());
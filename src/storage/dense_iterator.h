@@ -20,6 +20,7 @@ public:
 
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
+  bool isZeroPadded() const;
 
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
@@ -28,6 +29,8 @@ public:
   ir::Expr begin() const;
   ir::Expr end() const;
 
+  ir::Expr inBounds() const;
+
   ir::Stmt initDerivedVars() const;
 
   ir::Stmt storePtr() const;
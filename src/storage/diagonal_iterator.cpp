@@ -0,0 +1,124 @@
+#include "diagonal_iterator.h"
+
+#include "ir/ir_generators.h"
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+DiagonalIterator::DiagonalIterator(std::string name, const Expr& tensor,
+                                   int level, Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+
+  std::string idxVarName = name + util::toString(tensor);
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     Int());
+  idxVar = Var::make(idxVarName, Int());
+  diagVar = Var::make("d" + util::toString(tensor) + std::to_string(level + 1),
+                      Int());
+}
+
+bool DiagonalIterator::isDense() const {
+  return false;
+}
+
+bool DiagonalIterator::isFixedRange() const {
+  return false;
+}
+
+bool DiagonalIterator::isRandomAccess() const {
+  return false;
+}
+
+bool DiagonalIterator::isSequentialAccess() const {
+  return true;
+}
+
+bool DiagonalIterator::isZeroPadded() const {
+  return false;
+}
+
+Expr DiagonalIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr DiagonalIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr DiagonalIterator::getIteratorVar() const {
+  return diagVar;
+}
+
+Expr DiagonalIterator::begin() const {
+  return (long long) 0;
+}
+
+Expr DiagonalIterator::end() const {
+  return Load::make(getSizeArr(), (long long) 0);
+}
+
+Expr DiagonalIterator::inBounds() const {
+  return conjunction({Lte::make((long long) 0, getIdxVar()),
+                      Lt::make(getIdxVar(),
+                               Load::make(getSizeArr(), (long long) 1))});
+}
+
+Stmt DiagonalIterator::initDerivedVars() const {
+  // Values are stored diagonal-major with one slot per row, and the parent
+  // (dense row) ptr is the row index.
+  Expr parentPtr = getParent().getPtrVar();
+  Stmt initPtr = VarAssign::make(getPtrVar(),
+                                 Add::make(Mul::make(getIteratorVar(),
+                                                     getParent().end()),
+                                           parentPtr), true);
+  Stmt initIdx = VarAssign::make(getIdxVar(),
+                                 Add::make(parentPtr,
+                                           Load::make(getOffsetArr(),
+                                                      getIteratorVar())), true);
+  return Block::make({initPtr, initIdx});
+}
+
+// Diagonal modes cannot be results (see TensorBase::compile), so they are
+// never assembled.
+ir::Stmt DiagonalIterator::storePtr() const {
+  taco_ierror << "Diagonal modes cannot be assembled";
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::storeIdx(ir::Expr idx) const {
+  taco_ierror << "Diagonal modes cannot be assembled";
+  return Stmt();
+}
+
+ir::Expr DiagonalIterator::getSizeArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_size";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 0, name);
+}
+
+ir::Expr DiagonalIterator::getOffsetArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_offset";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+ir::Stmt DiagonalIterator::initStorage(ir::Expr size) const {
+  taco_ierror << "Diagonal modes cannot be assembled";
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::resizePtrStorage(ir::Expr size) const {
+  taco_ierror << "Diagonal modes cannot be assembled";
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::resizeIdxStorage(ir::Expr size) const {
+  taco_ierror << "Diagonal modes cannot be assembled";
+  return Stmt();
+}
+
+}}
@@ -0,0 +1,60 @@
+#ifndef TACO_STORAGE_DIAGONAL_ITERATOR_H
+#define TACO_STORAGE_DIAGONAL_ITERATOR_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterator over the stored diagonals of a DIA matrix row. The iterator walks
+/// the offset array and derives the column from the row and the diagonal
+/// offset. Values are stored diagonal-major, so loops over the rows of a
+/// diagonal load them with unit stride (see lower::lower).
+class DiagonalIterator : public IteratorImpl {
+public:
+  DiagonalIterator(std::string name, const ir::Expr& tensor, int level,
+                   Iterator previous);
+  virtual ~DiagonalIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+  bool isZeroPadded() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Expr inBounds() const;
+
+  ir::Stmt initDerivedVars() const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+  ir::Expr diagVar;
+
+  ir::Expr getSizeArr() const;
+  ir::Expr getOffsetArr() const;
+};
+
+}}
+#endif
@@ -2,23 +2,23 @@
 
 #include "taco/util/strings.h"
 
+using namespace std;
 using namespace taco::ir;
 
 namespace taco {
 namespace storage {
 
 FixedIterator::FixedIterator(std::string name, const Expr& tensor, int level,
-                             size_t fixedSize, Iterator previous)
+                             bool isLastLevel, Iterator previous)
     : IteratorImpl(previous, tensor) {
   this->tensor = tensor;
   this->level = level;
+  this->isLastLevel = isLastLevel;
 
   std::string idxVarName = name + util::toString(tensor);
-  ptrVar = Var::make(util::toString(tensor) + std::to_string(level) + "_ptr",
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
                      Int());
-  idxVar = Var::make(idxVarName,Int());
-
-  this->fixedSize = (long long)fixedSize;
+  idxVar = Var::make(idxVarName, Int());
 }
 
 bool FixedIterator::isDense() const {
@@ -37,6 +37,10 @@ bool FixedIterator::isSequentialAccess() const {
   return true;
 }
 
+bool FixedIterator::isZeroPadded() const {
+  return true;
+}
+
 Expr FixedIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -50,46 +54,78 @@ Expr FixedIterator::getIteratorVar() const {
 }
 
 Expr FixedIterator::begin() const {
-  return (long long) 0;
+  return Mul::make(getParent().getPtrVar(), getFixedSize());
 }
 
 Expr FixedIterator::end() const {
-  return fixedSize;
+  return Mul::make(Add::make(getParent().getPtrVar(), (long long) 1),
+                   getFixedSize());
+}
+
+Expr FixedIterator::inBounds() const {
+  // Segments are padded by repeating their last index value, so an entry past
+  // the first is padding iff it repeats the index value of the entry before
+  // it.  Empty segments are padded with index value 0 and zero values, so the
+  // first entry of a segment of the last level is padding iff the segment
+  // ends at 0 and the entry holds a zero.
+  Expr first = Eq::make(getPtrVar(), begin());
+  Expr distinct = Neq::make(getIdxVar(),
+                            Load::make(getIdxArr(),
+                                       Sub::make(getPtrVar(), (long long) 1)));
+  if (!isLastLevel) {
+    return Or::make(first, distinct);
+  }
+  Expr last = Load::make(getIdxArr(), Sub::make(end(), (long long) 1));
+  Expr value = Load::make(GetProperty::make(tensor, TensorProperty::Values),
+                          getPtrVar());
+  Expr nonempty = Or::make(Neq::make(last, (long long) 0),
+                           Neq::make(value, 0.0));
+  return Or::make(And::make(first, nonempty),
+                  And::make(Neq::make(getPtrVar(), begin()), distinct));
 }
 
 Stmt FixedIterator::initDerivedVars() const {
-  Expr ptrVal = Add::make(Mul::make(getParent().getPtrVar(), end()),
-                          getIdxVar());
-  return VarAssign::make(getIdxVar(), ptrVal);
+  return VarAssign::make(getIdxVar(), Load::make(getIdxArr(), getPtrVar()),
+                         true);
 }
 
 ir::Stmt FixedIterator::storePtr() const {
+  taco_not_supported_yet;
   return Stmt();
 }
 
 ir::Stmt FixedIterator::storeIdx(ir::Expr idx) const {
-  return Store::make(getIdxArr(), getPtrVar(), idx);
+  taco_not_supported_yet;
+  return Stmt();
 }
 
 ir::Expr FixedIterator::getPtrArr() const {
-  return GetProperty::make(tensor, TensorProperty::Dimension, level);
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_size";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 0, name);
 }
 
 ir::Expr FixedIterator::getIdxArr() const {
-  return GetProperty::make(tensor, TensorProperty::Dimension, level);
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_idx";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+ir::Expr FixedIterator::getFixedSize() const {
+  return Load::make(getPtrArr(), (long long) 0);
 }
 
 ir::Stmt FixedIterator::initStorage(ir::Expr size) const {
-  return Block::make({Allocate::make(getPtrArr(), (long long) 1),
-                      Allocate::make(getIdxArr(), size)});
+  taco_not_supported_yet;
+  return Stmt();
 }
 
 ir::Stmt FixedIterator::resizePtrStorage(ir::Expr size) const {
+  taco_not_supported_yet;
   return Stmt();
 }
 
 ir::Stmt FixedIterator::resizeIdxStorage(ir::Expr size) const {
-  return Allocate::make(getIdxArr(), size, true);
+  taco_not_supported_yet;
+  return Stmt();
 }
 
 }}
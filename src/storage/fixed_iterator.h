@@ -12,7 +12,7 @@ namespace storage {
 class FixedIterator : public IteratorImpl {
 public:
   FixedIterator(std::string name, const ir::Expr& tensor, int level,
-                size_t fixedSize, Iterator previous);
+                bool isLastLevel, Iterator previous);
   virtual ~FixedIterator() {};
 
   bool isDense() const;
@@ -20,6 +20,7 @@ public:
 
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
+  bool isZeroPadded() const;
 
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
@@ -28,6 +29,8 @@ public:
   ir::Expr begin() const;
   ir::Expr end() const;
 
+  ir::Expr inBounds() const;
+
   ir::Stmt initDerivedVars() const;
 
   ir::Stmt storePtr() const;
@@ -40,6 +43,7 @@ public:
 private:
   ir::Expr tensor;
   int level;
+  bool isLastLevel;
 
   ir::Expr ptrVar;
   ir::Expr idxVar;
@@ -47,7 +51,8 @@ private:
   ir::Expr getPtrArr() const;
   ir::Expr getIdxArr() const;
 
-  ir::Expr fixedSize;
+  /// The number of entries stored per segment (the ELL width)
+  ir::Expr getFixedSize() const;
 };
 
 }}
@@ -60,6 +60,9 @@ size_t Index::getSize() const {
       case ModeType::Fixed:
         size *= ((int *)modeIndex.getIndexArray(0).getData())[0];
         break;
+      case ModeType::Diagonal:
+        size *= ((int *)modeIndex.getIndexArray(0).getData())[0];
+        break;
     }
   }
   return size;
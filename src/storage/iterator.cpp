@@ -4,6 +4,7 @@
 #include "dense_iterator.h"
 #include "sparse_iterator.h"
 #include "fixed_iterator.h"
+#include "diagonal_iterator.h"
 
 #include "taco/tensor.h"
 #include "taco/expr/expr.h"
@@ -50,12 +51,17 @@ Iterator Iterator::make(const lower::TensorPath& path,
       break;
     }
     case ModeType::Fixed: {
-//      auto modeIndex = tensor.getStorage().getIndex().getModeIndex(mode);
-//      int fixedSize = getValue<int>(modeIndex.getIndexArray(0), 0);
-//      iterator.iterator =
-//          std::make_shared<FixedIterator>(name, tensorVar, mode, fixedSize,
-//                                          parent);
-      taco_not_supported_yet;
+      iterator.iterator =
+          std::make_shared<FixedIterator>(name, tensorVar, mode,
+                                          mode + 1 == type.getShape().getOrder(),
+                                          parent);
+      break;
+    }
+    case ModeType::Diagonal: {
+      taco_iassert(mode == 1 && parent.defined() && parent.isDense()) <<
+          "Diagonal modes must follow a dense row mode";
+      iterator.iterator =
+          std::make_shared<DiagonalIterator>(name, tensorVar, mode, parent);
       break;
     }
   }
@@ -103,6 +109,11 @@ bool Iterator::isSequentialAccess() const {
   return iterator->isSequentialAccess();
 }
 
+bool Iterator::isZeroPadded() const {
+  taco_iassert(defined());
+  return iterator->isZeroPadded();
+}
+
 ir::Expr Iterator::getTensor() const {
   taco_iassert(defined());
   return iterator->getTensor();
@@ -133,6 +144,11 @@ ir::Expr Iterator::end() const {
   return iterator->end();
 }
 
+ir::Expr Iterator::inBounds() const {
+  taco_iassert(defined());
+  return iterator->inBounds();
+}
+
 ir::Stmt Iterator::initDerivedVar() const {
   taco_iassert(defined());
   return iterator->initDerivedVars();
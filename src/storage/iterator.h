@@ -55,6 +55,11 @@ public:
   /// Returns true if the iterator supports sequential access
   bool isSequentialAccess() const;
 
+  /// Returns true if the entries that `inBounds` rejects hold valid
+  /// coordinates and zero values, so that computations which zero annihilates
+  /// need not skip them.
+  bool isZeroPadded() const;
+
   /// Returns the tensor this iterator is iterating over.
   ir::Expr getTensor() const;
 
@@ -80,6 +85,11 @@ public:
   /// in the loop and that determines the end of the iterator.
   ir::Expr end() const;
 
+  /// Returns an expression that is true iff the index variable of the current
+  /// iteration lies inside the tensor mode, or an undefined expression if the
+  /// iterator never produces out-of-bounds coordinates.
+  ir::Expr inBounds() const;
+
   /// Returns a statement that initializes loop variables that are derived from
   /// the iterator variable.
   ir::Stmt initDerivedVar() const;
@@ -125,6 +135,7 @@ public:
 
   virtual bool isRandomAccess() const                    = 0;
   virtual bool isSequentialAccess() const                = 0;
+  virtual bool isZeroPadded() const                      = 0;
 
   virtual ir::Expr getPtrVar() const                     = 0;
   virtual ir::Expr getIdxVar() const                     = 0;
@@ -132,6 +143,7 @@ public:
   virtual ir::Expr getIteratorVar() const                = 0;
   virtual ir::Expr begin() const                         = 0;
   virtual ir::Expr end() const                           = 0;
+  virtual ir::Expr inBounds() const                      = 0;
 
   virtual ir::Stmt initDerivedVars() const               = 0;
 
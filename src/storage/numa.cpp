@@ -0,0 +1,111 @@
+#include "taco/storage/numa.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+
+#if defined(TACO_LINUX)
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+#include "taco/storage/allocator.h"
+#include "taco/error.h"
+
+using namespace std;
+
+namespace taco {
+namespace storage {
+
+static NumaPolicy numaPolicy = NumaPolicy::Local;
+static int numaNode = 0;
+
+void setNumaPolicy(NumaPolicy policy, int node) {
+  taco_uassert(node >= 0 && node < 64) << "Invalid NUMA node " << node;
+  numaPolicy = policy;
+  numaNode = node;
+}
+
+NumaPolicy getNumaPolicy() {
+  return numaPolicy;
+}
+
+int getNumaNode() {
+  return numaNode;
+}
+
+static size_t getPageSize() {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+}
+
+/// Allocate whole pages for `size` bytes with the tensor allocator, which no
+/// other allocation shares, so that only this array decides their placement.
+/// Returns null if the allocator can't align to pages. The pages may have been
+/// touched before (e.g. when a pool recycles them), so `bindPages` moves them
+/// and `FirstTouch` leaves them where they are.
+static char* allocatePages(size_t size) {
+  size_t pageSize = getPageSize();
+  return (char*)getAllocator()->allocateAligned(
+      (size + pageSize - 1) & ~(pageSize - 1), pageSize);
+}
+
+/// Set the memory policy of the pages of an array from `allocatePages` and
+/// move the pages that were already touched. The policy is advisory, so
+/// failures are ignored.
+static void bindPages(void* ptr, size_t size, NumaPolicy policy, int node) {
+#if defined(TACO_LINUX) && defined(SYS_mbind)
+  size_t pageSize = getPageSize();
+  size = (size + pageSize - 1) & ~(pageSize - 1);
+
+  // The kernel restricts the mask to the nodes that have memory
+  unsigned long nodemask = (policy == NumaPolicy::Bind) ? 1ul << node : ~0ul;
+  int mode = (policy == NumaPolicy::Bind) ? MPOL_BIND : MPOL_INTERLEAVE;
+  syscall(SYS_mbind, ptr, size, mode, &nodemask, sizeof(nodemask) * 8,
+          MPOL_MF_MOVE);
+#endif
+}
+
+void* allocatePlaced(const void* src, size_t elementSize, size_t size,
+                     const vector<size_t>& bounds) {
+  size_t numBytes = size * elementSize;
+  char* dst = nullptr;
+  if (numBytes >= NUMA_PLACEMENT_THRESHOLD &&
+      numaPolicy != NumaPolicy::Local &&
+      (numaPolicy != NumaPolicy::FirstTouch || bounds.size() >= 2)) {
+    dst = allocatePages(numBytes);
+  }
+  if (dst == nullptr) {
+    dst = (char*)allocate(numBytes);
+    if (numBytes > 0) {
+      memcpy(dst, src, numBytes);
+    }
+    return dst;
+  }
+
+  if (numaPolicy != NumaPolicy::FirstTouch) {
+    bindPages(dst, numBytes, numaPolicy, numaNode);
+    memcpy(dst, src, numBytes);
+    return dst;
+  }
+
+  taco_iassert(bounds.back() <= size);
+  const char* from = (const char*)src;
+
+  // Elements outside the units of work are copied by the calling thread
+  memcpy(dst, from, bounds.front() * elementSize);
+  memcpy(dst + bounds.back() * elementSize, from + bounds.back()*elementSize,
+         (size - bounds.back()) * elementSize);
+
+  // Same partition of the units as statically scheduled parallel loops
+  const long numUnits = bounds.size() - 1;
+  #pragma omp parallel for schedule(static)
+  for (long i = 0; i < numUnits; i++) {
+    memcpy(dst + bounds[i] * elementSize, from + bounds[i] * elementSize,
+           (bounds[i+1] - bounds[i]) * elementSize);
+  }
+  return dst;
+}
+
+}}
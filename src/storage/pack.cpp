@@ -1,5 +1,6 @@
 #include "taco/storage/pack.h"
 
+#include <algorithm>
 #include <climits>
 
 #include "taco/format.h"
@@ -44,7 +45,7 @@ size_t findMaxFixedValue(const vector<int>& dimensions,
                               size_t order,
                               const size_t fixedLevel,
                               const size_t i, const size_t numCoords) {
-  if (i == order) {
+  if (i == order || numCoords == 0) {
     return numCoords;
   }
   if (i == fixedLevel) {
@@ -106,6 +107,138 @@ size_t findMaxFixedValue(const vector<int>& dimensions,
   }
 }
 
+vector<int> getDiagonalOffsets(const vector<vector<int>>& coords,
+                               size_t diagonalLevel, size_t numCoords) {
+  taco_iassert(diagonalLevel > 0);
+  vector<int> offsets;
+  offsets.reserve(numCoords);
+  for (size_t j = 0; j < numCoords; j++) {
+    offsets.push_back(coords[diagonalLevel][j] - coords[diagonalLevel-1][j]);
+  }
+  std::sort(offsets.begin(), offsets.end());
+  offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+  return offsets;
+}
+
+vector<vector<size_t>> getLevelBounds(const vector<int>& dimensions,
+                                      const vector<ModeType>& modeTypes,
+                                      const vector<vector<vector<int>>>& indices) {
+  vector<vector<size_t>> bounds(modeTypes.size());
+  for (size_t i = 0; i < modeTypes.size(); i++) {
+    if (i == 0) {
+      // The units of work are the positions of the first level
+      size_t numUnits = 0;
+      switch (modeTypes[0]) {
+        case Dense:
+          numUnits = dimensions[0];
+          break;
+        case Sparse:
+          numUnits = indices[0][0][1];
+          break;
+        case Fixed:
+          numUnits = indices[0][0][0];
+          break;
+        case Diagonal:
+          taco_ierror << "Diagonal modes cannot be the first mode";
+          break;
+      }
+      bounds[0].resize(numUnits + 1);
+      for (size_t p = 0; p <= numUnits; p++) {
+        bounds[0][p] = p;
+      }
+      continue;
+    }
+
+    bounds[i].reserve(bounds[i-1].size());
+    for (size_t parentPos : bounds[i-1]) {
+      switch (modeTypes[i]) {
+        case Dense:
+          bounds[i].push_back(parentPos * dimensions[i]);
+          break;
+        case Sparse:
+          bounds[i].push_back(indices[i][0][parentPos]);
+          break;
+        case Fixed:
+          bounds[i].push_back(parentPos * indices[i][0][0]);
+          break;
+        case Diagonal:
+          // Diagonal-major values don't follow the rows, so they are split
+          // evenly instead
+          bounds[i].push_back(parentPos * indices[i][0][0]);
+          break;
+      }
+    }
+  }
+  return bounds;
+}
+
+Index makeIndex(const vector<int>& dimensions, const Format& format,
+                const vector<vector<vector<int>>>& indices,
+                const vector<vector<size_t>>& bounds) {
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < dimensions.size(); i++) {
+    ModeType modeType = format.getModeTypes()[i];
+    switch (modeType) {
+      case ModeType::Dense: {
+        Array size = makeArray({dimensions[i]});
+        modeIndices.push_back(ModeIndex({size}));
+        break;
+      }
+      case ModeType::Sparse: {
+        Array pos = (i > 0) ? makeArray(indices[i][0], bounds[i-1])
+                            : makeArray(indices[i][0]);
+        Array idx = makeArray(indices[i][1], bounds[i]);
+        modeIndices.push_back(ModeIndex({pos, idx}));
+        break;
+      }
+      case ModeType::Fixed: {
+        Array pos = makeArray(indices[i][0]);
+        Array idx = makeArray(indices[i][1], bounds[i]);
+        modeIndices.push_back(ModeIndex({pos, idx}));
+        break;
+      }
+      case ModeType::Diagonal: {
+        Array pos = makeArray(indices[i][0]);
+        Array idx = makeArray(indices[i][1]);
+        modeIndices.push_back(ModeIndex({pos, idx}));
+        break;
+      }
+    }
+  }
+  return Index(format, modeIndices);
+}
+
+Storage packPattern(const vector<int>& dimensions, const Format& format,
+                    const vector<vector<int>>& coordinates) {
+  size_t order = dimensions.size();
+  taco_iassert(order == format.getOrder() && order > 0);
+
+  vector<vector<vector<int>>> indices;
+  for (size_t i = 0; i < order; ++i) {
+    switch (format.getModeTypes()[i]) {
+      case Dense:
+        indices.push_back({});
+        break;
+      case Sparse:
+        indices.push_back({{0}, {}});
+        break;
+      case Fixed:
+      case Diagonal:
+        taco_ierror << "Pattern tensors have dense and sparse modes only";
+        break;
+    }
+  }
+  packTensor<bool>(dimensions, coordinates, nullptr, 0, coordinates[0].size(),
+                   format.getModeTypes(), 0, &indices, nullptr);
+
+  Storage storage(format);
+  storage.setIndex(makeIndex(dimensions, format, indices,
+                             getLevelBounds(dimensions, format.getModeTypes(),
+                                            indices)));
+  storage.setValues(Array(Bool(), nullptr, 0));
+  return storage;
+}
+
 ir::Stmt packCode(const Format& format) {
   using namespace taco::ir;
 
@@ -136,7 +269,8 @@ ir::Stmt packCode(const Format& format) {
       case Sparse: {
         break;
       }
-      case Fixed: {
+      case Fixed:
+      case Diagonal: {
         taco_not_supported_yet;
         break;
       }
@@ -25,6 +25,10 @@ bool RootIterator::isSequentialAccess() const {
   return true;
 }
 
+bool RootIterator::isZeroPadded() const {
+  return false;
+}
+
 Expr RootIterator::getPtrVar() const {
   return (long long) 0;
 }
@@ -49,6 +53,10 @@ Expr RootIterator::end() const {
   return (long long) 1;
 }
 
+Expr RootIterator::inBounds() const {
+  return Expr();
+}
+
 ir::Stmt RootIterator::initDerivedVars() const {
   return Stmt();
 }
@@ -17,6 +17,7 @@ public:
 
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
+  bool isZeroPadded() const;
 
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
@@ -25,6 +26,8 @@ public:
   ir::Expr begin() const;
   ir::Expr end() const;
 
+  ir::Expr inBounds() const;
+
   ir::Stmt initDerivedVars() const;
 
   ir::Stmt storePtr() const;
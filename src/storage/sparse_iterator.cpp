@@ -36,6 +36,10 @@ bool SparseIterator::isSequentialAccess() const {
   return true;
 }
 
+bool SparseIterator::isZeroPadded() const {
+  return false;
+}
+
 Expr SparseIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -56,6 +60,10 @@ Expr SparseIterator::end() const {
   return Load::make(getPtrArr(), Add::make(getParent().getPtrVar(), (long long) 1));
 }
 
+Expr SparseIterator::inBounds() const {
+  return Expr();
+}
+
 Stmt SparseIterator::initDerivedVars() const {
   return VarAssign::make(getIdxVar(), Load::make(getIdxArr(), getPtrVar()),
                          true);
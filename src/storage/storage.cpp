@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <string>
+#include <atomic>
 
 #include "taco/type.h"
 #include "taco/format.h"
@@ -16,11 +17,17 @@ using namespace std;
 namespace taco {
 namespace storage {
 
+static uint64_t nextFingerprint() {
+  static atomic<uint64_t> fingerprint(0);
+  return ++fingerprint;
+}
+
 // class Storage
 struct Storage::Content {
-  Format format;
-  Index  index;
-  Array  values;
+  Format   format;
+  Index    index;
+  Array    values;
+  uint64_t fingerprint;
 };
 
 Storage::Storage() : content(nullptr) {
@@ -28,6 +35,7 @@ Storage::Storage() : content(nullptr) {
 
 Storage::Storage(const Format& format) : content(new Content) {
   content->format = format;
+  content->fingerprint = nextFingerprint();
 }
 
 void Storage::setValues(const Array& values) {
@@ -40,6 +48,7 @@ const Format& Storage::getFormat() const {
 
 void Storage::setIndex(const Index& index) {
   content->index = index;
+  content->fingerprint = nextFingerprint();
 }
 
 const Index& Storage::getIndex() const {
@@ -73,6 +82,10 @@ size_t Storage::getSizeInBytes() {
   return indexSizeInBytes + values.getSize() * values.getType().getNumBytes();
 }
 
+uint64_t Storage::getFingerprint() const {
+  return (content != nullptr) ? content->fingerprint : 0;
+}
+
 std::ostream& operator<<(std::ostream& os, const Storage& storage) {
   return os << storage.getIndex() << endl << storage.getValues();
 }
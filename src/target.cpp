@@ -2,7 +2,13 @@
 #include <map>
 #include <vector>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define TACO_HAS_CPUID 1
+#endif
+
 #include "taco/target.h"
+#include "taco/util/env.h"
 
 using namespace std;
 
@@ -17,6 +23,12 @@ map<string, Target::OS> osMap = {{"unknown", Target::OSUnknown},
                                   {"macos", Target::MacOS},
                                   {"windows", Target::Windows}};
   
+map<string, Target::ISA> isaMap = {{"generic", Target::ISAGeneric},
+                                    {"sse42", Target::SSE42},
+                                    {"avx", Target::AVX},
+                                    {"avx2", Target::AVX2},
+                                    {"avx512", Target::AVX512}};
+
 bool parseTargetString(Target& target, string target_string) {
   string rest = target_string;
   vector<string> tokens;
@@ -25,7 +37,9 @@ bool parseTargetString(Target& target, string target_string) {
   while (current_pos != string::npos) {
     tokens.push_back(rest.substr(0, current_pos));
     rest = rest.substr(current_pos+1);
+    current_pos = rest.find('-');
   }
+  tokens.push_back(rest);
   
   // now parse the tokens
   taco_uassert(tokens.size() >= 2) <<
@@ -43,16 +57,105 @@ bool parseTargetString(Target& target, string target_string) {
   }
   target.os = osMap[tokens[1]];
   
+  // the rest are features
+  for (size_t i = 2; i < tokens.size(); i++) {
+    if (isaMap.count(tokens[i]) > 0) {
+      target.isa = isaMap[tokens[i]];
+    } else if (tokens[i] == "multiversion") {
+      target.multiversion = true;
+    } else {
+      return false;
+    }
+  }
+
   return true;
 }
 
+// The generated code relies on POSIX calls, so hosts other than macOS are
+// treated as Linux
+Target::OS getHostOS() {
+#if defined(__APPLE__)
+  return Target::MacOS;
+#else
+  return Target::Linux;
+#endif
+}
+
+Target::ISA detectHostISA() {
+#ifdef TACO_HAS_CPUID
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return Target::ISAGeneric;
+  }
+  bool sse42 = ecx & bit_SSE4_2;
+  bool fma   = ecx & bit_FMA;
+  bool avx   = (ecx & bit_AVX) && (ecx & bit_OSXSAVE);
+
+  // The OS must save the vector registers on context switches: the SSE and
+  // AVX state for AVX, and the opmask and ZMM state as well for AVX-512
+  unsigned int xcr0 = 0;
+  if (avx) {
+    unsigned int xcr0_high;
+    __asm__ volatile("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+    avx = (xcr0 & 0x6) == 0x6;
+  }
+
+  bool avx2 = false, avx512 = false;
+  if (avx && __get_cpuid_max(0, nullptr) >= 7) {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    avx2   = (ebx & bit_AVX2) && fma;
+    avx512 = avx2 && (ebx & bit_AVX512F) && (ebx & bit_AVX512DQ) &&
+             (ebx & bit_AVX512BW) && (ebx & bit_AVX512VL) &&
+             (xcr0 & 0xe0) == 0xe0;
+  }
+
+  if (avx512) return Target::AVX512;
+  if (avx2)   return Target::AVX2;
+  if (avx)    return Target::AVX;
+  if (sse42)  return Target::SSE42;
+#endif
+  return Target::ISAGeneric;
+}
+
 } // anonymous namespace
 
-Target::Target(const std::string &s) {
-  parseTargetString(*this, s);
+Target::Target(const std::string &s)
+    : arch(C99), os(OSUnknown), isa(ISAGeneric), multiversion(false) {
+  taco_uassert(parseTargetString(*this, s)) << "Invalid target string: " << s;
+}
+
+string Target::getCPU() const {
+  if (multiversion) {
+    return "";
+  }
+  switch (isa) {
+    case SSE42:  return "nehalem";
+    case AVX:    return "sandybridge";
+    case AVX2:   return "haswell";
+    case AVX512: return "skylake-avx512";
+    case ISAGeneric:
+      break;
+  }
+  return "";
 }
 
+int Target::getVectorWidth() const {
+  // GCC and Clang use 256-bit vectors on AVX-512 machines by default, to
+  // avoid the frequency drop of 512-bit instructions
+  return (isa == AVX512 && !multiversion) ? 512 : 0;
+}
 
+string Target::getCompilerFlags() const {
+  string cpu = getCPU();
+  if (cpu.empty()) {
+    return "";
+  }
+  string flags = "-march=" + cpu + " -mtune=" + cpu;
+  if (getVectorWidth() > 0) {
+    flags += " -mprefer-vector-width=" + to_string(getVectorWidth());
+  }
+  return flags;
+}
 
 bool Target::validateTargetString(const string &s) {
   string::size_type arch_end = string::npos;
@@ -75,7 +178,36 @@ bool Target::validateTargetString(const string &s) {
   return (arch_end != string::npos) && (os_end != string::npos);
 }
 
+std::ostream& operator<<(std::ostream& os, const Target& target) {
+  for (auto& arch : archMap) {
+    if (arch.second == target.arch) os << arch.first;
+  }
+  for (auto& targetOS : osMap) {
+    if (targetOS.second == target.os) os << "-" << targetOS.first;
+  }
+  for (auto& isa : isaMap) {
+    if (isa.second == target.isa) os << "-" << isa.first;
+  }
+  if (target.multiversion) {
+    os << "-multiversion";
+  }
+  return os;
+}
+
+Target::ISA getHostISA() {
+  static const Target::ISA hostISA = detectHostISA();
+  return hostISA;
+}
+
 Target getTargetFromEnvironment() {
-  return Target(Target::Arch::C99, Target::OS::MacOS);
+  string target = util::getFromEnv("TACO_TARGET", "");
+  if (!target.empty()) {
+    return Target(target);
+  }
+  return Target(Target::Arch::C99, getHostOS(), getHostISA());
+}
+
+Target getPortableTarget() {
+  return Target(Target::Arch::C99, getHostOS(), Target::ISAGeneric, true);
 }
 } // namespace taco
@@ -2,23 +2,31 @@
 
 #include <set>
 #include <cstring>
+#include <future>
 #include <fstream>
+#include <atomic>
+#include <mutex>
 #include <sstream>
 #include <limits.h>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
+#include "taco/precompiled.h"
 #include "taco/expr/expr.h"
 #include "taco/expr/expr_nodes.h"
 #include "taco/expr/expr_visitor.h"
+#include "taco/expr/expr_rewriter.h"
+#include "taco/expr/schedule.h"
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/storage/array_util.h"
+#include "taco/storage/allocator.h"
 #include "taco/storage/pack.h"
 #include "taco/ir/ir.h"
 #include "taco/lower/lower.h"
 #include "lower/iteration_graph.h"
+#include "expr/access_tensor_node.h"
 #include "codegen/module.h"
 #include "taco/taco_tensor_t.h"
 #include "taco/storage/file_io_tns.h"
@@ -49,11 +57,62 @@ struct TensorBase::Content {
 
   size_t                allocSize;
   size_t                valuesSize;
+  bool                  parallelAssembly = false;
+  bool                  nonzeroBalancing = false;
+  bool                  simdIntrinsics = false;
+  bool                  tieredExecution = false;
+  int                   tierThreshold = 0;
+  bool                  tieredCompilation = false;
+  Target                target = getTargetFromEnvironment();
+
+  ParallelOptions       parallelOptions;
 
   Stmt                  assembleFunc;
   Stmt                  computeFunc;
   bool                  assembleWhileCompute;
   shared_ptr<Module>    module;
+
+  // The precompiled kernels that the tensor is bound to, if any
+  shared_ptr<PrecompiledKernels> precompiled;
+
+  // Autotuning: the candidate variants of the kernels, with their modules,
+  // whose first computes are timed before settling on the fastest, which is
+  // cached under `tuningKey` unless it's empty.  Kernels that aren't
+  // autotuned tune the chunk size of their parallel options the same way
+  // (see isChunkSizeTuned), with candidates that only differ in chunk size.
+  bool                  autotuning = false;
+  vector<KernelVariant> candidates;
+  vector<shared_ptr<Module>> candidateModules;
+  vector<double>        candidateTimes;
+  int                   candidateRuns = 0;
+  double                candidateTime = 0;
+  bool                  tuningChunkSize = false;
+  string                tuningKey;
+  bool                  tuned = false;
+  KernelVariant         tunedVariant;
+
+  // Storage fingerprints of the result and operands at the last assembly
+  vector<uint64_t>      assembledFingerprints;
+
+  // The merged storage produced by a background merge, and the lock that
+  // serializes installing it, since const readers may install it concurrently
+  std::future<Storage>  pendingMerge;
+  std::mutex            mergeMutex;
+  std::atomic<bool>     mergePending{false};
+
+  // Compiled kernels that compute the change of the result, per changed
+  // operand and delta tensor
+  map<pair<TensorBase,TensorBase>,TensorBase> deltaKernels;
+
+  /// Drop the candidate variants and the tuned variant.
+  void resetTuning() {
+    candidates.clear();
+    candidateModules.clear();
+    candidateTimes.clear();
+    candidateRuns = 0;
+    tuningChunkSize = false;
+    tuned = false;
+  }
 };
 
 TensorBase::TensorBase() : TensorBase(Float()) {
@@ -163,10 +222,12 @@ const TensorVar& TensorBase::getTensorVar() const {
 }
 
 const storage::Storage& TensorBase::getStorage() const {
+  waitForMerge();
   return content->storage;
 }
 
 storage::Storage& TensorBase::getStorage() {
+  waitForMerge();
   return content->storage;
 }
 
@@ -180,7 +241,89 @@ size_t TensorBase::getAllocSize() const {
   return content->allocSize;
 }
 
-static size_t numIntegersToCompare = 0;
+void TensorBase::setParallelAssembly(bool parallelAssembly) {
+  content->parallelAssembly = parallelAssembly;
+}
+
+void TensorBase::setNonzeroBalancing(bool nonzeroBalancing) {
+  content->nonzeroBalancing = nonzeroBalancing;
+}
+
+void TensorBase::setSimdIntrinsics(bool simdIntrinsics) {
+  content->simdIntrinsics = simdIntrinsics;
+}
+
+void TensorBase::setTarget(const Target& target) {
+  content->target = target;
+}
+
+Target TensorBase::getTarget() const {
+  return content->target;
+}
+
+void TensorBase::setTieredExecution(bool tiered, int threshold) {
+  content->tieredExecution = tiered;
+  content->tierThreshold = threshold;
+}
+
+void TensorBase::setTieredCompilation(bool tiered) {
+  content->tieredCompilation = tiered;
+}
+
+bool TensorBase::isInterpreted() const {
+  taco_uassert(content->module != nullptr) << error::compute_without_compile;
+  return content->module->isInterpreted();
+}
+
+bool TensorBase::isOptimized() const {
+  taco_uassert(content->module != nullptr) << error::compute_without_compile;
+  return content->module->isOptimized();
+}
+
+void TensorBase::waitForLibrary() {
+  taco_uassert(content->module != nullptr) << error::compute_without_compile;
+  content->module->waitForLibrary();
+}
+
+void TensorBase::setAutotuning(bool autotuning) {
+  content->autotuning = autotuning;
+}
+
+bool TensorBase::getTunedVariant(KernelVariant* variant) const {
+  if (!content->tuned || content->tuningChunkSize) {
+    return false;
+  }
+  *variant = content->tunedVariant;
+  return true;
+}
+
+void TensorBase::setParallelOptions(const ParallelOptions& options) {
+  // the chunk size is tuned again for other options
+  const ParallelOptions& current = content->parallelOptions;
+  if (content->tuningChunkSize &&
+      (options.parallelize != current.parallelize ||
+       options.numThreads != current.numThreads ||
+       options.schedule != current.schedule ||
+       options.chunkSize != current.chunkSize)) {
+    content->resetTuning();
+  }
+  content->parallelOptions = options;
+}
+
+ParallelOptions TensorBase::getParallelOptions() const {
+  return content->parallelOptions;
+}
+
+int TensorBase::getTunedChunkSize() const {
+  return content->tuned ? content->tunedVariant.chunkSize : 0;
+}
+
+void TensorBase::setAccumulationType(DataType type) {
+  content->tensorVar.setAccumulationType(type);
+}
+
+// Thread local, since coordinates may be merged in a background thread
+static thread_local size_t numIntegersToCompare = 0;
 static int lexicographicalCmp(const void* a, const void* b) {
   for (size_t i = 0; i < numIntegersToCompare; i++) {
     int diff = ((int*)a)[i] - ((int*)b)[i];
@@ -191,50 +334,30 @@ static int lexicographicalCmp(const void* a, const void* b) {
   return 0;
 }
   
+/// Sort the coordinates in a coordinate buffer in the storage order of the
+/// modes and move them into one vector per mode and a vector of values,
+/// summing duplicates.
 template <typename T>
-void TensorBase::packTyped() {
-  const size_t order = getOrder();
-  
-  
-  // Pack scalars
-  if (order == 0) {
-    char* coordLoc = this->coordinateBuffer->data();
-    T scalarValue = *(T*)&coordLoc[this->coordinateSize -
-                                             getComponentType().getNumBytes()];
-    content->storage.setValues(makeArray({scalarValue}));
-    this->coordinateBuffer->clear();
-    return;
-  }
-  
-  
+static void sortCoordinates(char* coordinatesPtr, size_t numCoordinates,
+                            size_t coordSize,
+                            const std::vector<size_t>& permutation,
+                            std::vector<std::vector<int>>* coordinatesOut,
+                            std::vector<T>* valuesOut) {
+  const size_t order = permutation.size();
+
   /// Permute the coordinates according to the storage mode ordering.
   /// This is a workaround since the current pack code only packs tensors in the
   /// ordering of the modes.
-  const std::vector<int>& dimensions = getDimensions();
-  taco_iassert(getFormat().getOrder() == order);
-  std::vector<size_t> permutation = getFormat().getModeOrdering();
-  std::vector<int> permutedDimensions(order);
-  for (size_t i = 0; i < order; ++i) {
-    permutedDimensions[i] = dimensions[permutation[i]];
-  }
-  
-  taco_iassert((this->coordinateBufferUsed % this->coordinateSize) == 0);
-  size_t numCoordinates = this->coordinateBufferUsed / this->coordinateSize;
-  const size_t coordSize = this->coordinateSize;
-  
-  char* coordinatesPtr = coordinateBuffer->data();
   vector<int> permuteBuffer(order);
   for (size_t i=0; i < numCoordinates; ++i) {
-    int* coordinate = (int*)coordinatesPtr;
+    int* coordinate = (int*)&coordinatesPtr[i*coordSize];
     for (size_t j = 0; j < order; j++) {
       permuteBuffer[j] = coordinate[permutation[j]];
     }
     for (size_t j = 0; j < order; j++) {
       coordinate[j] = permuteBuffer[j];
     }
-    coordinatesPtr += this->coordinateSize;
   }
-  coordinatesPtr = coordinateBuffer->data();  
   
   // The pack code expects the coordinates to be sorted
   numIntegersToCompare = order;
@@ -242,11 +365,13 @@ void TensorBase::packTyped() {
   
   
   // Move coords into separate arrays and remove duplicates
-  std::vector<std::vector<int>> coordinates(order);
+  std::vector<std::vector<int>>& coordinates = *coordinatesOut;
+  std::vector<T>& values = *valuesOut;
+  coordinates.resize(order);
   for (size_t i=0; i < order; ++i) {
     coordinates[i] = std::vector<int>(numCoordinates);
   }
-  std::vector<T> values(numCoordinates);
+  values.resize(numCoordinates);
   // Copy first coordinate-value pair
   int* lastCoord = (int*)malloc(order * sizeof(int));
   if (numCoordinates >= 1) {
@@ -273,6 +398,7 @@ void TensorBase::packTyped() {
         coordinates[d][j] = coord[d];
       }
       values[j] = value;
+      memcpy(lastCoord, coord, order*sizeof(int));
       j++;
     }
     else {
@@ -287,6 +413,38 @@ void TensorBase::packTyped() {
     }
     values.resize(j);
   }
+}
+
+template <typename T>
+void TensorBase::packTyped() {
+  const size_t order = getOrder();
+  
+  
+  // Pack scalars
+  if (order == 0) {
+    char* coordLoc = this->coordinateBuffer->data();
+    T scalarValue = *(T*)&coordLoc[this->coordinateSize -
+                                             getComponentType().getNumBytes()];
+    content->storage.setValues(makeArray({scalarValue}));
+    this->coordinateBuffer->clear();
+    return;
+  }
+  
+  const std::vector<int>& dimensions = getDimensions();
+  taco_iassert(getFormat().getOrder() == order);
+  std::vector<size_t> permutation = getFormat().getModeOrdering();
+  std::vector<int> permutedDimensions(order);
+  for (size_t i = 0; i < order; ++i) {
+    permutedDimensions[i] = dimensions[permutation[i]];
+  }
+  
+  taco_iassert((this->coordinateBufferUsed % this->coordinateSize) == 0);
+  size_t numCoordinates = this->coordinateBufferUsed / this->coordinateSize;
+  
+  std::vector<std::vector<int>> coordinates;
+  std::vector<T> values;
+  sortCoordinates(coordinateBuffer->data(), numCoordinates,
+                  this->coordinateSize, permutation, &coordinates, &values);
   taco_iassert(coordinates.size() > 0);
   this->coordinateBuffer->clear();
   this->coordinateBufferUsed = 0;
@@ -296,10 +454,58 @@ void TensorBase::packTyped() {
                                    coordinates, values);
 }
 
+/// True iff every component that a tensor in the format stores is one of its
+/// coordinates, so that a pattern tensor in it needs no values. Dense modes
+/// below the last sparse mode, fixed modes and diagonal modes store padding.
+static bool isPatternFormat(const Format& format) {
+  const vector<ModeType>& modeTypes = format.getModeTypes();
+  for (ModeType modeType : modeTypes) {
+    if (modeType != Dense && modeType != Sparse) {
+      return false;
+    }
+  }
+  return !modeTypes.empty() && modeTypes.back() == Sparse;
+}
+
+/// Check that the pattern tensors in an expression have pattern formats.
+static void checkPatternOperands(const IndexExpr& expr) {
+  for (const TensorVar& operand : getOperands(expr)) {
+    taco_uassert(!operand.getType().getDataType().isBool() ||
+                 isPatternFormat(operand.getFormat())) << error::pattern_format;
+  }
+}
+
+/// Pack the coordinates of a pattern tensor. Pattern tensors store no values
+/// array, since every stored component is implicitly one.
+void TensorBase::packPattern() {
+  taco_uassert(isPatternFormat(getFormat())) << error::pattern_format;
+
+  const size_t order = getOrder();
+  std::vector<size_t> permutation = getFormat().getModeOrdering();
+  std::vector<int> permutedDimensions(order);
+  for (size_t i = 0; i < order; ++i) {
+    permutedDimensions[i] = getDimensions()[permutation[i]];
+  }
+
+  taco_iassert((this->coordinateBufferUsed % this->coordinateSize) == 0);
+  size_t numCoordinates = this->coordinateBufferUsed / this->coordinateSize;
+
+  std::vector<std::vector<int>> coordinates;
+  std::vector<bool> values;
+  sortCoordinates(coordinateBuffer->data(), numCoordinates,
+                  this->coordinateSize, permutation, &coordinates, &values);
+  this->coordinateBuffer->clear();
+  this->coordinateBufferUsed = 0;
+
+  content->storage = storage::packPattern(permutedDimensions, getFormat(),
+                                          coordinates);
+}
+
 /// Pack coordinates into a data structure given by the tensor format.
 void TensorBase::pack() {
+  waitForMerge();
   switch(getComponentType().getKind()) {
-    case DataType::Bool: taco_ierror; break;
+    case DataType::Bool: packPattern(); break;
     case DataType::UInt8: packTyped<uint8_t>(); break;
     case DataType::UInt16: packTyped<uint16_t>(); break;
     case DataType::UInt32: packTyped<uint32_t>(); break;
@@ -310,6 +516,8 @@ void TensorBase::pack() {
     case DataType::Int32: packTyped<int32_t>(); break;
     case DataType::Int64: packTyped<int64_t>(); break;
     case DataType::Int128: packTyped<long long>(); break;
+    case DataType::Float16: packTyped<float16>(); break;
+    case DataType::BFloat16: packTyped<bfloat16>(); break;
     case DataType::Float32: packTyped<float>(); break;
     case DataType::Float64: packTyped<double>(); break;
     case DataType::Complex64: packTyped<std::complex<float>>(); break;
@@ -318,18 +526,97 @@ void TensorBase::pack() {
   }
 }
 
+/// Sort the coordinates in a coordinate buffer and merge them into storage in
+/// a background thread.
+template <typename T>
+struct MergeTyped {
+  static Storage merge(Storage storage, vector<int> permutedDimensions,
+                       vector<size_t> permutation,
+                       shared_ptr<vector<char>> coordinateBuffer,
+                       size_t numCoordinates, size_t coordSize) {
+    std::vector<std::vector<int>> coordinates;
+    std::vector<T> values;
+    sortCoordinates(coordinateBuffer->data(), numCoordinates, coordSize,
+                    permutation, &coordinates, &values);
+    return storage::merge(storage, permutedDimensions, coordinates, values);
+  }
+
+  static void apply(std::future<Storage>* pendingMerge, const Storage& storage,
+                    const vector<int>& permutedDimensions,
+                    const vector<size_t>& permutation,
+                    shared_ptr<vector<char>> coordinateBuffer,
+                    size_t numCoordinates, size_t coordSize) {
+    *pendingMerge = std::async(std::launch::async, merge, storage,
+                               permutedDimensions, permutation,
+                               coordinateBuffer, numCoordinates, coordSize);
+  }
+};
+
+/// Pattern tensors merge their coordinates with byte values, which
+/// waitForMerge drops.
+template <>
+struct MergeTyped<bool> : public MergeTyped<uint8_t> {
+};
+
+void TensorBase::merge() {
+  mergeAsync();
+  waitForMerge();
+}
+
+void TensorBase::mergeAsync() {
+  waitForMerge();
+  const size_t order = getOrder();
+  if (order == 0 || this->coordinateBufferUsed == 0) {
+    if (order == 0 && this->coordinateBufferUsed > 0) {
+      pack();
+    }
+    return;
+  }
+  for (auto modeType : getFormat().getModeTypes()) {
+    taco_uassert(modeType == Dense || modeType == Sparse) <<
+        "Only tensors with dense and sparse modes support merging inserted "
+        "components into packed storage";
+  }
+
+  std::vector<size_t> permutation = getFormat().getModeOrdering();
+  std::vector<int> permutedDimensions(order);
+  for (size_t i = 0; i < order; ++i) {
+    permutedDimensions[i] = getDimensions()[permutation[i]];
+  }
+
+  // Hand the staged coordinates to the merge, so that new components can be
+  // inserted while it runs
+  shared_ptr<vector<char>> delta = this->coordinateBuffer;
+  size_t numCoordinates = this->coordinateBufferUsed / this->coordinateSize;
+  this->coordinateBuffer = shared_ptr<vector<char>>(new vector<char>);
+  this->coordinateBufferUsed = 0;
+
+  lock_guard<mutex> lock(content->mergeMutex);
+  dispatchType<MergeTyped>(getComponentType(), &content->pendingMerge,
+                           content->storage, permutedDimensions, permutation,
+                           delta, numCoordinates, this->coordinateSize);
+  content->mergePending = true;
+}
+
+void TensorBase::waitForMerge() const {
+  // only tensors with a merge in flight take the lock
+  if (!content->mergePending) {
+    return;
+  }
+  lock_guard<mutex> lock(content->mergeMutex);
+  if (content->pendingMerge.valid()) {
+    content->storage = content->pendingMerge.get();
+    if (getComponentType().isBool()) {
+      content->storage.setValues(Array(Bool(), nullptr, 0));
+    }
+  }
+  content->mergePending = false;
+}
+
 void TensorBase::zero() {
   getStorage().getValues().zero();
 }
 
-/// Inherits Access and adds a TensorBase object, so that we can retrieve the
-/// tensors that was used in an expression when we later want to pack arguments.
-struct AccessTensorNode : public AccessNode {
-  AccessTensorNode(TensorBase tensor, const std::vector<IndexVar>& indices)
-      :  AccessNode(tensor.getTensorVar(), indices), tensor(tensor) {}
-  TensorBase tensor;
-};
-
 const Access TensorBase::operator()(const std::vector<IndexVar>& indices) const {
   taco_uassert(indices.size() == getOrder()) <<
       "A tensor of order " << getOrder() << " must be indexed with " <<
@@ -344,9 +631,49 @@ Access TensorBase::operator()(const std::vector<IndexVar>& indices) {
   return Access(new AccessTensorNode(*this, indices));
 }
 
+static bool hasAlignedArrays(const TensorBase& tensor);
+static bool hasKernelKey(const TensorBase& tensor);
+
+/// The chunk sizes that dynamic and guided schedules are tuned with.
+static const vector<int> chunkSizeCandidates = {1, 4, 16, 64, 256};
+
+/// The timed computes of each candidate variant, after one that warms it up.
+static const int tuningRuns = 3;
+
+// The kernel variants that autotuning picked, by kernel key
+static map<string,KernelVariant> tunedVariants;
+static mutex tunedVariantsMutex;
+
+/// Compile the kernels for the target into a new module.
+static shared_ptr<Module> compileModule(const Stmt& assembleFunc,
+                                        const Stmt& computeFunc,
+                                        bool assumeAligned,
+                                        bool simdIntrinsics,
+                                        const Target& target) {
+  shared_ptr<Module> module = make_shared<Module>();
+  module->addFunction(assembleFunc);
+  module->addFunction(computeFunc);
+  module->setAssumeAligned(assumeAligned);
+  module->setSimdIntrinsics(simdIntrinsics);
+  module->setTarget(target);
+  module->compile();
+  return module;
+}
+
+/// True iff the module's parallel loops are compiled with OpenMP, so that
+/// their schedule matters.
+static bool hasOpenMP(const Module& module) {
+  return util::contains(util::split(module.getCompilerFlags(), " "),
+                        string("-fopenmp"));
+}
+
 void TensorBase::compile(bool assembleWhileCompute) {
   taco_uassert(getTensorVar().getIndexExpr().defined())
       << error::compile_without_expr;
+  taco_uassert(!getComponentType().isBool()) << error::compile_pattern_result;
+  checkPatternOperands(getTensorVar().getIndexExpr());
+  taco_uassert(!util::contains(getFormat().getModeTypes(), Diagonal))
+      << error::compile_diagonal_result;
 
   std::set<lower::Property> assembleProperties, computeProperties;
   assembleProperties.insert(lower::Assemble);
@@ -354,15 +681,126 @@ void TensorBase::compile(bool assembleWhileCompute) {
   if (assembleWhileCompute) {
     computeProperties.insert(lower::Assemble);
   }
+  if (content->parallelAssembly) {
+    assembleProperties.insert(lower::ParallelAssemble);
+    computeProperties.insert(lower::ParallelAssemble);
+  }
+  if (content->nonzeroBalancing) {
+    computeProperties.insert(lower::BalanceNonzeros);
+  }
 
   content->assembleWhileCompute = assembleWhileCompute;
+  content->assembledFingerprints.clear();
+  content->resetTuning();
   TensorVar tensorVar = getTensorVar();
   content->assembleFunc = lower::lower(tensorVar, "assemble",
                                        assembleProperties, getAllocSize());
   content->computeFunc  = lower::lower(tensorVar, "compute",
                                        computeProperties, getAllocSize());
+
+  // Bind to precompiled kernels instead of compiling, if any are registered
+  PrecompiledKernels precompiled;
+  content->precompiled = nullptr;
+  if (hasKernelKey(*this) &&
+      getPrecompiledKernels(getKernelKey(assembleWhileCompute), &precompiled)) {
+    content->precompiled = make_shared<PrecompiledKernels>(precompiled);
+    content->module->setAssumeAligned(false);
+    return;
+  }
+
+  if (content->autotuning) {
+    bool assumeAligned = getAllocator()->isAligned() &&
+                         hasAlignedArrays(*this);
+    content->tuningKey = hasKernelKey(*this) ?
+                         getKernelKey(assembleWhileCompute) : "";
+
+    // Reuse the variant that was tuned for the same kernels
+    KernelVariant tuned;
+    bool isTuned = false;
+    if (!content->tuningKey.empty()) {
+      lock_guard<mutex> lock(tunedVariantsMutex);
+      isTuned = util::contains(tunedVariants, content->tuningKey);
+      if (isTuned) {
+        tuned = tunedVariants.at(content->tuningKey);
+      }
+    }
+    if (isTuned) {
+      set<lower::Property> properties = computeProperties;
+      properties.erase(lower::BalanceNonzeros);
+      if (tuned.nonzeroBalancing) {
+        properties.insert(lower::BalanceNonzeros);
+      }
+      content->computeFunc = lower::lower(tensorVar, "compute", properties,
+                                          getAllocSize());
+      content->module = compileModule(content->assembleFunc,
+                                      content->computeFunc, assumeAligned,
+                                      tuned.simdIntrinsics, content->target);
+      content->tunedVariant = tuned;
+      content->tuned = true;
+      return;
+    }
+
+    // Compile the compute kernels that differ in their code, and time each
+    // with every parallel schedule and chunk size
+    map<string,size_t> variantCode;
+    for (bool nonzeroBalancing : {false, true}) {
+      set<lower::Property> properties = computeProperties;
+      properties.erase(lower::BalanceNonzeros);
+      if (nonzeroBalancing) {
+        properties.insert(lower::BalanceNonzeros);
+      }
+      Stmt computeFunc = lower::lower(tensorVar, "compute", properties,
+                                      getAllocSize());
+      for (bool simdIntrinsics : {false, true}) {
+        stringstream code;
+        CodeGen_C codegen(code, CodeGen_C::OutputKind::C99Implementation,
+                          assumeAligned, simdIntrinsics,
+                          content->target.multiversion);
+        codegen.compile(computeFunc, false);
+        if (util::contains(variantCode, code.str())) {
+          continue;
+        }
+        variantCode.insert({code.str(), content->candidateModules.size()});
+        shared_ptr<Module> module = compileModule(content->assembleFunc,
+                                                  computeFunc, assumeAligned,
+                                                  simdIntrinsics,
+                                                  content->target);
+        KernelVariant variant;
+        variant.nonzeroBalancing = nonzeroBalancing;
+        variant.simdIntrinsics = simdIntrinsics;
+        vector<pair<ParallelSchedule,int>> schedules = {
+            {ParallelSchedule::Default, 0}};
+        if (content->parallelOptions.parallelize && hasOpenMP(*module)) {
+          schedules.push_back({ParallelSchedule::Static, 0});
+          for (auto schedule : {ParallelSchedule::Dynamic,
+                                ParallelSchedule::Guided}) {
+            for (int chunkSize : chunkSizeCandidates) {
+              schedules.push_back({schedule, chunkSize});
+            }
+          }
+        }
+        for (auto& schedule : schedules) {
+          variant.schedule = schedule.first;
+          variant.chunkSize = schedule.second;
+          content->candidates.push_back(variant);
+          content->candidateModules.push_back(module);
+        }
+      }
+    }
+    content->module = content->candidateModules[0];
+    return;
+  }
+
+  content->module = make_shared<Module>();
   content->module->addFunction(content->assembleFunc);
   content->module->addFunction(content->computeFunc);
+  content->module->setAssumeAligned(getAllocator()->isAligned() &&
+                                    hasAlignedArrays(*this));
+  content->module->setSimdIntrinsics(content->simdIntrinsics);
+  content->module->setTarget(content->target);
+  content->module->setTieredExecution(content->tieredExecution,
+                                      content->tierThreshold);
+  content->module->setTieredCompilation(content->tieredCompilation);
   content->module->compile();
 }
 
@@ -415,9 +853,26 @@ static taco_tensor_t* packTensorData(const TensorBase& tensor) {
         tensorData->indices[i][1] = (uint8_t*)idx.getData();
       }
         break;
-      case ModeType::Fixed:
-        taco_not_supported_yet;
+      case ModeType::Fixed: {
+        tensorData->mode_types[i] = taco_mode_fixed;
+        tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
+
+        const Array& size = modeIndex.getIndexArray(0);
+        const Array& idx  = modeIndex.getIndexArray(1);
+        tensorData->indices[i][0] = (uint8_t*)size.getData();
+        tensorData->indices[i][1] = (uint8_t*)idx.getData();
         break;
+      }
+      case ModeType::Diagonal: {
+        tensorData->mode_types[i] = taco_mode_diagonal;
+        tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
+
+        const Array& size    = modeIndex.getIndexArray(0);
+        const Array& offsets = modeIndex.getIndexArray(1);
+        tensorData->indices[i][0] = (uint8_t*)size.getData();
+        tensorData->indices[i][1] = (uint8_t*)offsets.getData();
+        break;
+      }
     }
   }
 
@@ -469,6 +924,7 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
         break;
       }
       case ModeType::Fixed:
+      case ModeType::Diagonal:
         taco_not_supported_yet;
         break;
     }
@@ -478,23 +934,31 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
   return numVals;
 }
 
-static inline vector<TensorBase> getTensors(const IndexExpr& expr) {
-  struct GetOperands : public ExprVisitor {
-    using ExprVisitor::visit;
-    set<TensorBase> inserted;
-    vector<TensorBase> operands;
-    void visit(const AccessNode* node) {
-      taco_iassert(isa<AccessTensorNode>(node)) << "Unknown subexpression";
-      TensorBase tensor = to<AccessTensorNode>(node)->tensor;
-      if (!util::contains(inserted, tensor)) {
-        inserted.insert(tensor);
-        operands.push_back(tensor);
+static bool hasAlignedArrays(const Storage& storage) {
+  const Index& index = storage.getIndex();
+  for (size_t i = 0; i < index.numModeIndices(); i++) {
+    const ModeIndex& modeIndex = index.getModeIndex(i);
+    for (size_t j = 0; j < modeIndex.numIndexArrays(); j++) {
+      if (!isAligned(modeIndex.getIndexArray(j).getData())) {
+        return false;
       }
     }
-  };
-  GetOperands getOperands;
-  expr.accept(&getOperands);
-  return getOperands.operands;
+  }
+  return isAligned(storage.getValues().getData());
+}
+
+/// True iff every array of the tensor and of the operands of its expression
+/// is aligned to storage::ARRAY_ALIGNMENT bytes.
+static bool hasAlignedArrays(const TensorBase& tensor) {
+  if (!hasAlignedArrays(tensor.getStorage())) {
+    return false;
+  }
+  for (auto& operand : getTensors(tensor.getTensorVar().getIndexExpr())) {
+    if (!hasAlignedArrays(operand.getStorage())) {
+      return false;
+    }
+  }
+  return true;
 }
 
 static inline
@@ -512,26 +976,142 @@ vector<void*> packArguments(const TensorBase& tensor) {
   return arguments;
 }
 
+/// Returns the storage fingerprints of the result and its operands.
+static vector<uint64_t> getFingerprints(const TensorBase& tensor) {
+  vector<uint64_t> fingerprints;
+  fingerprints.push_back(tensor.getStorage().getFingerprint());
+  for (auto& operand : getTensors(tensor.getTensorVar().getIndexExpr())) {
+    fingerprints.push_back(operand.getStorage().getFingerprint());
+  }
+  return fingerprints;
+}
+
+/// Returns true iff the chunk size of the parallel loops is autotuned.
+static bool isChunkSizeTuned(const ParallelOptions& options) {
+  return options.parallelize && options.chunkSize == 0 &&
+         (options.schedule == ParallelSchedule::Dynamic ||
+          options.schedule == ParallelSchedule::Guided);
+}
+
+/// Pass the parallel execution parameters to the module's kernels, or to the
+/// precompiled kernels if there are any.
+static void setParallel(Module* module, const PrecompiledKernels* precompiled,
+                        const ParallelOptions& options, int chunkSize) {
+  if (precompiled != nullptr) {
+    precompiled->setParallel(options.parallelize, options.numThreads,
+                             (int)options.schedule, chunkSize);
+    return;
+  }
+  module->setParallel(options.parallelize, options.numThreads,
+                      (int)options.schedule, chunkSize);
+}
+
 void TensorBase::assemble() {
   taco_uassert(this->content->assembleFunc.defined())
       << error::assemble_without_compile;
-
+  taco_uassert(!content->module->getAssumeAligned() || hasAlignedArrays(*this))
+      << error::unaligned_arrays;
+
+  ParallelOptions options = content->parallelOptions;
+  int chunkSize = options.chunkSize;
+  if (content->tuned) {
+    options.schedule = content->tunedVariant.schedule;
+    chunkSize = content->tunedVariant.chunkSize;
+  }
+  setParallel(content->module.get(), content->precompiled.get(), options,
+              chunkSize);
   auto arguments = packArguments(*this);
-  content->module->callFuncPacked("assemble", arguments.data());
+  if (content->precompiled) {
+    content->precompiled->assemble(arguments.data());
+  } else {
+    content->module->callFuncPacked("assemble", arguments.data());
+  }
 
   if (!content->assembleWhileCompute) {
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
     content->valuesSize = unpackTensorData(*tensorData, *this);
   }
   for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
+  content->assembledFingerprints = getFingerprints(*this);
 }
 
 void TensorBase::compute() {
   taco_uassert(this->content->computeFunc.defined())
       << error::compute_without_compile;
+  taco_uassert(!content->module->getAssumeAligned() || hasAlignedArrays(*this))
+      << error::unaligned_arrays;
+
+  // Time the computes with each candidate variant before settling on the
+  // fastest.  Kernels that aren't autotuned time each candidate chunk size
+  // instead, if it's tuned and the kernels are compiled with OpenMP.
+  ParallelOptions options = content->parallelOptions;
+  if (!content->tuned && content->candidates.empty() &&
+      isChunkSizeTuned(options) &&
+      (content->precompiled || hasOpenMP(*content->module))) {
+    for (int chunkSize : chunkSizeCandidates) {
+      KernelVariant variant;
+      variant.nonzeroBalancing = content->nonzeroBalancing;
+      variant.simdIntrinsics = content->simdIntrinsics;
+      variant.schedule = options.schedule;
+      variant.chunkSize = chunkSize;
+      content->candidates.push_back(variant);
+      content->candidateModules.push_back(content->module);
+    }
+    content->tuningChunkSize = true;
+  }
+  const size_t candidate = content->candidateTimes.size();
+  const bool tuning = candidate < content->candidates.size();
+  int chunkSize = options.chunkSize;
+  Module* module = content->module.get();
+  if (tuning || content->tuned) {
+    const KernelVariant& variant = tuning ? content->candidates[candidate]
+                                          : content->tunedVariant;
+    options.schedule = variant.schedule;
+    chunkSize = variant.chunkSize;
+    if (tuning) {
+      module = content->candidateModules[candidate].get();
+    }
+  }
+  setParallel(module, content->precompiled.get(), options, chunkSize);
 
   auto arguments = packArguments(*this);
-  this->content->module->callFuncPacked("compute", arguments.data());
+  util::Timer timer;
+  timer.start();
+  if (content->precompiled) {
+    content->precompiled->compute(arguments.data());
+  } else {
+    module->callFuncPacked("compute", arguments.data());
+  }
+  timer.stop();
+  if (tuning) {
+    // the first compute of a candidate warms it up, and its time is the
+    // fastest of the next ones
+    double time = timer.getResult().mean;
+    if (content->candidateRuns > 0 &&
+        (content->candidateRuns == 1 || time < content->candidateTime)) {
+      content->candidateTime = time;
+    }
+    if (++content->candidateRuns > tuningRuns) {
+      content->candidateTimes.push_back(content->candidateTime);
+      content->candidateRuns = 0;
+    }
+  }
+  vector<double>& candidateTimes = content->candidateTimes;
+  if (tuning && candidateTimes.size() == content->candidates.size()) {
+    size_t fastest = min_element(candidateTimes.begin(),
+                                 candidateTimes.end()) -
+                     candidateTimes.begin();
+    content->tunedVariant = content->candidates[fastest];
+    content->module = content->candidateModules[fastest];
+    content->tuned = true;
+    content->candidates.clear();
+    content->candidateModules.clear();
+    candidateTimes.clear();
+    if (!content->tuningChunkSize && !content->tuningKey.empty()) {
+      lock_guard<mutex> lock(tunedVariantsMutex);
+      tunedVariants[content->tuningKey] = content->tunedVariant;
+    }
+  }
 
   if (content->assembleWhileCompute) {
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
@@ -540,6 +1120,11 @@ void TensorBase::compute() {
   for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
 }
 
+void TensorBase::compute(const ParallelOptions& options) {
+  setParallelOptions(options);
+  compute();
+}
+
 void TensorBase::evaluate() {
   this->compile();
   if (!getTensorVar().isAccumulating()) {
@@ -548,6 +1133,83 @@ void TensorBase::evaluate() {
   this->compute();
 }
 
+void TensorBase::recompute() {
+  taco_uassert(this->content->computeFunc.defined())
+      << error::compute_without_compile;
+
+  // Kernels that assemble while computing always rebuild the index
+  if (!getTensorVar().isAccumulating() && !content->assembleWhileCompute &&
+      content->assembledFingerprints != getFingerprints(*this)) {
+    this->assemble();
+  }
+  this->compute();
+}
+
+template <typename T>
+struct InsertComponents {
+  static void apply(const TensorBase& from, TensorBase* to) {
+    for (auto& component : iterate<T>(from)) {
+      to->insert(component.first, component.second);
+    }
+  }
+};
+
+void insertComponents(const TensorBase& from, TensorBase* to) {
+  taco_iassert(from.getComponentType() == to->getComponentType());
+  dispatchType<InsertComponents>(from.getComponentType(), from, to);
+}
+
+void TensorBase::applyDelta(const TensorBase& operand,
+                            const TensorBase& delta) {
+  IndexExpr expr = getTensorVar().getIndexExpr();
+  taco_uassert(expr.defined()) << error::compile_without_expr;
+  taco_uassert(!getTensorVar().isAccumulating()) <<
+      "Deltas can only be applied to results that are assigned";
+  taco_uassert(delta.getComponentType() == operand.getComponentType() &&
+               delta.getDimensions() == operand.getDimensions()) <<
+      "The delta tensor " << delta.getName() << " must have the type and " <<
+      "dimensions of " << operand.getName();
+
+  auto key = make_pair(operand, delta);
+  if (!util::contains(content->deltaKernels, key)) {
+    // Substitute the delta for every access of the operand
+    IndexExpr deltaExpr = getDeltaExpr(expr,
+                                       getSubstitutions(expr, operand, delta));
+    if (!deltaExpr.defined()) {
+      return;
+    }
+
+    // Dense results are updated in place by an accumulating kernel, while
+    // other results get the change computed into a tensor of their format
+    bool dense = true;
+    for (auto modeType : getFormat().getModeTypes()) {
+      dense &= (modeType == Dense);
+    }
+    TensorBase kernel(getName(), getComponentType(), getDimensions(),
+                      getFormat());
+    kernel.setIndexExpression(getTensorVar().getFreeVars(), deltaExpr, dense);
+    if (dense) {
+      kernel.getStorage() = getStorage();
+    }
+    kernel.compile();
+    content->deltaKernels.insert({key, kernel});
+  }
+
+  TensorBase kernel = content->deltaKernels.at(key);
+  if (kernel.getTensorVar().isAccumulating()) {
+    kernel.getStorage() = getStorage();
+    kernel.compute();
+    return;
+  }
+  kernel.assemble();
+  kernel.compute();
+
+  // Merging rebuilds the index of the result, so the cost is linear in the
+  // size of the result rather than in the size of the change
+  insertComponents(kernel, this);
+  merge();
+}
+
 void TensorBase::operator=(const IndexExpr& expr) {
   taco_uassert(getOrder() == 0)
       << "Must use index variable on the left-hand-side when assigning an "
@@ -558,6 +1220,7 @@ void TensorBase::operator=(const IndexExpr& expr) {
 void TensorBase::setIndexExpression(const vector<IndexVar>& indexVars, IndexExpr expr,
                          bool accumulate) {
   content->tensorVar.setIndexExpression(indexVars, expr, accumulate);
+  content->deltaKernels.clear();
 }
 
 void TensorBase::printComputeIR(ostream& os, bool color, bool simplify) const {
@@ -574,6 +1237,146 @@ string TensorBase::getSource() const {
   return content->module->getSource();
 }
 
+/// True iff the tensor's kernels have a key: its expression is not scheduled
+/// and its tensors have distinct names.
+static bool hasKernelKey(const TensorBase& tensor) {
+  if (!tensor.getTensorVar().getSchedule().getOperatorSplits().empty()) {
+    return false;
+  }
+  set<string> names = {tensor.getName()};
+  for (auto& operand : getTensors(tensor.getTensorVar().getIndexExpr())) {
+    if (operand != tensor && !names.insert(operand.getName()).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Returns the string with the tensor names replaced by `tensorNames` and the
+/// index variable names by i0, i1, ... in the order they first appear, which
+/// `varNames` records. Other identifiers that are followed by an opening
+/// parenthesis are functions, and numbers are kept.
+static string renameIdentifiers(const string& str,
+                                const map<string,string>& tensorNames,
+                                map<string,string>* varNames) {
+  auto isIdentifierChar = [](char c) {
+    return isalnum((unsigned char)c) || c == '_';
+  };
+  string renamed;
+  size_t i = 0;
+  while (i < str.size()) {
+    if (!isIdentifierChar(str[i])) {
+      renamed += str[i++];
+      continue;
+    }
+    size_t end = i;
+    while (end < str.size() && (isIdentifierChar(str[end]) ||
+           (isdigit((unsigned char)str[i]) && str[end] == '.'))) {
+      end++;
+    }
+    string token = str.substr(i, end - i);
+    if (isdigit((unsigned char)token[0])) {
+      renamed += token;
+    } else if (util::contains(tensorNames, token)) {
+      renamed += tensorNames.at(token);
+    } else if (end < str.size() && str[end] == '(') {
+      renamed += token;
+    } else {
+      if (!util::contains(*varNames, token)) {
+        varNames->insert({token, "i" + to_string(varNames->size())});
+      }
+      renamed += varNames->at(token);
+    }
+    i = end;
+  }
+  return renamed;
+}
+
+string TensorBase::getKernelKey(bool assembleWhileCompute) const {
+  TensorVar tensorVar = getTensorVar();
+  taco_uassert(tensorVar.getIndexExpr().defined())
+      << error::compile_without_expr;
+  taco_uassert(hasKernelKey(*this)) << "The kernels of " << getName() <<
+      " have no key, since its expression is scheduled or its tensors " <<
+      "don't have distinct names";
+
+  // The result is t0 and the operands t1, t2, ... in the order that the
+  // kernels take them
+  vector<TensorBase> tensors = {*this};
+  map<string,string> tensorNames = {{getName(), "t0"}};
+  for (auto& operand : getTensors(tensorVar.getIndexExpr())) {
+    if (operand != *this) {
+      tensorNames.insert({operand.getName(), "t" + to_string(tensors.size())});
+      tensors.push_back(operand);
+    }
+  }
+
+  map<string,string> varNames;
+  stringstream key;
+  key << renameIdentifiers(getName() + "(" +
+                           util::join(tensorVar.getFreeVars()) + ")",
+                           tensorNames, &varNames)
+      << (tensorVar.isAccumulating() ? " += " : " = ")
+      << renameIdentifiers(util::toString(tensorVar.getIndexExpr()),
+                           tensorNames, &varNames);
+  for (size_t i = 0; i < tensors.size(); i++) {
+    key << "; t" << i << ": " << tensors[i].getTensorVar().getType() << " "
+        << tensors[i].getFormat();
+  }
+  if (tensorVar.getAccumulationType().getKind() != DataType::Undefined) {
+    key << "; accumulate " << tensorVar.getAccumulationType();
+  }
+  if (assembleWhileCompute) {
+    key << "; assemble while compute";
+  }
+  return key.str();
+}
+
+void compileToStaticLibrary(const vector<TensorBase>& tensors,
+                            const string& path, const string& prefix,
+                            bool assembleWhileCompute, const Target& target) {
+  taco_uassert(!tensors.empty()) << "A library needs at least one tensor";
+  Module module(target);
+  set<string> names;
+  bool simdIntrinsics = false;
+  for (auto& tensor : tensors) {
+    string key = tensor.getKernelKey(assembleWhileCompute);
+    taco_uassert(!tensor.getComponentType().isBool())
+        << error::compile_pattern_result;
+    checkPatternOperands(tensor.getTensorVar().getIndexExpr());
+    taco_uassert(!util::contains(tensor.getFormat().getModeTypes(), Diagonal))
+        << error::compile_diagonal_result;
+    taco_uassert(names.insert(tensor.getName()).second) <<
+        "The tensors of a library must have distinct names, but several " <<
+        "are named " << tensor.getName();
+
+    set<lower::Property> assembleProperties, computeProperties;
+    assembleProperties.insert(lower::Assemble);
+    computeProperties.insert(lower::Compute);
+    if (assembleWhileCompute) {
+      computeProperties.insert(lower::Assemble);
+    }
+    if (tensor.content->parallelAssembly) {
+      assembleProperties.insert(lower::ParallelAssemble);
+      computeProperties.insert(lower::ParallelAssemble);
+    }
+    if (tensor.content->nonzeroBalancing) {
+      computeProperties.insert(lower::BalanceNonzeros);
+    }
+
+    string name = prefix + "_" + tensor.getName();
+    module.addFunction(lower::lower(tensor.getTensorVar(), name + "_assemble",
+                                    assembleProperties,
+                                    tensor.getAllocSize()));
+    module.addFunction(lower::lower(tensor.getTensorVar(), name + "_compute",
+                                    computeProperties, tensor.getAllocSize()));
+    module.addKernels(key, name + "_assemble", name + "_compute");
+    simdIntrinsics |= tensor.content->simdIntrinsics;
+  }
+  module.setSimdIntrinsics(simdIntrinsics);
+  module.compileToStaticLibrary(path, prefix);
+}
+
 void TensorBase::compileSource(std::string source) {
   taco_iassert(getTensorVar().getIndexExpr().defined())
       << "No expression defined for tensor";
@@ -581,6 +1384,13 @@ void TensorBase::compileSource(std::string source) {
   set<lower::Property> assembleProperties, computeProperties;
   assembleProperties.insert(lower::Assemble);
   computeProperties.insert(lower::Compute);
+  if (content->parallelAssembly) {
+    assembleProperties.insert(lower::ParallelAssemble);
+    computeProperties.insert(lower::ParallelAssemble);
+  }
+  if (content->nonzeroBalancing) {
+    computeProperties.insert(lower::BalanceNonzeros);
+  }
 
   TensorVar tensorVar = getTensorVar();
   content->assembleFunc = lower::lower(tensorVar, "assemble",
@@ -592,7 +1402,14 @@ void TensorBase::compileSource(std::string source) {
   CodeGen_C::generateShim(content->assembleFunc, ss);
   ss << endl;
   CodeGen_C::generateShim(content->computeFunc, ss);
+  content->precompiled = nullptr;
+  content->candidates.clear();
+  content->candidateModules.clear();
+  content->candidateTimes.clear();
+  content->tuned = false;
+  content->module = make_shared<Module>();
   content->module->setSource(source + "\n" + ss.str());
+  content->module->setTarget(content->target);
   content->module->compile();
 }
 
@@ -652,7 +1469,7 @@ bool equals(const TensorBase& a, const TensorBase& b) {
 
   // Values must be the same
   switch(a.getComponentType().getKind()) {
-    case DataType::Bool: taco_ierror; return false;
+    case DataType::Bool: return equalsTyped<bool>(a, b);
     case DataType::UInt8: return equalsTyped<uint8_t>(a, b);
     case DataType::UInt16: return equalsTyped<uint16_t>(a, b);
     case DataType::UInt32: return equalsTyped<uint32_t>(a, b);
@@ -663,6 +1480,8 @@ bool equals(const TensorBase& a, const TensorBase& b) {
     case DataType::Int32: return equalsTyped<int32_t>(a, b);
     case DataType::Int64: return equalsTyped<int64_t>(a, b);
     case DataType::Int128: return equalsTyped<long long>(a, b);
+    case DataType::Float16: return equalsTyped<float16>(a, b);
+    case DataType::BFloat16: return equalsTyped<bfloat16>(a, b);
     case DataType::Float32: return equalsTyped<float>(a, b);
     case DataType::Float64: return equalsTyped<double>(a, b);
     case DataType::Complex64: return equalsTyped<std::complex<float>>(a, b);
@@ -711,7 +1530,7 @@ ostream& operator<<(ostream& os, const TensorBase& tensor) {
     int* ptr = (int*)&tensor.coordinateBuffer->data()[i*tensor.coordinateSize];
     os << "(" << util::join(ptr, ptr+tensor.getOrder()) << "): ";
     switch(tensor.getComponentType().getKind()) {
-      case DataType::Bool: taco_ierror; break;
+      case DataType::Bool: os << ((bool*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::UInt8: os << ((uint8_t*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::UInt16: os << ((uint16_t*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::UInt32: os << ((uint32_t*)(ptr+tensor.getOrder()))[0] << std::endl; break;
@@ -722,6 +1541,8 @@ ostream& operator<<(ostream& os, const TensorBase& tensor) {
       case DataType::Int32: os << ((int32_t*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::Int64: os << ((int64_t*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::Int128: os << ((long long*)(ptr+tensor.getOrder()))[0] << std::endl; break;
+      case DataType::Float16: os << ((float16*)(ptr+tensor.getOrder()))[0] << std::endl; break;
+      case DataType::BFloat16: os << ((bfloat16*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::Float32: os << ((float*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::Float64: os << ((double*)(ptr+tensor.getOrder()))[0] << std::endl; break;
       case DataType::Complex64: os << ((std::complex<float>*)(ptr+tensor.getOrder()))[0] << std::endl; break;
@@ -6,6 +6,7 @@
 
 #include <ostream>
 #include <set>
+#include <cstring>
 #include <complex>
 
 using namespace std;
@@ -35,7 +36,12 @@ bool DataType::isInt() const {
 }
 
 bool DataType::isFloat() const {
-  return getKind() == Float32 || getKind() == Float64;
+  return getKind() == Float16 || getKind() == BFloat16 ||
+         getKind() == Float32 || getKind() == Float64;
+}
+
+bool DataType::isHalf() const {
+  return getKind() == Float16 || getKind() == BFloat16;
 }
 
 bool DataType::isComplex() const {
@@ -43,10 +49,15 @@ bool DataType::isComplex() const {
 }
   
 DataType max_type(DataType a, DataType b) {
-  taco_iassert(!a.isBool() && !b.isBool()) <<
-  "Can't do arithmetic on booleans.";
-  
-  if (a == b) {
+  // Boolean (pattern) tensors have implicit unit values, so they take on the
+  // type of the values they are combined with
+  if (a.isBool()) {
+    return b;
+  }
+  else if (b.isBool()) {
+    return a;
+  }
+  else if (a == b) {
     return a;
   }
   else if (a.isComplex() || b.isComplex()) {
@@ -58,6 +69,7 @@ DataType max_type(DataType a, DataType b) {
     }
   }
   else if(a.isFloat() || b.isFloat()) {
+    // 16-bit floats are promoted to single precision for arithmetic
     if (a == Float64() || b == Float64()) {
       return Float64();
     }
@@ -90,6 +102,8 @@ size_t DataType::getNumBits() const {
       return 8;
     case UInt16:
     case Int16:
+    case Float16:
+    case BFloat16:
       return 16;
     case UInt32:
     case Int32:
@@ -114,6 +128,7 @@ std::ostream& operator<<(std::ostream& os, const DataType& type) {
   if (type.isBool()) os << "bool";
   else if (type.isInt()) os << "int" << type.getNumBits() << "_t";
   else if (type.isUInt()) os << "uint" << type.getNumBits() << "_t";
+  else if (type.isHalf()) os << "uint16_t";
   else if (type == DataType::Float32) os << "float";
   else if (type == DataType::Float64) os << "double";
   else if (type == DataType::Complex64) os << "float complex";
@@ -135,6 +150,8 @@ std::ostream& operator<<(std::ostream& os, const DataType::Kind& kind) {
     case DataType::Int32: os << "Int32"; break;
     case DataType::Int64: os << "Int64"; break;
     case DataType::Int128: os << "Int128"; break;
+    case DataType::Float16: os << "Float16"; break;
+    case DataType::BFloat16: os << "BFloat16"; break;
     case DataType::Float32: os << "Float32"; break;
     case DataType::Float64: os << "Float64"; break;
     case DataType::Complex64: os << "Complex64"; break;
@@ -224,6 +241,7 @@ DataType Int128() {
   
 DataType Float(int bits) {
   switch (bits) {
+    case 16: return DataType(DataType::Float16);
     case 32: return DataType(DataType::Float32);
     case 64: return DataType(DataType::Float64);
     default: 
@@ -232,6 +250,14 @@ DataType Float(int bits) {
   }
 }
 
+DataType Float16() {
+  return DataType(DataType::Float16);
+}
+
+DataType BFloat16() {
+  return DataType(DataType::BFloat16);
+}
+
 DataType Float32() {
   return DataType(DataType::Float32);
 }
@@ -258,6 +284,106 @@ DataType Complex128() {
   return DataType(DataType::Complex128);
 }
 
+// class float16
+float16::float16(float value) {
+  uint32_t f;
+  memcpy(&f, &value, sizeof(f));
+  uint32_t sign = (f >> 16) & 0x8000;
+  uint32_t absf = f & 0x7fffffff;
+  if (absf > 0x7f800000) {         // NaN
+    bits = sign | 0x7e00;
+  } else if (absf >= 0x477ff000) { // overflows to infinity after rounding
+    bits = sign | 0x7c00;
+  } else if (absf < 0x38800000) {  // subnormal or zero
+    // Align the significand (with its implicit bit) to the subnormal grid
+    int shift = 126 - (int)(absf >> 23);
+    if (shift > 24) {
+      bits = sign;
+    } else {
+      uint32_t significand = (absf & 0x7fffff) | 0x800000;
+      uint32_t half = significand >> shift;
+      uint32_t remainder = significand & ((1u << shift) - 1);
+      uint32_t midpoint = 1u << (shift - 1);
+      if (remainder > midpoint || (remainder == midpoint && (half & 1))) {
+        half++;
+      }
+      bits = sign | half;
+    }
+  } else {
+    // Rebias the exponent and round the significand to nearest even
+    uint32_t half = ((absf - 0x38000000) >> 13);
+    uint32_t remainder = absf & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+      half++;
+    }
+    bits = sign | half;
+  }
+}
+
+float16::operator float() const {
+  uint32_t sign = (uint32_t)(bits & 0x8000) << 16;
+  uint32_t exponent = (bits >> 10) & 0x1f;
+  uint32_t significand = bits & 0x3ff;
+  uint32_t f;
+  if (exponent == 0x1f) {          // infinity or NaN
+    f = sign | 0x7f800000 | (significand << 13);
+  } else if (exponent != 0) {      // normal
+    f = sign | ((exponent + 112) << 23) | (significand << 13);
+  } else if (significand == 0) {   // zero
+    f = sign;
+  } else {                         // subnormal: normalize it
+    exponent = 113;
+    while ((significand & 0x400) == 0) {
+      significand <<= 1;
+      exponent--;
+    }
+    f = sign | (exponent << 23) | ((significand & 0x3ff) << 13);
+  }
+  float value;
+  memcpy(&value, &f, sizeof(value));
+  return value;
+}
+
+float16 float16::fromBits(uint16_t bits) {
+  float16 value;
+  value.bits = bits;
+  return value;
+}
+
+std::ostream& operator<<(std::ostream& os, float16 value) {
+  return os << (float)value;
+}
+
+
+// class bfloat16
+bfloat16::bfloat16(float value) {
+  uint32_t f;
+  memcpy(&f, &value, sizeof(f));
+  if ((f & 0x7fffffff) > 0x7f800000) {
+    bits = (f >> 16) | 0x40;  // keep NaNs quiet
+  } else {
+    bits = (f + 0x7fff + ((f >> 16) & 1)) >> 16;
+  }
+}
+
+bfloat16::operator float() const {
+  uint32_t f = (uint32_t)bits << 16;
+  float value;
+  memcpy(&value, &f, sizeof(value));
+  return value;
+}
+
+bfloat16 bfloat16::fromBits(uint16_t bits) {
+  bfloat16 value;
+  value.bits = bits;
+  return value;
+}
+
+std::ostream& operator<<(std::ostream& os, bfloat16 value) {
+  return os << (float)value;
+}
+
+
 // class Dimension
 Dimension::Dimension() : size(0) {
 }
@@ -0,0 +1,174 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/array_util.h"
+#include "taco/storage/allocator.h"
+
+using namespace taco;
+using namespace taco::storage;
+
+TEST(allocator, aligned) {
+  AlignedAllocator allocator;
+  for (size_t size : {1, 3, 64, 1000}) {
+    void* ptr = allocator.allocate(size);
+    ASSERT_TRUE(isAligned(ptr));
+    allocator.deallocate(ptr);
+  }
+}
+
+TEST(allocator, huge_pages) {
+  const size_t hugePageSize = size_t(1) << 21;
+  AlignedAllocator allocator(hugePageSize);
+  void* ptr = allocator.allocate(2 * hugePageSize);
+  ASSERT_TRUE(isAligned(ptr, hugePageSize));
+  allocator.deallocate(ptr);
+
+  AlignedAllocator noHugePages(0);
+  ASSERT_EQ(0u, noHugePages.getHugePageThreshold());
+  ptr = noHugePages.allocate(2 * hugePageSize);
+  ASSERT_TRUE(isAligned(ptr));
+  noHugePages.deallocate(ptr);
+}
+
+TEST(allocator, reallocate) {
+  AlignedAllocator allocator;
+  int* ptr = (int*)allocator.allocate(4 * sizeof(int));
+  for (int i = 0; i < 4; i++) ptr[i] = i;
+  for (size_t size = 8; size <= (1 << 16); size *= 2) {
+    ptr = (int*)allocator.reallocate(ptr, size * sizeof(int));
+    ASSERT_TRUE(isAligned(ptr));
+    for (int i = 0; i < 4; i++) ASSERT_EQ(i, ptr[i]);
+  }
+  allocator.deallocate(ptr);
+}
+
+TEST(allocator, arrays) {
+  ASSERT_TRUE(isAligned(makeArray(type<double>(), 7).getData()));
+  ASSERT_TRUE(isAligned(makeArray<int>({1, 2, 3}).getData()));
+}
+
+TEST(allocator, aligned_kernel) {
+  Tensor<double> y("y", {3}, Format({Dense}));
+  Tensor<double> A = d33a("A", Format({Dense, Sparse}));
+  Tensor<double> x = d3b("x", Format({Dense}));
+  A.pack();
+  x.pack();
+
+  IndexVar i, j;
+  y(i) = A(i,j) * x(j);
+  y.compile();
+  ASSERT_NE(std::string::npos, y.getSource().find("*)TACO_ASSUME_ALIGNED("));
+  y.assemble();
+  y.compute();
+  ASSERT_TRUE(isAligned(y.getStorage().getValues().getData()));
+
+  Tensor<double> expected("expected", {3}, Format({Dense}));
+  expected.insert({2}, 18.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, y));
+}
+
+TEST(allocator, unaligned_operands) {
+  alignas(ARRAY_ALIGNMENT) double storage[4] = {0.0, 1.0, 2.0, 3.0};
+  double* vals = storage + 1;
+
+  Tensor<double> x("x", {3}, Format({Dense}));
+  x.getStorage().setValues(makeArray(vals, 3));
+  Tensor<double> y("y", {3}, Format({Dense}));
+  IndexVar i;
+  y(i) = x(i) * x(i);
+  y.evaluate();
+  ASSERT_EQ(std::string::npos, y.getSource().find("*)TACO_ASSUME_ALIGNED("));
+  ASSERT_EQ(9.0, ((double*)y.getStorage().getValues().getData())[2]);
+}
+
+TEST(allocator, pool) {
+  PoolAllocator pool;
+  void* a = pool.allocate(100);
+  ASSERT_TRUE(isAligned(a));
+  pool.deallocate(a);
+  ASSERT_EQ(128u, pool.getCachedBytes());
+
+  // blocks of the same size class are recycled
+  void* b = pool.allocate(120);
+  ASSERT_EQ(a, b);
+  ASSERT_EQ(1u, pool.getNumReused());
+  ASSERT_EQ(0u, pool.getCachedBytes());
+
+  // growing within the size class keeps the block
+  ASSERT_EQ(b, pool.reallocate(b, 128));
+  ((char*)b)[127] = 42;
+  char* c = (char*)pool.reallocate(b, 1000);
+  ASSERT_EQ(42, c[127]);
+  pool.deallocate(c);
+
+  // memory the pool did not allocate is freed
+  pool.deallocate(malloc(16));
+
+  pool.trim();
+  ASSERT_EQ(0u, pool.getCachedBytes());
+}
+
+TEST(allocator, pool_cache_limit) {
+  PoolAllocator pool(256);
+  void* a = pool.allocate(256);
+  void* b = pool.allocate(256);
+  pool.deallocate(a);
+  pool.deallocate(b);
+  ASSERT_EQ(256u, pool.getCachedBytes());
+}
+
+TEST(allocator, pool_reassemble) {
+  auto pool = std::make_shared<PoolAllocator>();
+  setAllocator(pool);
+
+  Tensor<double> B = d33a("B", Format({Dense, Sparse}));
+  Tensor<double> C = d33b("C", Format({Dense, Sparse}));
+  B.pack();
+  C.pack();
+
+  Tensor<double> A("A", {3,3}, Format({Dense, Sparse}));
+  IndexVar i, j;
+  A(i,j) = B(i,j) + C(i,j);
+  A.compile();
+  for (int iteration = 0; iteration < 3; iteration++) {
+    A.assemble();
+    A.compute();
+  }
+
+  // the result arrays of the first assembly are recycled by later ones
+  ASSERT_LT(0u, pool->getNumReused());
+
+  Tensor<double> expected("expected", {3,3}, Format({Dense, Sparse}));
+  expected(i,j) = B(i,j) + C(i,j);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, A));
+
+  setAllocator(std::make_shared<AlignedAllocator>());
+}
+
+TEST(allocator, replace_while_allocating) {
+  // Threads that allocate keep using an allocator that is replaced meanwhile
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.push_back(std::thread([]() {
+      for (int n = 0; n < 1000; n++) {
+        void* ptr = allocate(64);
+        ASSERT_TRUE(isAligned(ptr));
+        deallocate(ptr);
+      }
+    }));
+  }
+  for (int n = 0; n < 1000; n++) {
+    setAllocator(std::make_shared<AlignedAllocator>());
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
@@ -66,3 +66,28 @@ TEST(error, compute_without_compile) {
   a(i) = b(i);
   ASSERT_DEATH(a.compute(), error::compute_without_compile);
 }
+
+TEST(error, compile_pattern_result) {
+  Tensor<bool> a({5}, Sparse);
+  Tensor<bool> b({5}, Sparse);
+  a(i) = b(i);
+  ASSERT_DEATH(a.compile(), error::compile_pattern_result);
+}
+
+TEST(error, pattern_format) {
+  Tensor<bool> A({3,4}, Format({Dense,Dense}));
+  A.insert({0,1}, true);
+  ASSERT_DEATH(A.pack(), error::pattern_format);
+
+  Tensor<double> x({4}, Dense);
+  Tensor<double> y({3}, Dense);
+  y(i) = A(i,j) * x(j);
+  ASSERT_DEATH(y.compile(), error::pattern_format);
+}
+
+TEST(error, compile_diagonal_result) {
+  Tensor<double> A({5,5}, DIA);
+  Tensor<double> B({5,5}, DIA);
+  A(i,j) = B(i,j);
+  ASSERT_DEATH(A.compile(), error::compile_diagonal_result);
+}
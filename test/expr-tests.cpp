@@ -1,6 +1,8 @@
 #include "test.h"
 #include "test_tensors.h"
 #include "taco/tensor.h"
+#include "taco/expr/expr_nodes.h"
+#include "taco/expr/expr_rewriter.h"
 
 using namespace taco;
 
@@ -118,3 +120,20 @@ TEST(expr, simplify_muladd) {
   ASSERT_EXPR_EQUALS(IndexExpr(), simplify(addmul, {Cex, Dex}));
   ASSERT_EXPR_EQUALS(IndexExpr(), simplify(addmul, {Bex, Cex, Dex}));
 }
+
+TEST(expr, delta) {
+  Type mat(type<double>(), {3,3});
+  Type vec(type<double>(), {3});
+  TensorVar A("A", mat), dA("dA", mat), x("x", vec), b("b", vec);
+
+  Access Aex = A(i,j);
+  Access dAex = dA(i,j);
+  IndexExpr expr = Aex * x(j) - b(i);
+  IndexExpr delta = getDeltaExpr(expr, {{Aex, dAex}});
+  ASSERT_TRUE(isa<MulNode>(delta));
+  ASSERT_EQ(dAex, to<MulNode>(delta)->a);
+
+  ASSERT_FALSE(getDeltaExpr(b(i) + x(i), {{Aex, dAex}}).defined());
+  IndexExpr neg = getDeltaExpr(b(i) - Aex, {{Aex, dAex}});
+  ASSERT_TRUE(isa<NegNode>(neg));
+}
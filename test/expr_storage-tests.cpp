@@ -792,6 +792,42 @@ INSTANTIATE_TEST_CASE_P(spmv, expr,
                     },
                     {0,0,18}
                     ),
+           TestData(Tensor<double>("a",{3},Format({Dense})),
+                    {i},
+                    d33a("B",Format({Dense, Fixed}))(i,k) *
+                    d3b("c",Format({Sparse}))(k),
+                    {
+                      {
+                        // Dense index
+                        {3}
+                      },
+                    },
+                    {0,0,18}
+                    ),
+           TestData(Tensor<double>("a",{3},Format({Dense})),
+                    {i},
+                    d33a("B",DIA)(i,k) *
+                    d3b("c",Format({Dense}))(k),
+                    {
+                      {
+                        // Dense index
+                        {3}
+                      },
+                    },
+                    {0,0,18}
+                    ),
+           TestData(Tensor<double>("a",{3},Format({Dense})),
+                    {i},
+                    d33a("B",DIA)(i,k) *
+                    d3b("c",Format({Sparse}))(k),
+                    {
+                      {
+                        // Dense index
+                        {3}
+                      },
+                    },
+                    {0,0,18}
+                    ),
            TestData(Tensor<double>("a",{3},Format({Sparse})),
                     {i},
                     d33a("B",Format({Sparse, Sparse}))(i,k) *
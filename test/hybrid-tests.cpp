@@ -0,0 +1,135 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/hybrid.h"
+#include "taco/expr/expr_nodes.h"
+
+using namespace taco;
+
+static IndexVar i("i"), j("j");
+
+static Tensor<double> powerLawMatrix() {
+  Tensor<double> A("A", {5,6}, CSR);
+  A.insert({0,0}, 1.0);
+  A.insert({0,5}, 2.0);
+  A.insert({1,1}, 3.0);
+  A.insert({2,0}, 1.0);
+  A.insert({2,1}, 2.0);
+  A.insert({2,2}, 3.0);
+  A.insert({2,3}, 4.0);
+  A.insert({2,4}, 5.0);
+  A.insert({4,3}, 4.0);
+  A.insert({4,4}, 4.0);
+  A.pack();
+  return A;
+}
+
+TEST(hybrid, width) {
+  ASSERT_EQ(0, getHybridWidth({}));
+  ASSERT_EQ(0, getHybridWidth({0, 0, 0}));
+  ASSERT_EQ(2, getHybridWidth({2, 1, 5, 0, 2}));
+  ASSERT_EQ(1, getHybridWidth({1, 1, 1, 1, 1, 1, 1000}));
+  ASSERT_EQ(3, getHybridWidth({3, 3, 3}));
+}
+
+TEST(hybrid, split) {
+  HybridTensor H(powerLawMatrix());
+  ASSERT_EQ(2, H.getWidth());
+  ASSERT_EQ(ELL, H.getEll().getFormat());
+
+  Tensor<double> ell = iterate<double>(H.getEll());
+  ASSERT_STORAGE_EQUALS({{{5}},
+                         {{2}, {0, 5, 1, 1, 0, 1, 0, 0, 3, 4}}},
+                        {1, 2, 3, 0, 1, 2, 0, 0, 4, 4},
+                        ell);
+
+  // The padding of the empty row is not a stored component
+  for (auto& component : ell) {
+    ASSERT_NE(3, component.first[0]);
+  }
+
+  Tensor<double> coo = iterate<double>(H.getCoo());
+  ASSERT_STORAGE_EQUALS({{{0, 1}, {2}},
+                         {{0, 3}, {2, 3, 4}}},
+                        {3, 4, 5},
+                        coo);
+}
+
+TEST(hybrid, spmv) {
+  Tensor<double> A = powerLawMatrix();
+  Tensor<double> x("x", {6}, Format({Dense}));
+  for (int j = 0; j < 6; j++) {
+    x.insert({j}, (double)(j+1));
+  }
+  x.pack();
+
+  Tensor<double> expected("expected", {5}, Format({Dense}));
+  expected(i) = A(i,j) * x(j);
+  expected.evaluate();
+
+  HybridTensor H(A);
+  Tensor<double> y("y", {5}, Format({Dense}));
+  y(i) = H(i,j) * x(j);
+  H.fuse(y);
+  y.evaluate();
+  ASSERT_TENSOR_EQ(expected, y);
+}
+
+TEST(hybrid, fused_expr) {
+  HybridTensor H(powerLawMatrix());
+  Tensor<double> x("x", {6}, Format({Dense}));
+  Tensor<double> y("y", {5}, Format({Dense}));
+  y(i) = H(i,j) * x(j);
+  H.fuse(y);
+
+  // The tail term must be reduced over its own index variable
+  IndexExpr fused = y.getTensorVar().getIndexExpr();
+  ASSERT_TRUE(isa<AddNode>(fused));
+  auto ellTerm = to<MulNode>(to<AddNode>(fused)->a);
+  auto cooTerm = to<MulNode>(to<AddNode>(fused)->b);
+  ASSERT_EQ(H.getEll().getTensorVar(), to<AccessNode>(ellTerm->a)->tensorVar);
+  ASSERT_EQ(H.getCoo().getTensorVar(), to<AccessNode>(cooTerm->a)->tensorVar);
+  ASSERT_EQ(i, to<AccessNode>(cooTerm->a)->indexVars[0]);
+  ASSERT_FALSE(j == to<AccessNode>(cooTerm->a)->indexVars[1]);
+}
+
+TEST(hybrid, ell_padding) {
+  HybridTensor H(powerLawMatrix());
+  Tensor<double> ell = H.getEll();
+  Tensor<double> csr("csr", {5,6}, CSR);
+  for (auto& component : ell) {
+    csr.insert({component.first[0], component.first[1]}, component.second);
+  }
+  csr.pack();
+  Tensor<double> x("x", {6}, Format({Dense}));
+  for (int j = 0; j < 6; j++) {
+    x.insert({j}, (double)(j+1));
+  }
+  x.pack();
+
+  // The ELL SpMV loop sums the padding, so it needs no guard and vectorizes
+  Tensor<double> expected("expected", {5}, Format({Dense}));
+  expected(i) = csr(i,j) * x(j);
+  expected.evaluate();
+  Tensor<double> y("y", {5}, Format({Dense}));
+  y(i) = ell(i,j) * x(j);
+  y.compile();
+  ASSERT_NE(std::string::npos,
+            y.getSource().find("#pragma omp simd reduction(+:"));
+  y.assemble();
+  y.compute();
+  ASSERT_TENSOR_EQ(expected, y);
+
+  // Sums with the padding skip it, including the padding of the empty row
+  Tensor<double> B("B", {5,6}, CSR);
+  B.insert({3,2}, 1.0);
+  B.pack();
+  Tensor<double> sumExpected("sumExpected", {5,6}, CSR);
+  sumExpected(i,j) = csr(i,j) + B(i,j);
+  sumExpected.evaluate();
+  Tensor<double> sum("sum", {5,6}, CSR);
+  sum(i,j) = ell(i,j) + B(i,j);
+  sum.evaluate();
+  ASSERT_TENSOR_EQ(sumExpected, sum);
+}
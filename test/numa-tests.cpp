@@ -0,0 +1,103 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/storage/pack.h"
+#include "taco/storage/numa.h"
+#include "taco/storage/allocator.h"
+
+#if defined(TACO_LINUX)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+using namespace taco;
+using namespace taco::storage;
+
+TEST(numa, level_bounds) {
+  // 3x4 CSR matrix with rows of 2, 0 and 3 nonzeros
+  vector<vector<vector<int>>> indices = {{}, {{0,2,2,5}, {0,3,0,1,2}}};
+  auto bounds = getLevelBounds({3,4}, {Dense,Sparse}, indices);
+  ASSERT_EQ(2u, bounds.size());
+  ASSERT_VECTOR_EQ(vector<size_t>({0,1,2,3}), bounds[0]);
+  ASSERT_VECTOR_EQ(vector<size_t>({0,2,2,5}), bounds[1]);
+
+  // Dense 3x4 matrix
+  bounds = getLevelBounds({3,4}, {Dense,Dense}, {{}, {}});
+  ASSERT_VECTOR_EQ(vector<size_t>({0,4,8,12}), bounds[1]);
+}
+
+TEST(numa, allocate_placed) {
+  ASSERT_TRUE(getNumaPolicy() == NumaPolicy::Local);
+  vector<double> small = {1, 2, 3, 4, 5, 6, 7};
+  vector<double> large(NUMA_PLACEMENT_THRESHOLD / sizeof(double) + 1);
+  for (size_t i = 0; i < large.size(); i++) {
+    large[i] = (double)i;
+  }
+  for (auto policy : {NumaPolicy::Local, NumaPolicy::FirstTouch,
+                      NumaPolicy::Interleave, NumaPolicy::Bind}) {
+    setNumaPolicy(policy);
+    for (auto& values : {small, large}) {
+      vector<size_t> bounds = {1, 3, 3, values.size() - 1};
+      double* placed = (double*)allocatePlaced(values.data(), sizeof(double),
+                                               values.size(), bounds);
+      ASSERT_TRUE(isAligned(placed));
+      for (size_t i = 0; i < values.size(); i++) {
+        ASSERT_EQ(values[i], placed[i]);
+      }
+      deallocate(placed);
+    }
+  }
+  setNumaPolicy(NumaPolicy::Local);
+}
+
+TEST(numa, memory_policy) {
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  vector<double> values(NUMA_PLACEMENT_THRESHOLD / sizeof(double) + 1, 1.0);
+  for (auto policy : {NumaPolicy::Interleave, NumaPolicy::Bind}) {
+    setNumaPolicy(policy);
+    double* placed = (double*)allocatePlaced(values.data(), sizeof(double),
+                                             values.size(), {});
+    ASSERT_EQ(0u, (uintptr_t)placed % pageSize);
+#if defined(TACO_LINUX) && defined(SYS_get_mempolicy)
+    // Only checked where the kernel supports NUMA policies
+    int mode;
+    unsigned long nodemask = 0;
+    char* last = (char*)(placed + values.size()) - 1;
+    if (syscall(SYS_get_mempolicy, &mode, &nodemask, sizeof(nodemask) * 8,
+                last, MPOL_F_ADDR) == 0) {
+      ASSERT_EQ(policy == NumaPolicy::Bind ? MPOL_BIND : MPOL_INTERLEAVE,
+                mode);
+    }
+#endif
+    deallocate(placed);
+  }
+
+  // Placed arrays come from the tensor allocator, so a pool recycles them
+  auto pool = std::make_shared<PoolAllocator>();
+  setAllocator(pool);
+  for (int k = 0; k < 2; k++) {
+    double* placed = (double*)allocatePlaced(values.data(), sizeof(double),
+                                             values.size(), {});
+    ASSERT_EQ(0u, (uintptr_t)placed % pageSize);
+    deallocate(placed);
+  }
+  ASSERT_EQ(1u, pool->getNumReused());
+  setAllocator(std::make_shared<AlignedAllocator>());
+  setNumaPolicy(NumaPolicy::Local);
+}
+
+TEST(numa, pack) {
+  Tensor<double> expected = d33a("expected", Format({Dense, Sparse}));
+  expected.pack();
+
+  for (auto policy : {NumaPolicy::Local, NumaPolicy::Interleave,
+                      NumaPolicy::Bind}) {
+    setNumaPolicy(policy);
+    Tensor<double> A = d33a("A", Format({Dense, Sparse}));
+    A.pack();
+    ASSERT_TRUE(equals(expected, A));
+  }
+  setNumaPolicy(NumaPolicy::Local);
+}
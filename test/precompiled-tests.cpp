@@ -0,0 +1,114 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <sstream>
+
+#include "taco/tensor.h"
+#include "taco/precompiled.h"
+#include "taco/util/env.h"
+
+using namespace taco;
+
+TEST(precompiled, key) {
+  // Keys don't depend on the names of tensors and index variables
+  IndexVar i("i"), j("j"), k, l;
+  Tensor<double> A("A", {7,9}, CSR);
+  Tensor<double> x("x", {9}, Format({Dense}));
+  Tensor<double> y("y", {7}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  Tensor<double> B("B", {7,9}, CSR);
+  Tensor<double> z("z", {9}, Format({Dense}));
+  Tensor<double> w("w", {7}, Format({Dense}));
+  w(k) = B(k,l) * z(l);
+  ASSERT_EQ("t0(i0) = (t1(i0, i1) * t2(i1)); t0: double[7] (dense; 0); "
+            "t1: double[7, 9] (dense,sparse; 0,1); t2: double[9] (dense; 0)",
+            y.getKernelKey());
+  ASSERT_EQ(y.getKernelKey(), w.getKernelKey());
+
+  // but do on their formats, types and order, and on the kernel options
+  Tensor<double> v("v", {7}, Format({Sparse}));
+  v(k) = B(k,l) * z(l);
+  ASSERT_NE(y.getKernelKey(), v.getKernelKey());
+  Tensor<float> u("u", {7}, Format({Dense}));
+  u(k) = B(k,l) * z(l);
+  ASSERT_NE(y.getKernelKey(), u.getKernelKey());
+  Tensor<double> s("s", {7}, Format({Dense}));
+  s(k) = z(l) * B(k,l);
+  ASSERT_NE(y.getKernelKey(), s.getKernelKey());
+  ASSERT_NE(y.getKernelKey(), y.getKernelKey(true));
+}
+
+TEST(precompiled, library) {
+  Tensor<double> A("A", {7,9}, CSR);
+  Tensor<double> B("B", {7,9}, CSR);
+  Tensor<double> x("x", {9}, Format({Dense}));
+  for (int i = 0; i < 7; i++) {
+    A.insert({i,(2*i)%9}, i + 1.0);
+    A.insert({i,(5*i+1)%9}, 0.5);
+    B.insert({i,(2*i)%9}, 3.0);
+  }
+  for (int j = 0; j < 9; j++) {
+    x.insert({j}, j - 4.0);
+  }
+  A.pack();
+  B.pack();
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {7}, Format({Dense}));
+  y(i) = A(i,j) * x(j) - B(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> C("C", {7,9}, CSR);
+  C(i,j) = A(i,j) * B(i,j) + A(i,j);
+  C.evaluate();
+
+  // Build a library of both kernels and load it like a program that links it
+  string path = util::getTmpdir();
+  string prefix = "taco_precompiled_tests";
+  compileToStaticLibrary({y, C}, path, prefix);
+  ifstream headerFile(path + prefix + ".h");
+  stringstream header;
+  header << headerFile.rdbuf();
+  ASSERT_NE(string::npos, header.str().find("taco::registerKernels(\"" +
+                                            y.getKernelKey() + "\""));
+  string cc = util::getFromEnv("TACO_CC", "cc");
+  string cmd = cc + " -shared -o " + path + prefix + ".so -Wl,--whole-archive " +
+               path + prefix + ".a -Wl,--no-whole-archive";
+  ASSERT_EQ(0, system(cmd.data()));
+  void* library = dlopen((path + prefix + ".so").data(), RTLD_NOW|RTLD_LOCAL);
+  ASSERT_NE(nullptr, library);
+  auto getKernels = [&](string name) {
+    PrecompiledKernels kernels;
+    kernels.assemble = (int(*)(void**))dlsym(library,
+        ("_shim_" + prefix + "_" + name + "_assemble").data());
+    kernels.compute = (int(*)(void**))dlsym(library,
+        ("_shim_" + prefix + "_" + name + "_compute").data());
+    kernels.setParallel = (void(*)(int32_t,int32_t,int32_t,int32_t))dlsym(
+        library, (prefix + "_set_parallel").data());
+    return kernels;
+  };
+  registerKernels(y.getKernelKey(), getKernels("y"));
+  registerKernels(C.getKernelKey(), getKernels("C"));
+
+  // Tensors with the same expressions are bound to the library's kernels, so
+  // they are evaluated without a C compiler
+  string ccFromEnv = util::getFromEnv("TACO_CC", "");
+  setenv("TACO_CC", "/bin/false", 1);
+  IndexVar k, l;
+  Tensor<double> z("z", {7}, Format({Dense}));
+  z(k) = A(k,l) * x(l) - B(k,l) * x(l);
+  z.evaluate();
+  Tensor<double> D("D", {7,9}, CSR);
+  D(k,l) = A(k,l) * B(k,l) + A(k,l);
+  D.evaluate();
+  if (ccFromEnv.empty()) {
+    unsetenv("TACO_CC");
+  } else {
+    setenv("TACO_CC", ccFromEnv.data(), 1);
+  }
+  ASSERT_TRUE(equals(y, z));
+  ASSERT_TRUE(equals(C, D));
+}
@@ -0,0 +1,142 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include <algorithm>
+
+#include "taco/tensor.h"
+#include "taco/reorder.h"
+
+using namespace taco;
+
+static bool isPermutation(vector<int> permutation, int size) {
+  std::sort(permutation.begin(), permutation.end());
+  for (int i = 0; i < size; i++) {
+    if ((int)permutation.size() != size || permutation[i] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Returns the bandwidth of `P A P^T`.
+static int getBandwidth(const vector<pair<int,int>>& entries,
+                        const vector<int>& permutation) {
+  vector<int> inverse = invertPermutation(permutation);
+  int bandwidth = 0;
+  for (auto& entry : entries) {
+    bandwidth = std::max(bandwidth,
+                         std::abs(inverse[entry.first] - inverse[entry.second]));
+  }
+  return bandwidth;
+}
+
+// An 8-vertex path 0-7-1-6-2-5-3-4 whose natural numbering has a wide band
+static const vector<pair<int,int>> pathEntries = {
+  {0,7}, {7,1}, {1,6}, {6,2}, {2,5}, {5,3}, {3,4}
+};
+
+static Tensor<double> makeMatrix(string name,
+                                 const vector<pair<int,int>>& entries, int n) {
+  Tensor<double> A(name, {n,n}, CSR);
+  for (int i = 0; i < n; i++) {
+    A.insert({i,i}, 4.0);
+  }
+  for (auto& entry : entries) {
+    A.insert({entry.first, entry.second}, -1.0 - entry.first);
+  }
+  A.pack();
+  return A;
+}
+
+TEST(reorder, rcm) {
+  Tensor<double> A = makeMatrix("A", pathEntries, 8);
+  vector<int> ordering = getRCMOrdering(A);
+  ASSERT_TRUE(isPermutation(ordering, 8));
+  vector<int> identity = {0,1,2,3,4,5,6,7};
+  ASSERT_EQ(7, getBandwidth(pathEntries, identity));
+  ASSERT_EQ(1, getBandwidth(pathEntries, ordering));
+}
+
+TEST(reorder, bisection) {
+  Tensor<double> A = makeMatrix("A", pathEntries, 8);
+  vector<int> ordering = getBisectionOrdering(A, 2);
+  ASSERT_TRUE(isPermutation(ordering, 8));
+  // Each part of two vertices holds neighbors on the path
+  ASSERT_EQ(1, getBandwidth({{ordering[0],ordering[1]},
+                             {ordering[2],ordering[3]},
+                             {ordering[4],ordering[5]},
+                             {ordering[6],ordering[7]}}, ordering));
+}
+
+TEST(reorder, degree) {
+  Tensor<double> A("A", {4,4}, CSR);
+  A.insert({0,0}, 1.0);
+  A.insert({2,0}, 1.0);
+  A.insert({2,1}, 1.0);
+  A.insert({2,3}, 1.0);
+  A.insert({3,1}, 1.0);
+  A.insert({3,2}, 1.0);
+  A.pack();
+  ASSERT_VECTOR_EQ(vector<int>({2,3,0,1}), getDegreeOrdering(A));
+  ASSERT_VECTOR_EQ(vector<int>({1,0,3,2}), getDegreeOrdering(A, false));
+
+  Tensor<double> B("B", {4,4}, Format({Sparse,Sparse}));
+  B.insert({1,0}, 1.0);
+  B.insert({3,0}, 1.0);
+  B.insert({3,3}, 1.0);
+  B.pack();
+  ASSERT_VECTOR_EQ(vector<int>({3,1,0,2}), getDegreeOrdering(B));
+}
+
+TEST(reorder, permute) {
+  Tensor<double> A = makeMatrix("A", pathEntries, 8);
+  vector<int> p = getRCMOrdering(A);
+  vector<int> inverse = invertPermutation(p);
+
+  for (auto format : {CSR, CSC, Format({Dense,Dense}),
+                      Format({Sparse,Sparse})}) {
+    Tensor<double> B("B", {8,8}, format);
+    for (auto& value : A) {
+      B.insert(value.first, value.second);
+    }
+    B.pack();
+
+    Tensor<double> expected("expected", {8,8}, format);
+    for (auto& value : A) {
+      expected.insert({inverse[value.first[0]], inverse[value.first[1]]},
+                      value.second);
+    }
+    expected.pack();
+    Tensor<double> permuted = permute(B, {p,p});
+    ASSERT_TRUE(equals(expected, permuted));
+    ASSERT_TRUE(equals(B, permute(permuted, {inverse,inverse})));
+  }
+}
+
+TEST(reorder, spmv) {
+  Tensor<double> A = makeMatrix("A", pathEntries, 8);
+  Tensor<double> x("x", {8}, Format({Dense}));
+  for (int i = 0; i < 8; i++) {
+    x.insert({i}, (double)i + 1);
+  }
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {8}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+
+  vector<int> p = getRCMOrdering(A);
+  Tensor<double> Ap = permute(A, {p,p});
+  Tensor<double> xp = permute(x, {p});
+  Tensor<double> yp("yp", {8}, Format({Dense}));
+  yp(i) = Ap(i,j) * xp(j);
+  yp.evaluate();
+  ASSERT_TRUE(equals(y, permute(yp, {invertPermutation(p)})));
+}
+
+TEST(reorder, unpacked) {
+  Tensor<double> A("A", {3,3}, CSR);
+  A.insert({0,1}, 1.0);
+  ASSERT_DEATH(getRCMOrdering(A), "must be packed");
+}
@@ -0,0 +1,128 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/hybrid.h"
+#include "taco/statistics.h"
+
+using namespace taco;
+
+TEST(statistics, matrix) {
+  // 6x6 matrix with rows of 2, 0, 1, 3, 0 and 1 nonzeros
+  Tensor<double> A("A", {6,6}, CSR);
+  A.insert({0,0}, 1.0);
+  A.insert({0,1}, 2.0);
+  A.insert({2,5}, 3.0);
+  A.insert({3,0}, 4.0);
+  A.insert({3,2}, 5.0);
+  A.insert({3,3}, 6.0);
+  A.insert({5,4}, 7.0);
+  A.pack();
+
+  SparsityStatistics stats = getStatistics(A, 2);
+  ASSERT_EQ(7u, stats.nnz);
+  ASSERT_VECTOR_EQ(vector<int>({2,0,1,3,0,1}), stats.sliceSizes);
+  ASSERT_VECTOR_EQ(vector<int>({2,2,1,1}), stats.sliceHistogram);
+  ASSERT_EQ(4, stats.numNonemptySlices);
+  ASSERT_EQ(3, stats.maxSliceSize);
+  ASSERT_EQ(3, stats.lowerBandwidth);
+  ASSERT_EQ(3, stats.upperBandwidth);
+  ASSERT_VECTOR_EQ(vector<int>({-3,-1,0,1,3}), stats.diagonals);
+  // Blocks (0,0), (1,2), (1,0), (1,1) and (2,2)
+  ASSERT_EQ(5u, stats.numBlocks);
+  ASSERT_DOUBLE_EQ(7.0 / 20.0, stats.getBlockDensity());
+  ASSERT_DOUBLE_EQ(7.0 / 36.0, stats.getDensity());
+}
+
+TEST(statistics, coordinates) {
+  SparsityStatistics stats = getStatistics({3,4,5},
+                                           {{0,1,2}, {2,3,4}, {0,1,2}, {0,0,0}});
+  ASSERT_EQ(3u, stats.nnz);
+  ASSERT_VECTOR_EQ(vector<int>({2,0,1}), stats.sliceSizes);
+  ASSERT_TRUE(stats.diagonals.empty());
+  ASSERT_TRUE(getCandidateFormats(stats)[0] ==
+              Format({Dense,Sparse,Sparse}));
+}
+
+TEST(statistics, advise) {
+  const int n = 64;
+  vector<vector<int>> tridiagonal, hypersparse, regular, irregular, dense;
+  for (int i = 0; i < n; i++) {
+    for (int j = std::max(0, i-1); j <= std::min(n-1, i+1); j++) {
+      tridiagonal.push_back({i,j});
+    }
+    if (i % 8 == 0) {
+      hypersparse.push_back({i,(i*7) % n});
+    }
+    for (int k = 0; k < 4; k++) {
+      regular.push_back({i,(i*13 + k*17) % n});
+    }
+    irregular.push_back({i,(i*5) % n});
+    for (int j = 0; j < n/2; j++) {
+      dense.push_back({i,j});
+    }
+  }
+  for (int j = 0; j < n; j++) {
+    irregular.push_back({0,j});
+  }
+
+  ASSERT_TRUE(adviseFormat(getStatistics({n,n}, tridiagonal)) == DIA);
+  ASSERT_TRUE(adviseFormat(getStatistics({n,n}, hypersparse)) == DCSR);
+  ASSERT_TRUE(adviseFormat(getStatistics({n,n}, regular)) == ELL);
+  ASSERT_TRUE(adviseFormat(getStatistics({n,n}, irregular)) == CSR);
+  ASSERT_TRUE(adviseFormat(getStatistics({n,n}, dense)) ==
+              Format({Dense,Dense}));
+}
+
+TEST(statistics, advise_outer_product) {
+  Tensor<double> a("a", {64}, Format({Sparse}));
+  Tensor<double> b("b", {64}, Format({Sparse}));
+  a.insert({1}, 1.0);
+  a.insert({5}, 2.0);
+  b.insert({0}, 3.0);
+  b.insert({2}, 4.0);
+  b.insert({7}, 5.0);
+  a.pack();
+  b.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> C("C", {64,64}, CSR);
+  C(i,j) = a(i) * b(j);
+
+  // At most 2*3 nonzeros, rounded up to a power of two
+  FormatAdvice advice = adviseFormats(C);
+  ASSERT_EQ(8u, advice.allocSize);
+}
+
+TEST(statistics, advise_expression) {
+  Tensor<double> A("A", {64,64}, CSR);
+  Tensor<double> x("x", {64}, Format({Dense}));
+  for (int i = 0; i < 64; i++) {
+    for (int j = std::max(0, i-1); j <= std::min(63, i+1); j++) {
+      A.insert({i,j}, 1.0 + i);
+    }
+    x.insert({i}, 2.0);
+  }
+  A.pack();
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {64}, Format({Sparse}));
+  y(i) = A(i,j) * x(j);
+
+  FormatAdvice advice = adviseFormats(y);
+  ASSERT_EQ(2u, advice.operands.size());
+  ASSERT_TRUE(advice.operands[0] == A);
+  ASSERT_TRUE(advice.formats[0] == DIA);
+  ASSERT_TRUE(advice.formats[1] == Format({Dense}));
+  // At most 64 nonzeros, the size of y
+  ASSERT_EQ(64u, advice.allocSize);
+
+  advice = adviseFormats(y, true, 1);
+  ASSERT_EQ(2u, advice.formats.size());
+  for (size_t k = 0; k < advice.formats.size(); k++) {
+    ASSERT_TRUE(util::contains(
+        getCandidateFormats(getStatistics(advice.operands[k])),
+        advice.formats[k]));
+  }
+}
@@ -19,6 +19,7 @@ using taco::Format;
 const auto Dense  = taco::ModeType::Dense;
 const auto Sparse = taco::ModeType::Sparse;
 const auto Fixed  = taco::ModeType::Fixed;
+const auto Diagonal = taco::ModeType::Diagonal;
 
 struct TestData {
   TestData(Tensor<double> tensor,
@@ -220,6 +221,22 @@ INSTANTIATE_TEST_CASE_P(fixed, storage,
                  },
                  {2, 0, 0, 0, 3, 4}
         ),
+        TestData(d33a("A", Format({Dense,Diagonal})),  // DIA
+                 {
+                     {
+                         // Dense index
+                         {3}
+                     },
+                     {
+                         // Diagonal index
+                         {3, 3},
+                         {-2, 0, 1},
+                     }
+                 },
+                 {0, 0, 3,
+                  0, 0, 4,
+                  2, 0, 0}
+        ),
         TestData(d33a("A", Format({Fixed,Dense})),
                  {
                      {
@@ -0,0 +1,136 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/target.h"
+#include "taco/util/strings.h"
+#include "codegen/codegen_llvm.h"
+
+using namespace taco;
+
+TEST(target, parse) {
+  Target avx2("c99-linux-avx2");
+  ASSERT_EQ(Target::C99, avx2.arch);
+  ASSERT_EQ(Target::Linux, avx2.os);
+  ASSERT_EQ(Target::AVX2, avx2.isa);
+  ASSERT_FALSE(avx2.multiversion);
+  ASSERT_EQ("-march=haswell -mtune=haswell", avx2.getCompilerFlags());
+  ASSERT_EQ("c99-linux-avx2", util::toString(avx2));
+
+  Target avx512("c99-linux-avx512");
+  ASSERT_EQ(512, avx512.getVectorWidth());
+  ASSERT_EQ("-march=skylake-avx512 -mtune=skylake-avx512 "
+            "-mprefer-vector-width=512", avx512.getCompilerFlags());
+
+  // Multiversioned and generic targets build for any machine
+  Target portable("c99-macos-avx512-multiversion");
+  ASSERT_EQ(Target::MacOS, portable.os);
+  ASSERT_TRUE(portable.multiversion);
+  ASSERT_EQ("", portable.getCompilerFlags());
+  ASSERT_EQ("c99-macos-avx512-multiversion", util::toString(portable));
+  ASSERT_EQ("", Target("c99-linux").getCompilerFlags());
+}
+
+TEST(target, host) {
+  Target::ISA isa = getHostISA();
+#if defined(__GNUC__) && defined(__x86_64__)
+  __builtin_cpu_init();
+  ASSERT_EQ(isa >= Target::AVX2, __builtin_cpu_supports("avx2") &&
+                                 __builtin_cpu_supports("fma"));
+  ASSERT_TRUE(isa < Target::AVX512 || __builtin_cpu_supports("avx512f"));
+#endif
+  ASSERT_EQ(isa, getTargetFromEnvironment().isa);
+
+  // Ahead of time builds must not depend on the host's instruction set
+  Target portable = getPortableTarget();
+  ASSERT_EQ(Target::ISAGeneric, portable.isa);
+  ASSERT_TRUE(portable.multiversion);
+  ASSERT_EQ("", portable.getCompilerFlags());
+}
+
+TEST(target, kernels) {
+  Tensor<double> A("A", {8,8}, CSR);
+  Tensor<double> x("x", {8}, Format({Dense}));
+  Tensor<double> expected("expected", {8}, Format({Dense}));
+  for (int i = 0; i < 8; i++) {
+    A.insert({i,i}, (double)i);
+    A.insert({i,(i+3)%8}, 1.0);
+    x.insert({i}, (double)i + 1);
+  }
+  A.pack();
+  x.pack();
+  for (int i = 0; i < 8; i++) {
+    expected.insert({i}, i * (i + 1.0) + (i + 3) % 8 + 1.0);
+  }
+  expected.pack();
+
+  // The kernels record the target and compiler flags they are built for
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {8}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_NE(std::string::npos, y.getSource().find(
+      "// Target: " + util::toString(getTargetFromEnvironment())));
+  ASSERT_TRUE(equals(expected, y));
+
+  // Multiversioned kernels are cloned for several instruction sets
+  Tensor<double> z("z", {8}, Format({Dense}));
+  z.setTarget(Target(Target::C99, Target::Linux, Target::AVX512, true));
+  z(i) = A(i,j) * x(j);
+  z.evaluate();
+  ASSERT_NE(std::string::npos, z.getSource().find("TACO_TARGET_CLONES\nint "));
+  ASSERT_TRUE(equals(expected, z));
+}
+
+TEST(target, llvm) {
+  if (!ir::CodeGen_LLVM::isAvailable()) {
+    return;
+  }
+  Tensor<double> A("A", {10,12}, CSR);
+  Tensor<double> B("B", {10,12}, CSR);
+  Tensor<double> x("x", {12}, Format({Dense}));
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 12; j++) {
+      if ((i * j) % 5 == 1) A.insert({i,j}, i + 0.5 * j);
+      if ((i + j) % 3 == 0) B.insert({i,j}, 1.0 + j);
+    }
+  }
+  for (int j = 0; j < 12; j++) {
+    x.insert({j}, j * 0.25);
+  }
+  A.pack();
+  B.pack();
+  x.pack();
+
+  // Kernels compiled in memory compute the same results as compiled C
+  Target jit("x86-linux");
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {10}, Format({Dense}));
+  Tensor<double> yExpected("yExpected", {10}, Format({Dense}));
+  y.setTarget(jit);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  yExpected(i) = A(i,j) * x(j);
+  yExpected.evaluate();
+  ASSERT_NE(std::string::npos, y.getSource().find("define i32 @compute("));
+  ASSERT_TRUE(equals(yExpected, y));
+
+  // Sparse results are assembled with the allocator of the process
+  Tensor<double> C("C", {10,12}, CSR);
+  Tensor<double> CExpected("CExpected", {10,12}, CSR);
+  C.setTarget(jit);
+  C(i,j) = A(i,j) + B(i,j);
+  C.evaluate();
+  CExpected(i,j) = A(i,j) + B(i,j);
+  CExpected.evaluate();
+  ASSERT_TRUE(equals(CExpected, C));
+
+  Tensor<double> s("s");
+  Tensor<double> sExpected("sExpected");
+  s.setTarget(jit);
+  s() = A(i,j) * B(i,j);
+  s.evaluate();
+  sExpected() = A(i,j) * B(i,j);
+  sExpected.evaluate();
+  ASSERT_TRUE(equals(sExpected, s));
+}
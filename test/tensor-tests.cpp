@@ -2,7 +2,10 @@
 #include "taco/tensor.h"
 
 #include <vector>
+#include <set>
+#include <dirent.h>
 #include "taco/util/collections.h"
+#include "taco/util/env.h"
 
 using namespace taco;
 
@@ -62,3 +65,835 @@ TEST(tensor, duplicates) {
     ASSERT_EQ(vals.at(val.first), val.second);
   }
 }
+
+TEST(tensor, pattern) {
+  Tensor<bool> a({5,5}, Format({Dense,Sparse}));
+  a.insert({1,2}, true);
+  a.insert({3,0}, true);
+  a.insert({1,2}, true);
+  a.pack();
+  ASSERT_EQ(nullptr, a.getStorage().getValues().getData());
+  ASSERT_EQ(0u, a.getStorage().getValues().getSize());
+
+  set<vector<int>> coords = {{1,2}, {3,0}};
+  size_t numCoords = 0;
+  for (auto& val : a) {
+    ASSERT_TRUE(util::contains(coords, val.first));
+    ASSERT_TRUE(val.second);
+    numCoords++;
+  }
+  ASSERT_EQ(coords.size(), numCoords);
+}
+
+TEST(tensor, recompute) {
+  IndexVar i("i"), j("j");
+  Tensor<double> B("B", {3,3}, Format({Dense,Sparse}));
+  Tensor<double> C("C", {3,3}, Format({Dense,Sparse}));
+  B.insert({0,1}, 1.0);
+  B.insert({2,2}, 2.0);
+  C.insert({0,0}, 3.0);
+  C.insert({2,2}, 4.0);
+  B.pack();
+  C.pack();
+
+  Tensor<double> A("A", {3,3}, Format({Dense,Sparse}));
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  uint64_t fingerprint = A.getStorage().getFingerprint();
+
+  // New values with the same pattern reuse the assembled index
+  ((double*)B.getStorage().getValues().getData())[1] = 5.0;
+  A.recompute();
+  ASSERT_EQ(fingerprint, A.getStorage().getFingerprint());
+
+  Tensor<double> expected("expected", {3,3}, Format({Dense,Sparse}));
+  expected.insert({0,0}, 3.0);
+  expected.insert({0,1}, 1.0);
+  expected.insert({2,2}, 9.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, A));
+
+  // A new pattern is reassembled
+  B.insert({1,0}, 6.0);
+  B.pack();
+  A.recompute();
+  ASSERT_NE(fingerprint, A.getStorage().getFingerprint());
+
+  expected.insert({0,0}, 3.0);
+  expected.insert({1,0}, 6.0);
+  expected.insert({2,2}, 4.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, A));
+}
+
+TEST(tensor, duplicates_unordered) {
+  Tensor<double> a({5,5}, Sparse);
+  a.insert({2,2}, 10.0);
+  a.insert({1,2}, 42.0);
+  a.insert({2,2}, 1.0);
+  a.pack();
+  map<vector<int>,double> vals = {{{1,2}, 42.0}, {{2,2}, 11.0}};
+  size_t numVals = 0;
+  for (auto& val : a) {
+    ASSERT_TRUE(util::contains(vals, val.first));
+    ASSERT_EQ(vals.at(val.first), val.second);
+    numVals++;
+  }
+  ASSERT_EQ(vals.size(), numVals);
+}
+
+TEST(tensor, merge) {
+  for (auto format : {Format({Dense,Sparse}), Format({Sparse,Sparse}),
+                      Format({Dense,Sparse}, {1,0}), Format({Dense,Dense})}) {
+    Tensor<double> a({4,5}, format);
+    a.insert({0,1}, 1.0);
+    a.insert({2,0}, 2.0);
+    a.insert({2,4}, 3.0);
+    a.pack();
+
+    a.insert({2,4}, 4.0);
+    a.insert({3,3}, 5.0);
+    a.insert({0,0}, 6.0);
+    a.insert({2,2}, 7.0);
+    a.merge();
+
+    Tensor<double> expected({4,5}, format);
+    expected.insert({0,0}, 6.0);
+    expected.insert({0,1}, 1.0);
+    expected.insert({2,0}, 2.0);
+    expected.insert({2,2}, 7.0);
+    expected.insert({2,4}, 7.0);
+    expected.insert({3,3}, 5.0);
+    expected.pack();
+    ASSERT_TRUE(equals(expected, a)) << format;
+  }
+}
+
+TEST(tensor, merge_async) {
+  Tensor<double> a({3,3,3}, Format({Sparse,Dense,Sparse}));
+  a.merge();
+  a.insert({1,1,1}, 1.0);
+  a.merge();
+  a.insert({0,2,1}, 2.0);
+  a.insert({1,1,0}, 3.0);
+  a.mergeAsync();
+  a.insert({2,0,2}, 4.0);
+  a.insert({1,1,1}, 5.0);
+  a.mergeAsync();
+
+  Tensor<double> expected({3,3,3}, Format({Sparse,Dense,Sparse}));
+  expected.insert({0,2,1}, 2.0);
+  expected.insert({1,1,0}, 3.0);
+  expected.insert({1,1,1}, 6.0);
+  expected.insert({2,0,2}, 4.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, a));
+}
+
+TEST(tensor, apply_delta) {
+  IndexVar i("i"), j("j"), k("k");
+  Tensor<double> A("A", {3,3}, Format({Dense,Sparse}));
+  Tensor<double> B("B", {3,3}, Format({Dense,Sparse}));
+  Tensor<double> x("x", {3}, Format({Dense}));
+  Tensor<double> b("b", {3}, Format({Dense}));
+  A.insert({0,0}, 1.0);
+  A.insert({1,2}, 2.0);
+  B.insert({0,1}, 3.0);
+  B.insert({2,0}, 4.0);
+  B.insert({2,2}, 5.0);
+  x.insert({0}, 1.0);
+  x.insert({1}, 2.0);
+  x.insert({2}, 3.0);
+  b.insert({1}, 10.0);
+  A.pack();
+  B.pack();
+  x.pack();
+  b.pack();
+
+  Tensor<double> y("y", {3}, Format({Dense}));
+  y(i) = A(i,j) * x(j) + b(i);
+  Tensor<double> C("C", {3,3}, Format({Dense,Dense}));
+  C(i,j) = A(i,k) * B(k,j);
+  Tensor<double> S("S", {3,3}, Format({Dense,Sparse}));
+  S(i,j) = A(i,j) * x(j);
+  for (auto& result : {y, C, S}) {
+    TensorBase tensor = result;
+    tensor.evaluate();
+  }
+
+  // Changes one component and adds two
+  Tensor<double> dA("dA", {3,3}, Format({Sparse,Sparse}));
+  dA.insert({1,2}, -1.0);
+  dA.insert({2,2}, 1.0);
+  dA.insert({0,2}, 2.0);
+  dA.pack();
+  y.applyDelta(A, dA);
+  C.applyDelta(A, dA);
+  S.applyDelta(A, dA);
+
+  Tensor<double> A2("A2", {3,3}, Format({Dense,Sparse}));
+  A2.insert({0,0}, 1.0);
+  A2.insert({0,2}, 2.0);
+  A2.insert({1,2}, 1.0);
+  A2.insert({2,2}, 1.0);
+  A2.pack();
+  Tensor<double> yExpected("yExpected", {3}, Format({Dense}));
+  yExpected(i) = A2(i,j) * x(j) + b(i);
+  Tensor<double> CExpected("CExpected", {3,3}, Format({Dense,Dense}));
+  CExpected(i,j) = A2(i,k) * B(k,j);
+  Tensor<double> SExpected("SExpected", {3,3}, Format({Dense,Sparse}));
+  SExpected(i,j) = A2(i,j) * x(j);
+  for (auto& result : {yExpected, CExpected, SExpected}) {
+    TensorBase tensor = result;
+    tensor.evaluate();
+  }
+  ASSERT_TRUE(equals(yExpected, y));
+  ASSERT_TRUE(equals(CExpected, C));
+  ASSERT_TRUE(equals(SExpected, S));
+
+  // The compiled delta kernel is reused
+  y.applyDelta(A, dA);
+  ASSERT_DOUBLE_EQ(13.0, y.begin()->second);
+}
+
+TEST(tensor, parallel_assembly) {
+  Tensor<double> B("B", {40,30}, Format({Dense,Sparse}));
+  Tensor<double> C("C", {40,30}, Format({Dense,Sparse}));
+  for (int i = 0; i < 40; i++) {
+    for (int j = 0; j < 30; j++) {
+      if ((i*7 + j*3) % 5 == 0) B.insert({i,j}, (double)i + j);
+      if ((i*3 + j) % 7 == 0 && i % 4 != 0) C.insert({i,j}, (double)i - j);
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> expected("expected", {40,30}, Format({Dense,Sparse}));
+  expected.setParallelAssembly(false);
+  expected(i,j) = B(i,j) + C(i,j);
+  expected.evaluate();
+  ASSERT_NE(std::string::npos, expected.getSource().find("init_alloc_size"));
+
+  // Rows are counted and filled by parallel loops, without growing arrays
+  const char* cflags = getenv("TACO_CFLAGS");
+  for (auto flags : {"-O3 -std=c99", "-O3 -std=c99 -fopenmp"}) {
+    setenv("TACO_CFLAGS", flags, 1);
+    for (bool assembleWhileCompute : {false, true}) {
+      Tensor<double> A("A", {40,30}, Format({Dense,Sparse}));
+      A.setParallelAssembly(true);
+      A(i,j) = B(i,j) + C(i,j);
+      A.compile(assembleWhileCompute);
+      A.assemble();
+      A.compute();
+      ASSERT_EQ(std::string::npos, A.getSource().find("init_alloc_size"));
+      ASSERT_NE(std::string::npos,
+                A.getSource().find("#pragma omp parallel for"));
+      ASSERT_TRUE(equals(expected, A));
+    }
+  }
+  if (cflags != nullptr) {
+    setenv("TACO_CFLAGS", cflags, 1);
+  }
+  else {
+    unsetenv("TACO_CFLAGS");
+  }
+
+  // Segments of the last mode below several dense modes
+  Tensor<double> D("D", {4,5,6}, Format({Dense,Dense,Sparse}));
+  Tensor<double> E("E", {4,5,6}, Format({Dense,Dense,Sparse}));
+  Tensor<double> F("F", {4,5,6}, Format({Dense,Dense,Sparse}));
+  Tensor<double> FExpected("FExpected", {4,5,6}, Format({Dense,Sparse,Sparse}));
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 5; j++) {
+      D.insert({i,j,(i+j) % 6}, 1.0);
+      E.insert({i,j,(i*j) % 6}, 2.0);
+    }
+  }
+  D.pack();
+  E.pack();
+  IndexVar k("k");
+  F(i,j,k) = D(i,j,k) * E(i,j,k);
+  F.evaluate();
+  FExpected(i,j,k) = D(i,j,k) * E(i,j,k);
+  FExpected.evaluate();
+  ASSERT_TRUE(equals(FExpected, F));
+}
+
+TEST(tensor, parallel_reduction) {
+  IndexVar i("i"), j("j");
+  Tensor<double> b("b", {100}, Format({Dense}));
+  Tensor<double> c("c", {100}, Format({Sparse}));
+  Tensor<double> A("A", {20,100}, CSR);
+  Tensor<double> L("L", {20,40000}, CSR);
+  double dot = 0.0;
+  for (int k = 0; k < 100; k++) {
+    b.insert({k}, (double)k);
+    if (k % 3 == 0) {
+      c.insert({k}, 2.0);
+      dot += 2.0 * k;
+    }
+  }
+  for (int k = 0; k < 20; k++) {
+    for (int l = 0; l < 100; l += 7) {
+      A.insert({k,(k+l) % 100}, 1.0);
+      L.insert({k,(k*997+l*131) % 40000}, 1.0);
+    }
+  }
+  b.pack();
+  c.pack();
+  A.pack();
+  L.pack();
+
+  Tensor<double> x("x", {20}, Format({Dense}));
+  for (int k = 0; k < 20; k++) {
+    x.insert({k}, (double)k + 1);
+  }
+  x.pack();
+
+  // The transposed products, with the scaled rows summed up serially
+  std::vector<double> yValues(100), zValues(40000);
+  for (int k = 0; k < 20; k++) {
+    for (int l = 0; l < 100; l += 7) {
+      yValues[(k+l) % 100] += k + 1;
+      zValues[(k*997+l*131) % 40000] += k + 1;
+    }
+  }
+  Tensor<double> yExpected("yExpected", {100}, Format({Dense}));
+  Tensor<double> zExpected("zExpected", {40000}, Format({Dense}));
+  for (int l = 0; l < 100; l++) {
+    yExpected.insert({l}, yValues[l]);
+  }
+  for (int l = 0; l < 40000; l++) {
+    zExpected.insert({l}, zValues[l]);
+  }
+  yExpected.pack();
+  zExpected.pack();
+
+  // The choice between private copies and atomics depends on the threads,
+  // which lowering reads from OMP_NUM_THREADS. The OpenMP runtime only reads
+  // it at startup, so the kernels get their threads from ParallelOptions.
+  const char* cflags = getenv("TACO_CFLAGS");
+  const char* numThreads = getenv("OMP_NUM_THREADS");
+  setenv("OMP_NUM_THREADS", "2", 1);
+  ParallelOptions options;
+  options.numThreads = 2;
+  for (auto flags : {"-O3 -std=c99", "-O3 -std=c99 -fopenmp"}) {
+    setenv("TACO_CFLAGS", flags, 1);
+
+    // Dot products sum into a private temporary per thread
+    Tensor<double> a("a");
+    a = b(i) * c(i);
+    a.setParallelOptions(options);
+    a.evaluate();
+    ASSERT_NE(std::string::npos, a.getSource().find("reduction(+:"));
+    ASSERT_EQ(dot, a.begin()->second);
+
+    // Small results are privatized per thread, large ones updated atomically
+    Tensor<double> y("y", {100}, Format({Dense}));
+    y(j) = A(i,j) * x(i);
+    y.setParallelOptions(options);
+    y.evaluate();
+    ASSERT_NE(std::string::npos, y.getSource().find("reduction(+:y_vals[0:"));
+    ASSERT_TRUE(equals(yExpected, y));
+
+    Tensor<double> z("z", {40000}, Format({Dense}));
+    z(j) = L(i,j) * x(i);
+    z.setParallelOptions(options);
+    z.evaluate();
+    ASSERT_NE(std::string::npos, z.getSource().find("#pragma omp atomic"));
+    ASSERT_TRUE(equals(zExpected, z));
+  }
+  if (cflags != nullptr) {
+    setenv("TACO_CFLAGS", cflags, 1);
+  }
+  else {
+    unsetenv("TACO_CFLAGS");
+  }
+  if (numThreads != nullptr) {
+    setenv("OMP_NUM_THREADS", numThreads, 1);
+  }
+  else {
+    unsetenv("OMP_NUM_THREADS");
+  }
+}
+
+TEST(tensor, nonzero_balancing) {
+  // A matrix with a few long rows, some empty rows and a dense last row
+  Tensor<double> A("A", {50,60}, CSR);
+  Tensor<double> x("x", {60}, Format({Dense}));
+  for (int j = 0; j < 60; j++) {
+    A.insert({3,j}, 1.0);
+    A.insert({49,j}, 2.0);
+    if (j % 2 == 0) A.insert({17,j}, (double)j);
+    x.insert({j}, (double)j + 1);
+  }
+  for (int i = 0; i < 50; i += 5) {
+    A.insert({i,(i*7) % 60}, 3.0);
+  }
+  A.pack();
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> expected("expected", {50}, Format({Dense}));
+  expected(i) = A(i,j) * x(j);
+  expected.evaluate();
+
+  // The partitions are computed when the kernel runs, for the threads it
+  // runs with
+  const char* cflags = getenv("TACO_CFLAGS");
+  setenv("TACO_CFLAGS", "-O3 -std=c99 -fopenmp", 1);
+  Tensor<double> y("y", {50}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.setNonzeroBalancing(true);
+  y.compile();
+  y.assemble();
+  ASSERT_NE(std::string::npos, y.getSource().find("taco_get_num_threads()"));
+  for (int threads : {1, 3, 7, 200}) {
+    ParallelOptions options;
+    options.numThreads = threads;
+    y.compute(options);
+    ASSERT_TRUE(equals(expected, y));
+  }
+  if (cflags != nullptr) {
+    setenv("TACO_CFLAGS", cflags, 1);
+  }
+  else {
+    unsetenv("TACO_CFLAGS");
+  }
+}
+
+TEST(tensor, parallel_options) {
+  Tensor<double> A("A", {40,40}, Format({Sparse,Sparse}));
+  Tensor<double> x("x", {40}, Format({Dense}));
+  for (int i = 0; i < 40; i++) {
+    for (int j = 0; j < 40; j += 1 + i % 7) {
+      A.insert({i,j}, (double)i + j);
+    }
+    x.insert({i}, (double)i);
+  }
+  A.pack();
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> expected("expected", {40}, Format({Dense}));
+  expected(i) = A(i,j) * x(j);
+  expected.evaluate();
+
+  const char* cflags = getenv("TACO_CFLAGS");
+  setenv("TACO_CFLAGS", "-O3 -std=c99 -fopenmp", 1);
+  Tensor<double> y("y", {40}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.compile();
+  y.assemble();
+  ASSERT_NE(std::string::npos, y.getSource().find("schedule(runtime)"));
+
+  // The chunk size of a dynamic schedule is tuned over the first computes
+  ParallelOptions options;
+  options.numThreads = 3;
+  options.schedule = ParallelSchedule::Dynamic;
+  for (int k = 0; k < 100 && y.getTunedChunkSize() == 0; k++) {
+    y.compute(options);
+    ASSERT_TRUE(equals(expected, y));
+  }
+  ASSERT_NE(0, y.getTunedChunkSize());
+
+  options.numThreads = 2;
+  options.schedule = ParallelSchedule::Guided;
+  options.chunkSize = 3;
+  y.compute(options);
+  ASSERT_TRUE(equals(expected, y));
+  ASSERT_EQ(0, y.getTunedChunkSize());
+
+  options.parallelize = false;
+  y.compute(options);
+  ASSERT_TRUE(equals(expected, y));
+  ASSERT_FALSE(y.getParallelOptions().parallelize);
+
+  if (cflags != nullptr) {
+    setenv("TACO_CFLAGS", cflags, 1);
+  }
+  else {
+    unsetenv("TACO_CFLAGS");
+  }
+}
+
+TEST(tensor, autotuning) {
+  Tensor<double> A("A", {30,40}, CSR);
+  Tensor<double> x("x", {40}, Format({Dense}));
+  for (int i = 0; i < 30; i++) {
+    for (int j = 0; j < 40; j++) {
+      if ((i * j) % 7 == 1 || (i < 3 && j % 2 == 0)) A.insert({i,j}, i + 1.0);
+    }
+  }
+  for (int j = 0; j < 40; j++) {
+    x.insert({j}, j - 20.0);
+  }
+  A.pack();
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> yExpected("yExpected", {30}, Format({Dense}));
+  yExpected(i) = A(i,j) * x(j);
+  yExpected.evaluate();
+
+  // The first computes time each variant and give the same results
+  Tensor<double> y("y", {30}, Format({Dense}));
+  y.setAutotuning(true);
+  y(i) = A(i,j) * x(j);
+  y.compile();
+  y.assemble();
+  KernelVariant variant;
+  ASSERT_FALSE(y.getTunedVariant(&variant));
+  for (int k = 0; k < 100 && !y.getTunedVariant(&variant); k++) {
+    y.compute();
+    ASSERT_TRUE(equals(yExpected, y));
+  }
+  ASSERT_TRUE(y.getTunedVariant(&variant));
+  y.compute();
+  ASSERT_TRUE(equals(yExpected, y));
+
+  // Later compiles of the same kernels reuse the tuned variant
+  IndexVar k, l;
+  Tensor<double> z("z", {30}, Format({Dense}));
+  z.setAutotuning(true);
+  z(k) = A(k,l) * x(l);
+  z.compile();
+  KernelVariant reused;
+  ASSERT_TRUE(z.getTunedVariant(&reused));
+  ASSERT_EQ(variant.nonzeroBalancing, reused.nonzeroBalancing);
+  ASSERT_EQ(variant.simdIntrinsics, reused.simdIntrinsics);
+  ASSERT_EQ(variant.schedule, reused.schedule);
+  ASSERT_EQ(variant.chunkSize, reused.chunkSize);
+  z.assemble();
+  z.compute();
+  ASSERT_TRUE(equals(yExpected, z));
+  ASSERT_FALSE(yExpected.getTunedVariant(&variant));
+}
+
+TEST(tensor, vectorize) {
+  Tensor<double> A("A", {10,20}, CSR);
+  Tensor<double> B("B", {10,20}, Format({Dense,Dense}));
+  Tensor<double> x("x", {20}, Format({Dense}));
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 20; j++) {
+      if ((i + j) % 3 == 0) A.insert({i,j}, (double)i);
+      B.insert({i,j}, (double)j);
+    }
+  }
+  for (int j = 0; j < 20; j++) {
+    x.insert({j}, (double)j + 1);
+  }
+  A.pack();
+  B.pack();
+  x.pack();
+
+  // Sparse inner products gather and sum into a SIMD reduction
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {10}, Format({Dense}));
+  Tensor<double> yExpected("yExpected", {10}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_NE(std::string::npos,
+            y.getSource().find("#pragma omp simd reduction(+:"));
+  for (int i = 0; i < 10; i++) {
+    double sum = 0.0;
+    for (int j = 0; j < 20; j++) {
+      if ((i + j) % 3 == 0) sum += i * (j + 1.0);
+    }
+    yExpected.insert({i}, sum);
+  }
+  yExpected.pack();
+  ASSERT_TRUE(equals(yExpected, y));
+
+  // Dense innermost loops store to distinct result components
+  Tensor<double> C("C", {10,20}, Format({Dense,Dense}));
+  Tensor<double> CExpected("CExpected", {10,20}, Format({Dense,Dense}));
+  C(i,j) = B(i,j) * x(j);
+  C.evaluate();
+  ASSERT_NE(std::string::npos, C.getSource().find("#pragma omp simd\n"));
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 20; j++) {
+      CExpected.insert({i,j}, j * (j + 1.0));
+    }
+  }
+  CExpected.pack();
+  ASSERT_TRUE(equals(CExpected, C));
+
+  // Loops that append to a sparse result are not vectorized
+  Tensor<double> D("D", {10,20}, CSR);
+  D(i,j) = A(i,j) * B(i,j);
+  D.evaluate();
+  ASSERT_EQ(std::string::npos, D.getSource().find("#pragma omp simd"));
+}
+
+TEST(tensor, diagonal) {
+  // A banded, non-square matrix whose diagonals stick out of it
+  Tensor<double> A("A", {30,25}, DIA);
+  Tensor<double> B("B", {30,25}, CSR);
+  Tensor<double> x("x", {25}, Format({Dense}));
+  for (int i = 0; i < 30; i++) {
+    for (int offset : {-7, -1, 0, 2}) {
+      int j = i + offset;
+      if (0 <= j && j < 25 && (i + offset) % 4 != 0) {
+        A.insert({i,j}, 10 + i + offset * 0.5);
+        B.insert({i,j}, 10 + i + offset * 0.5);
+      }
+    }
+  }
+  for (int j = 0; j < 25; j++) {
+    x.insert({j}, j + 1.0);
+  }
+  A.pack();
+  B.pack();
+  x.pack();
+
+  // Components that the stored diagonals cover but that were not inserted
+  // are explicit zeros
+  size_t count = 0;
+  for (auto& component : A) {
+    int i = component.first[0];
+    int j = component.first[1];
+    if (component.second != 0.0) {
+      ASSERT_EQ(10 + i + (j - i) * 0.5, component.second);
+      count++;
+    }
+  }
+  ASSERT_EQ(B.getStorage().getValues().getSize(), count);
+
+  // Matrix-vector products run over the rows of each diagonal innermost,
+  // without loading its offset per row
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {30}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> yExpected("yExpected", {30}, Format({Dense}));
+  yExpected(i) = B(i,j) * x(j);
+  yExpected.evaluate();
+  ASSERT_TRUE(equals(yExpected, y));
+  std::string source = y.getSource();
+  size_t rowLoop = source.find("#pragma omp simd\n");
+  ASSERT_NE(std::string::npos, rowLoop);
+  ASSERT_EQ(std::string::npos, source.find("A2_offset[", rowLoop));
+
+  // Other expressions iterate over the diagonals of each row
+  Tensor<double> z("z", {30}, Format({Dense}));
+  z(i) = A(i,j) * x(j) + y(i);
+  z.evaluate();
+  Tensor<double> zExpected("zExpected", {30}, Format({Dense}));
+  zExpected(i) = B(i,j) * x(j) + yExpected(i);
+  zExpected.evaluate();
+  ASSERT_TRUE(equals(zExpected, z));
+}
+
+TEST(tensor, simd_intrinsics) {
+  // Rows of 0 to 39 nonzeros cover the vector loops and the scalar remainders
+  Tensor<double> A("A", {40,40}, CSR);
+  Tensor<float> Af("Af", {40,40}, CSR);
+  Tensor<double> x("x", {40}, Format({Dense}));
+  Tensor<float> xf("xf", {40}, Format({Dense}));
+  for (int i = 0; i < 40; i++) {
+    for (int j = 0; j < i; j++) {
+      A.insert({i,(j*7) % 40}, (double)(i + j));
+      Af.insert({i,(j*7) % 40}, (float)(i + j));
+    }
+  }
+  for (int j = 0; j < 40; j++) {
+    x.insert({j}, (double)j + 1);
+    xf.insert({j}, (float)j + 1);
+  }
+  A.pack();
+  Af.pack();
+  x.pack();
+  xf.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {40}, Format({Dense}));
+  Tensor<double> yExpected("yExpected", {40}, Format({Dense}));
+  y.setSimdIntrinsics(true);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_NE(std::string::npos, y.getSource().find("taco_gather_dot_f64("));
+  ASSERT_EQ(std::string::npos, y.getSource().find("#pragma omp simd"));
+
+  Tensor<float> yf("yf", {40}, Format({Dense}));
+  Tensor<float> yfExpected("yfExpected", {40}, Format({Dense}));
+  yf.setSimdIntrinsics(true);
+  yf(i) = Af(i,j) * xf(j);
+  yf.evaluate();
+  ASSERT_NE(std::string::npos, yf.getSource().find("taco_gather_dot_f32("));
+
+  for (int i = 0; i < 40; i++) {
+    double sum = 0.0;
+    for (int j = 0; j < i; j++) {
+      sum += (i + j) * ((j*7) % 40 + 1.0);
+    }
+    yExpected.insert({i}, sum);
+    yfExpected.insert({i}, (float)sum);
+  }
+  yExpected.pack();
+  yfExpected.pack();
+  ASSERT_TRUE(equals(yExpected, y));
+  ASSERT_TRUE(equals(yfExpected, yf));
+}
+
+TEST(tensor, tiered_execution) {
+  Tensor<double> A("A", {10,12}, CSR);
+  Tensor<double> B("B", {10,12}, CSR);
+  Tensor<double> x("x", {12}, Format({Dense}));
+  Tensor<int> D("D", {10,12}, Format({Dense,Dense}));
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 12; j++) {
+      if ((i * j) % 5 == 1) A.insert({i,j}, i + 0.5 * j);
+      if ((i + j) % 3 == 0) B.insert({i,j}, 1.0 + j);
+      D.insert({i,j}, i - j);
+    }
+  }
+  for (int j = 0; j < 12; j++) {
+    x.insert({j}, j * 0.25);
+  }
+  A.pack();
+  B.pack();
+  x.pack();
+  D.pack();
+
+  // Kernels that are never compiled run in the interpreter
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {10}, Format({Dense}));
+  Tensor<double> yExpected("yExpected", {10}, Format({Dense}));
+  y.setTieredExecution(true, 1000);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_TRUE(y.isInterpreted());
+  yExpected(i) = A(i,j) * x(j);
+  yExpected.evaluate();
+  ASSERT_TRUE(equals(yExpected, y));
+
+  Tensor<double> C("C", {10,12}, CSR);
+  Tensor<double> CExpected("CExpected", {10,12}, CSR);
+  C.setTieredExecution(true, 1000);
+  C(i,j) = A(i,j) + B(i,j);
+  C.evaluate();
+  CExpected(i,j) = A(i,j) + B(i,j);
+  CExpected.evaluate();
+  ASSERT_TRUE(equals(CExpected, C));
+
+  Tensor<double> E("E", {10,12}, CSR);
+  E.setTieredExecution(true, 1000);
+  E(i,j) = A(i,j) * B(i,j);
+  E.compile(true);
+  E.assemble();
+  E.compute();
+  Tensor<double> EExpected("EExpected", {10,12}, CSR);
+  EExpected(i,j) = A(i,j) * B(i,j);
+  EExpected.evaluate();
+  ASSERT_TRUE(equals(EExpected, E));
+
+  Tensor<int> z("z", {10}, Format({Dense}));
+  Tensor<int> zExpected("zExpected", {10}, Format({Dense}));
+  z.setTieredExecution(true, 1000);
+  z(i) = D(i,j) * D(i,j) - D(i,j);
+  z.evaluate();
+  zExpected(i) = D(i,j) * D(i,j) - D(i,j);
+  zExpected.evaluate();
+  ASSERT_TRUE(equals(zExpected, z));
+
+  // Kernels switch to the compiled library once it's built
+  Tensor<double> w("w", {10}, Format({Dense}));
+  w.setTieredExecution(true, 2);
+  w(i) = A(i,j) * x(j);
+  w.compile();
+  ASSERT_TRUE(w.isInterpreted());
+  w.assemble();
+  for (int k = 0; k < 10; k++) {
+    w.compute();
+    ASSERT_TRUE(equals(yExpected, w));
+  }
+  w.waitForLibrary();
+  ASSERT_FALSE(w.isInterpreted());
+  w.compute();
+  ASSERT_TRUE(equals(yExpected, w));
+
+  // Complex kernels are compiled, since the interpreter can't run them
+  Tensor<std::complex<double>> c("c", {12}, Format({Dense}));
+  Tensor<std::complex<double>> u("u", {10}, Format({Dense}));
+  for (int j = 0; j < 12; j++) {
+    c.insert({j}, std::complex<double>(j, 1.0));
+  }
+  c.pack();
+  u.setTieredExecution(true, 1000);
+  u(i) = A(i,j) * c(j);
+  u.evaluate();
+  ASSERT_FALSE(u.isInterpreted());
+  Tensor<std::complex<double>> uExpected("uExpected", {10}, Format({Dense}));
+  uExpected(i) = A(i,j) * c(j);
+  uExpected.evaluate();
+  ASSERT_TRUE(equals(uExpected, u));
+}
+
+TEST(tensor, tiered_compilation) {
+  Tensor<double> A("A", {10,12}, CSR);
+  Tensor<double> B("B", {10,12}, CSR);
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 12; j++) {
+      if ((i * j) % 5 == 1) A.insert({i,j}, i + 0.5 * j);
+      if ((i + j) % 3 == 0) B.insert({i,j}, 1.0 + j);
+    }
+  }
+  A.pack();
+  B.pack();
+
+  // Results are the same before and after the optimized build is swapped in
+  IndexVar i("i"), j("j");
+  Tensor<double> C("C", {10,12}, CSR);
+  Tensor<double> CExpected("CExpected", {10,12}, CSR);
+  C.setTieredCompilation(true);
+  C(i,j) = A(i,j) + B(i,j);
+  C.compile();
+  ASSERT_FALSE(C.isInterpreted());
+  CExpected(i,j) = A(i,j) + B(i,j);
+  CExpected.evaluate();
+  for (int k = 0; k < 5; k++) {
+    C.assemble();
+    C.compute();
+    ASSERT_TRUE(equals(CExpected, C));
+  }
+  C.waitForLibrary();
+  ASSERT_TRUE(C.isOptimized());
+  C.assemble();
+  C.compute();
+  ASSERT_TRUE(equals(CExpected, C));
+}
+
+TEST(tensor, in_memory_compile) {
+#ifdef TACO_LINUX
+  if (!util::getFromEnv("TACO_KEEP_FILES", "").empty()) {
+    return;
+  }
+  auto countFiles = []() {
+    int count = 0;
+    DIR* dir = opendir(util::getTmpdir().data());
+    while (readdir(dir) != nullptr) {
+      count++;
+    }
+    closedir(dir);
+    return count;
+  };
+  Tensor<double> b("b", {20}, Format({Dense}));
+  for (int i = 0; i < 20; i++) {
+    b.insert({i}, (double)i);
+  }
+  b.pack();
+
+  // Kernels are compiled and loaded without writing files
+  int files = countFiles();
+  IndexVar i("i");
+  Tensor<double> a("a", {20}, Format({Dense}));
+  a(i) = b(i) * b(i);
+  a.evaluate();
+  ASSERT_EQ(files, countFiles());
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(i * i, ((double*)a.getStorage().getValues().getData())[i]);
+  }
+#endif
+}
@@ -20,7 +20,7 @@ TYPED_TEST_P(ScalarTensorTest, types) {
 }
 REGISTER_TYPED_TEST_CASE_P(ScalarTensorTest, types);
 
-typedef ::testing::Types<int8_t, int16_t, int32_t, int64_t, long long, uint8_t, uint16_t, uint32_t, uint64_t, unsigned long long, float, double, std::complex<float>, std::complex<double>> AllTypes;
+typedef ::testing::Types<int8_t, int16_t, int32_t, int64_t, long long, uint8_t, uint16_t, uint32_t, uint64_t, unsigned long long, float16, bfloat16, float, double, std::complex<float>, std::complex<double>> AllTypes;
 INSTANTIATE_TYPED_TEST_CASE_P(tensor_types, ScalarTensorTest, AllTypes);
 
 
@@ -379,3 +379,99 @@ TEST(tensor_types, int_float_promotion) {
   
   ASSERT_TRUE(equalsExact(a, expected));
 }
+
+TEST(tensor_types, float16_accumulation) {
+  // 2048 + 1 rounds back to 2048 in half precision, so the sum is only exact
+  // if the temporary accumulates in single precision
+  const int n = 4096;
+  Tensor<float16> B("B", {1, n}, Format({Dense, Sparse}));
+  Tensor<float16> c("c", {n}, Format({Dense}));
+  for (int j = 0; j < n; j++) {
+    B.insert({0, j}, float16(1.0f));
+    c.insert({j}, float16(1.0f));
+  }
+  B.pack();
+  c.pack();
+
+  Tensor<float16> a("a", {1}, Format({Dense}));
+  a(i) = B(i,j) * c(j);
+  a.evaluate();
+  ASSERT_EQ(4096.0f, (float)a.begin()->second);
+  ASSERT_NE(std::string::npos, a.getSource().find("taco_float16_to_float("));
+}
+
+TEST(tensor_types, bfloat16_storage) {
+  Tensor<bfloat16> b("b", {4}, Format({Sparse}));
+  b.insert({1}, bfloat16(1.5f));
+  b.insert({3}, bfloat16(-2.0f));
+  b.pack();
+
+  Tensor<float> a("a", {4}, Format({Sparse}));
+  a(i) = b(i) * b(i);
+  a.evaluate();
+
+  Tensor<float> expected("a", {4}, Format({Sparse}));
+  expected.insert({1}, 2.25f);
+  expected.insert({3}, 4.0f);
+  expected.pack();
+  ASSERT_TRUE(equalsExact(a, expected));
+}
+
+TEST(tensor_types, accumulation_type) {
+  Tensor<float> B("B", {2, 2}, Format({Dense, Dense}));
+  Tensor<float> c("c", {2}, Format({Dense}));
+  B.insert({0, 0}, 1.0f);
+  B.insert({1, 1}, 2.0f);
+  c.insert({0}, 3.0f);
+  c.insert({1}, 4.0f);
+  B.pack();
+  c.pack();
+
+  Tensor<float> a("a", {2}, Format({Dense}));
+  a(i) = B(i,j) * c(j);
+  a.setAccumulationType(Float64());
+  a.evaluate();
+  ASSERT_NE(std::string::npos, a.getSource().find("double t"));
+
+  Tensor<float> expected("a", {2}, Format({Dense}));
+  expected.insert({0}, 3.0f);
+  expected.insert({1}, 8.0f);
+  expected.pack();
+  ASSERT_TRUE(equalsExact(a, expected));
+}
+
+TEST(tensor_types, pattern) {
+  Tensor<bool> A("A", {3, 4}, Format({Dense, Sparse}));
+  A.insert({0, 1}, true);
+  A.insert({0, 3}, true);
+  A.insert({2, 0}, true);
+  A.pack();
+
+  Tensor<double> x("x", {4}, Format({Dense}));
+  for (int j = 0; j < 4; j++) {
+    x.insert({j}, (double)(j + 1));
+  }
+  x.pack();
+
+  Tensor<double> y("y", {3}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_EQ(std::string::npos, y.getSource().find("A_vals"));
+
+  Tensor<double> expected("expected", {3}, Format({Dense}));
+  expected.insert({0}, 6.0);
+  expected.insert({2}, 1.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, y));
+
+  // Row degrees
+  Tensor<int> d("d", {3}, Format({Dense}));
+  d(i) = A(i,j);
+  d.evaluate();
+
+  Tensor<int> degrees("degrees", {3}, Format({Dense}));
+  degrees.insert({0}, 2);
+  degrees.insert({2}, 1);
+  degrees.pack();
+  ASSERT_TRUE(equals(degrees, d));
+}
@@ -79,7 +79,8 @@ void ASSERT_STORAGE_EQUALS(vector<vector<vector<int>>> expectedIndices,
         break;
       }
       case ModeType::Sparse:
-      case ModeType::Fixed: {
+      case ModeType::Fixed:
+      case ModeType::Diagonal: {
         taco_iassert(expectedIndices[i].size() == 2);
         ASSERT_EQ(2u, modeIndex.numIndexArrays());
         auto pos = modeIndex.getIndexArray(0);
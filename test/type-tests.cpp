@@ -45,6 +45,32 @@ TYPED_TEST_P(FloatTest, types) {
 REGISTER_TYPED_TEST_CASE_P(FloatTest, types);
 typedef ::testing::Types<float, double> GenericFloat;
 INSTANTIATE_TYPED_TEST_CASE_P(Generic, FloatTest, GenericFloat);
+typedef ::testing::Types<float16, bfloat16> HalfFloat;
+INSTANTIATE_TYPED_TEST_CASE_P(Half, FloatTest, HalfFloat);
+
+TEST(types, float16) {
+  ASSERT_EQ(0x3c00, float16(1.0f).getBits());
+  ASSERT_EQ(0xc000, float16(-2.0f).getBits());
+  ASSERT_EQ(0x7bff, float16(65504.0f).getBits());
+  ASSERT_EQ(0x7c00, float16(1e6f).getBits());
+  ASSERT_EQ(0x0001, float16(5.9604645e-8f).getBits());
+  ASSERT_EQ(0x0000, float16(1e-9f).getBits());
+  // ties round to even
+  ASSERT_EQ(0x6800, float16(2049.0f).getBits());
+  ASSERT_EQ(0x6802, float16(2051.0f).getBits());
+  for (uint16_t bits : {0x0001, 0x03ff, 0x0400, 0x3555, 0x7bff, 0xfbff}) {
+    ASSERT_EQ(bits, float16((float)float16::fromBits(bits)).getBits());
+  }
+  ASSERT_EQ(0.333251953125f, (float)float16::fromBits(0x3555));
+}
+
+TEST(types, bfloat16) {
+  ASSERT_EQ(0x3f80, bfloat16(1.0f).getBits());
+  ASSERT_EQ(1.0f, (float)bfloat16::fromBits(0x3f80));
+  ASSERT_EQ(3.140625f, (float)bfloat16(3.14159265f));
+  ASSERT_EQ(DataType::BFloat16, type<bfloat16>().getKind());
+  ASSERT_EQ(Float32(), max_type(Float16(), Float32()));
+}
 
 TEST(types, equality) {
   DataType fp32(DataType::Float32);
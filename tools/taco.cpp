@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <memory>
 
 #include "taco/tensor.h"
@@ -139,6 +140,18 @@ static void printUsageInfo() {
             "Write the C source code of the kernel functions of the given "
             "expression to a file.");
   cout << endl;
+  printFlag("write-library=<path/prefix>",
+            "Compile the kernels of the given expressions ahead of time into "
+            "the static library <path/prefix>.a and the header "
+            "<path/prefix>.h, whose <prefix>_register() function registers "
+            "the kernels so that tensors with the same expressions, types and "
+            "formats use them without a C compiler. Several expressions may "
+            "be given, whose results must have distinct names. The library "
+            "is built for any machine of the host's architecture (generic "
+            "code, multiversioned for AVX2 and AVX-512 on x86-64 Linux), not "
+            "for the host's instruction set, unless TACO_TARGET selects a "
+            "target. Examples: lib/kernels.");
+  cout << endl;
   printFlag("read-source=<filename>",
             "Read C kernels from the file. The argument order is inferred from "
             "the index expression. If the -time option is used then the given "
@@ -193,6 +206,7 @@ int main(int argc, char* argv[]) {
   bool writeCompute        = false;
   bool writeAssemble       = false;
   bool writeKernels        = false;
+  bool writeLibrary        = false;
   bool loaded              = false;
   bool verify              = false;
   bool time                = false;
@@ -210,6 +224,7 @@ int main(int argc, char* argv[]) {
   string indexVarName = "";
 
   string exprStr;
+  vector<string> exprStrs;
   map<string,Format> formats;
   map<string,std::vector<int>> tensorsDimensions;
   map<string,DataType> dataTypes;
@@ -220,6 +235,7 @@ int main(int argc, char* argv[]) {
   string writeComputeFilename;
   string writeAssembleFilename;
   string writeKernelFilename;
+  string writeLibraryPrefix;
   string writeTimeFilename;
   vector<string> declaredTensors;
 
@@ -438,22 +454,32 @@ int main(int argc, char* argv[]) {
       writeKernelFilename = argValue;
       writeKernels = true;
     }
+    else if ("-write-library" == argName) {
+      writeLibraryPrefix = argValue;
+      writeLibrary = true;
+    }
     else if ("-read-source" == argName) {
       kernelFilenames.push_back(argValue);
       readKernels = true;
     }
     else {
-      if (exprStr.size() != 0) {
-        printUsageInfo();
-        return 2;
-      }
-      exprStr = argv[i];
+      exprStrs.push_back(argv[i]);
     }
   }
 
+  // Only libraries are compiled from several expressions
+  if (exprStrs.size() > 1 && !writeLibrary) {
+    printUsageInfo();
+    return 2;
+  }
+  if (!exprStrs.empty()) {
+    exprStr = exprStrs[0];
+  }
+
   // Print compute is the default if nothing else was asked for
   if (!printAssemble && !printIterationGraph && !printLattice && !loaded &&
-      !writeCompute && !writeAssemble && !writeKernels && !readKernels) {
+      !writeCompute && !writeAssemble && !writeKernels && !readKernels &&
+      !writeLibrary) {
     printCompute = true;
   }
 
@@ -676,6 +702,32 @@ int main(int argc, char* argv[]) {
     filestream.close();
   }
 
+  if (writeLibrary) {
+    vector<TensorBase> results = {tensor};
+    set<string> resultNames = {tensor.getName()};
+    for (size_t i = 1; i < exprStrs.size(); i++) {
+      parser::Parser parser(exprStrs[i], formats, dataTypes, tensorsDimensions,
+                            loadedTensors, 42);
+      try {
+        parser.parse();
+      } catch (parser::ParseError& e) {
+        return reportError(e.getMessage(), 6);
+      }
+      TensorBase result = parser.getResultTensor();
+      if (!resultNames.insert(result.getName()).second) {
+        return reportError("Results of a library must have distinct names", 3);
+      }
+      results.push_back(result);
+    }
+    size_t separator = writeLibraryPrefix.rfind('/');
+    string path = (separator == string::npos)
+                  ? "" : writeLibraryPrefix.substr(0, separator + 1);
+    string prefix = writeLibraryPrefix.substr(path.size());
+    Target target = util::getFromEnv("TACO_TARGET", "").empty()
+                    ? getPortableTarget() : getTargetFromEnvironment();
+    compileToStaticLibrary(results, path, prefix, computeWithAssemble, target);
+  }
+
   for (auto& output : outputFilenames) {
     string tensorName = output.first;
     string filename = output.second;